@@ -0,0 +1,198 @@
+// Persistent offscreen copy of the window content, so only damaged parts of
+// the window have to be redrawn and presented.
+
+#include "BackBuffer.hpp"
+#include "GLCore.hpp"
+
+#define GLFW_EXPOSE_NATIVE_EGL
+#include <GLFW/glfw3native.h>
+
+#include <iostream>
+#include <cstring>
+#include <vector>
+
+//! \brief Number of frames kept in the damage history: EGL implementations
+//! rarely use more than three buffers.
+static const size_t MAX_BUFFER_AGE = 3u;
+
+//------------------------------------------------------------------------------
+//! \brief Return true if the space separated list of extensions holds the
+//! given one.
+//------------------------------------------------------------------------------
+static bool hasExtension(const char* extensions, const char* name)
+{
+    if (extensions == nullptr)
+        return false;
+
+    const size_t length = strlen(name);
+    for (const char* p = strstr(extensions, name); p != nullptr; p = strstr(p + length, name))
+    {
+        if (((p == extensions) || (p[-1] == ' ')) &&
+            ((p[length] == ' ') || (p[length] == '\0')))
+            return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+BackBuffer::~BackBuffer()
+{
+    release();
+}
+
+//------------------------------------------------------------------------------
+void BackBuffer::init(GLFWwindow* window)
+{
+    m_window = window;
+
+    // GLX contexts (default on X11) cannot present partial updates: the
+    // window is fully copied from the buffer.
+    if (glfwGetWindowAttrib(window, GLFW_CONTEXT_CREATION_API) != GLFW_EGL_CONTEXT_API)
+    {
+        std::cout << "Partial present: not available (no EGL context)" << std::endl;
+        return ;
+    }
+
+    m_display = glfwGetEGLDisplay();
+    m_surface = glfwGetEGLSurface(window);
+    const char* extensions = eglQueryString(m_display, EGL_EXTENSIONS);
+
+    if (hasExtension(extensions, "EGL_KHR_swap_buffers_with_damage"))
+    {
+        m_swap_with_damage = reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(
+            eglGetProcAddress("eglSwapBuffersWithDamageKHR"));
+    }
+    else if (hasExtension(extensions, "EGL_EXT_swap_buffers_with_damage"))
+    {
+        m_swap_with_damage = reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(
+            eglGetProcAddress("eglSwapBuffersWithDamageEXT"));
+    }
+    m_buffer_age = hasExtension(extensions, "EGL_EXT_buffer_age");
+
+    std::cout << "Partial present: swap with damage "
+              << (m_swap_with_damage ? "yes" : "no")
+              << ", buffer age " << (m_buffer_age ? "yes" : "no")
+              << std::endl;
+}
+
+//------------------------------------------------------------------------------
+void BackBuffer::release()
+{
+    if (m_fbo != 0)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteRenderbuffers(1, &m_color);
+        glDeleteRenderbuffers(1, &m_depth);
+        m_fbo = m_color = m_depth = 0;
+    }
+    m_width = m_height = 0;
+}
+
+//------------------------------------------------------------------------------
+bool BackBuffer::resize(int width, int height)
+{
+    if ((width == m_width) && (height == m_height) && (m_fbo != 0))
+        return false;
+
+    release();
+    m_history.clear();
+    if ((width <= 0) || (height <= 0))
+        return true; // Minimized window
+
+    GLCHECK(glGenRenderbuffers(1, &m_color));
+    GLCHECK(glBindRenderbuffer(GL_RENDERBUFFER, m_color));
+    GLCHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height));
+    GLCHECK(glGenRenderbuffers(1, &m_depth));
+    GLCHECK(glBindRenderbuffer(GL_RENDERBUFFER, m_depth));
+    GLCHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height));
+    GLCHECK(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+    GLCHECK(glGenFramebuffers(1, &m_fbo));
+    GLCHECK(glBindFramebuffer(GL_FRAMEBUFFER, m_fbo));
+    GLCHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                      GL_RENDERBUFFER, m_color));
+    GLCHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                      GL_RENDERBUFFER, m_depth));
+    GLenum status = GLCHECK(glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    GLCHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "BackBuffer: incomplete framebuffer " << status << std::endl;
+        release();
+        return true;
+    }
+
+    m_width = width;
+    m_height = height;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void BackBuffer::bind()
+{
+    GLCHECK(glBindFramebuffer(GL_FRAMEBUFFER, m_fbo));
+}
+
+//------------------------------------------------------------------------------
+void BackBuffer::present(Region const& damage)
+{
+    if (m_fbo == 0)
+        return ;
+
+    // The window back buffer holds the frame presented age frames ago (0 if
+    // unknown): refresh what has been damaged since then.
+    EGLint age = 0;
+    if (m_buffer_age)
+    {
+        eglQuerySurface(m_display, m_surface, EGL_BUFFER_AGE_EXT, &age);
+    }
+
+    Region outdated(damage);
+    if ((age > 0) && (size_t(age) <= m_history.size() + 1u))
+    {
+        for (EGLint i = 0; i < age - 1; ++i)
+        {
+            for (auto const& rect: m_history[size_t(i)].rects())
+            {
+                outdated.add(rect);
+            }
+        }
+    }
+    else
+    {
+        outdated = Region(Rect(0, 0, m_width, m_height));
+    }
+
+    // Copy the buffer to the window
+    GLCHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo));
+    GLCHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+    for (auto const& r: outdated.rects())
+    {
+        GLCHECK(glBlitFramebuffer(r.x, r.y, r.right(), r.top(),
+                                  r.x, r.y, r.right(), r.top(),
+                                  GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    }
+    GLCHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+    m_history.push_front(damage);
+    if (m_history.size() > MAX_BUFFER_AGE)
+    {
+        m_history.pop_back();
+    }
+
+    if (m_swap_with_damage == nullptr)
+    {
+        glfwSwapBuffers(m_window);
+        return ;
+    }
+
+    // Rectangles as (x, y, width, height) with the origin at the bottom-left
+    // corner, like OpenGL.
+    std::vector<EGLint> rects;
+    rects.reserve(4u * damage.rects().size());
+    for (auto const& r: damage.rects())
+    {
+        rects.insert(rects.end(), { r.x, r.y, r.w, r.h });
+    }
+    m_swap_with_damage(m_display, m_surface, rects.data(), EGLint(damage.rects().size()));
+}
@@ -0,0 +1,77 @@
+// Persistent offscreen copy of the window content, so only damaged parts of
+// the window have to be redrawn and presented.
+
+#ifndef BACKBUFFER_HPP
+#  define BACKBUFFER_HPP
+
+#  include <GL/glew.h>
+#  include <GLFW/glfw3.h>
+#  include <EGL/egl.h>
+#  include <EGL/eglext.h>
+
+#  include "Region.hpp"
+#  include <deque>
+
+// ****************************************************************************
+//! \brief Framebuffer object keeping the window content between frames.
+//! Views are redrawn inside it only where the window is damaged, then the
+//! damage is copied to the window and presented:
+//!   - with EGL_KHR_swap_buffers_with_damage (or the EXT variant) when the
+//!     GLFW context uses EGL, so the compositor only updates damaged pixels;
+//!   - with EGL_EXT_buffer_age, only the pixels outdated in the window back
+//!     buffer are copied, else the whole window is copied (still cheaper than
+//!     redrawing views with software rasterizers like llvmpipe).
+//! The OpenGL context shall be current when calling methods.
+// ****************************************************************************
+class BackBuffer
+{
+public:
+
+    //! \brief Release OpenGL objects.
+    ~BackBuffer();
+
+    //! \brief Look for the EGL extensions available for the window.
+    void init(GLFWwindow* window);
+
+    //! \brief Reallocate the buffer when the window dimension changed.
+    //! \return true if the buffer content has been lost and the whole window
+    //! has to be redrawn.
+    bool resize(int width, int height);
+
+    //! \brief Draw into the buffer.
+    void bind();
+
+    //! \brief Copy the damaged region to the window and swap buffers.
+    void present(Region const& damage);
+
+private:
+
+    //! \brief Release the framebuffer and its attachments.
+    void release();
+
+private:
+
+    GLFWwindow* m_window = nullptr;
+
+    //! \brief Framebuffer object and its attachments
+    GLuint m_fbo = 0;
+    GLuint m_color = 0;
+    GLuint m_depth = 0;
+    int m_width = 0;
+    int m_height = 0;
+
+    //! \brief EGL handles when GLFW created an EGL context.
+    EGLDisplay m_display = EGL_NO_DISPLAY;
+    EGLSurface m_surface = EGL_NO_SURFACE;
+    //! \brief eglSwapBuffersWithDamageKHR or EXT (same signature). nullptr if
+    //! not available.
+    PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC m_swap_with_damage = nullptr;
+    //! \brief EGL_BUFFER_AGE_EXT can be queried.
+    bool m_buffer_age = false;
+
+    //! \brief Damage of the last presented frames (most recent first) to
+    //! refresh window back buffers older than one frame.
+    std::deque<Region> m_history;
+};
+
+#endif // BACKBUFFER_HPP
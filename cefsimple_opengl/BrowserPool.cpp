@@ -0,0 +1,69 @@
+// Browsers created in advance so new views show up without waiting for CEF.
+
+#include "BrowserPool.hpp"
+
+//! \brief Delay after the last acquire() before creating views again.
+static const std::chrono::milliseconds REFILL_DELAY(500);
+
+//------------------------------------------------------------------------------
+BrowserPool::BrowserPool(TextureUploader& uploader, size_t capacity)
+    : m_uploader(uploader), m_capacity(capacity)
+{}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<BrowserView> BrowserPool::acquire(const std::string &url)
+{
+    m_last_acquire = std::chrono::steady_clock::now();
+    if (m_ready.empty())
+        return nullptr;
+
+    std::shared_ptr<BrowserView> view = m_ready.back();
+    m_ready.pop_back();
+    if (!url.empty())
+    {
+        view->load(url);
+    }
+    return view;
+}
+
+//------------------------------------------------------------------------------
+bool BrowserPool::recycle(std::shared_ptr<BrowserView> const& view)
+{
+    if ((view == nullptr) || view->transparent() || (view->context() != nullptr) ||
+        (m_ready.size() >= m_capacity))
+        return false;
+
+    view->reset();
+    m_ready.push_back(view);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void BrowserPool::refill(int width, int height)
+{
+    if (m_ready.size() >= m_capacity)
+        return ;
+
+    if (std::chrono::steady_clock::now() - m_last_acquire < REFILL_DELAY)
+        return ;
+
+    auto view = std::make_shared<BrowserView>("about:blank", m_uploader);
+    view->reshape(width, height);
+    view->visible(false);
+    m_ready.push_back(view);
+}
+
+//------------------------------------------------------------------------------
+void BrowserPool::reshape(int width, int height)
+{
+    for (auto& it: m_ready)
+    {
+        it->reshape(width, height);
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserPool::clear()
+{
+    m_ready.clear();
+}
@@ -0,0 +1,62 @@
+// Browsers created in advance so new views show up without waiting for CEF.
+
+#ifndef BROWSERPOOL_HPP
+#  define BROWSERPOOL_HPP
+
+#  include "BrowserView.hpp"
+
+#  include <chrono>
+#  include <memory>
+#  include <vector>
+
+// ****************************************************************************
+//! \brief Keep a few opaque browser views ready at about:blank: their render
+//! process is running and their OpenGL objects and textures are set up.
+//! acquire() hands one out and refill() creates the missing ones later, once
+//! the window had a moment without view creation. Transparent views and
+//! views with their own request context are never pooled since both are set
+//! when the browser is created.
+// ****************************************************************************
+class BrowserPool
+{
+public:
+
+    //! \brief Keep up to \c capacity views ready. Views are created with the
+    //! given uploader.
+    BrowserPool(TextureUploader& uploader, size_t capacity = 2u);
+
+    //! \brief Take a ready view, loading the given URL (an empty URL keeps
+    //! about:blank). \return nullptr if the pool is empty.
+    std::shared_ptr<BrowserView> acquire(const std::string &url);
+
+    //! \brief Reset a view no longer used and keep it if the pool is not
+    //! full. \return false if the view has not been kept.
+    bool recycle(std::shared_ptr<BrowserView> const& view);
+
+    //! \brief Create at most one missing view, sized to the given window.
+    //! To be called on each frame.
+    void refill(int width, int height);
+
+    //! \brief Send the new window size to ready views.
+    void reshape(int width, int height);
+
+    //! \brief Destroy ready views.
+    void clear();
+
+    //! \brief Number of ready views.
+    inline size_t size() const
+    {
+        return m_ready.size();
+    }
+
+private:
+
+    TextureUploader& m_uploader;
+    size_t m_capacity;
+    std::vector<std::shared_ptr<BrowserView>> m_ready;
+    //! \brief Last time a view has been taken: refill() waits a bit after it
+    //! so opening several views in a row is not slowed down.
+    std::chrono::steady_clock::time_point m_last_acquire;
+};
+
+#endif // BROWSERPOOL_HPP
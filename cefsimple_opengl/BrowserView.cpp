@@ -3,45 +3,78 @@
 // https://github.com/andmcgregor/cefgui
 
 #include "BrowserView.hpp"
+#include "AlphaScan.hpp"
 #include "GLCore.hpp"
+#include <cmath>
+
+//! \brief Calls waiting for the browser creation beyond this number are
+//! dropped (i.e. mouse moves while the render process starts).
+static const size_t MAX_PENDING_CALLS = 256u;
+
+int BrowserView::FrameRate = 60;
 
 //------------------------------------------------------------------------------
-BrowserView::RenderHandler::RenderHandler(glm::vec4 const& viewport)
-    : m_viewport(viewport)
-{}
+BrowserView::RenderHandler::RenderHandler(glm::vec4 const& viewport,
+                                          TextureUploader& uploader, bool transparent)
+    : m_viewport(&viewport), m_uploader(uploader), m_target(uploader.target()),
+      m_pipeline("view"), m_transparent(transparent), m_opaque(!transparent)
+{
+    // Look for transparent pixels in a tile of the painted page
+    m_pipeline.stage("alpha", [this](FrameTile const& tile)
+    {
+        if (m_scan.opaque && !AlphaScan::opaque(m_scan.page, m_scan.stride, tile.x,
+                                                tile.y, tile.width, tile.height))
+        {
+            m_scan.opaque = false;
+        }
+    });
+}
 
 //------------------------------------------------------------------------------
 BrowserView::RenderHandler::~RenderHandler()
 {
     // Free GPU memory
-    GLCore::deleteProgram(m_prog);
+    m_uploader.release(m_target);
+    GLCore::deleteProgram(m_opaque_prog.id);
+    GLCore::deleteProgram(m_blend_prog.id);
     glDeleteBuffers(1, &m_vbo);
     glDeleteVertexArrays(1, &m_vao);
 }
 
 //------------------------------------------------------------------------------
-bool BrowserView::RenderHandler::init()
+bool BrowserView::RenderHandler::Program::init(const char* frag)
 {
-    // Dummy texture data
-    const unsigned char data[] = {
-        255, 0, 0, 255,
-        0, 255, 0, 255,
-        0, 0, 255, 255,
-        255, 255, 255, 255,
-    };
+    id = GLCore::createShaderProgram("shaders/tex.vert", frag);
+    if (id == 0)
+        return false;
 
+    tex_loc = GLCHECK(glGetUniformLocation(id, "tex"));
+    mvp_loc = GLCHECK(glGetUniformLocation(id, "mvp"));
+    texscale_loc = GLCHECK(glGetUniformLocation(id, "texscale"));
+    depth_loc = GLCHECK(glGetUniformLocation(id, "depth"));
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool BrowserView::RenderHandler::init()
+{
     // Compile vertex and fragment shaders
-    m_prog = GLCore::createShaderProgram("shaders/tex.vert", "shaders/tex.frag");
-    if (m_prog == 0)
+    if (!m_opaque_prog.init("shaders/tex_opaque.frag") ||
+        !m_blend_prog.init("shaders/tex.frag"))
     {
         std::cerr << "shader compile failed" << std::endl;
         return false;
     }
 
-    // Get locations of shader variables (attributes and uniforms)
-    m_pos_loc = GLCHECK(glGetAttribLocation(m_prog, "position"));
-    m_tex_loc = GLCHECK(glGetUniformLocation(m_prog, "tex"));
-    m_mvp_loc = GLCHECK(glGetUniformLocation(m_prog, "mvp"))
+    // Get locations of shader variables (attributes and uniforms). Both
+    // programs share the vertex shader and therefore the VAO.
+    m_pos_loc = GLCHECK(glGetAttribLocation(m_opaque_prog.id, "position"));
+    GLint blend_pos_loc = GLCHECK(glGetAttribLocation(m_blend_prog.id, "position"));
+    if (m_pos_loc != blend_pos_loc)
+    {
+        std::cerr << "shaders do not share the position location" << std::endl;
+        return false;
+    }
 
     // Square vertices (texture positions are computed directly inside the shader)
     float coords[] = {-1.0,-1.0,-1.0,1.0,1.0,-1.0,1.0,-1.0,-1.0,1.0,1.0,1.0};
@@ -55,14 +88,7 @@ bool BrowserView::RenderHandler::init()
     GLCHECK(glEnableVertexAttribArray(m_pos_loc));
     GLCHECK(glVertexAttribPointer(m_pos_loc, 2, GL_FLOAT, GL_FALSE, 0, 0));
 
-    GLCHECK(glGenTextures(1, &m_tex));
-    GLCHECK(glBindTexture(GL_TEXTURE_2D, m_tex));
-    GLCHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-    GLCHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-    GLCHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-    GLCHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    GLCHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, data));
-    GLCHECK(glBindTexture(GL_TEXTURE_2D, 0));
+    placeholder();
 
     GLCHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
     GLCHECK(glBindVertexArray(0));
@@ -71,13 +97,34 @@ bool BrowserView::RenderHandler::init()
 }
 
 //------------------------------------------------------------------------------
-void BrowserView::RenderHandler::draw(glm::vec4 const& viewport, bool fixed)
+void BrowserView::RenderHandler::placeholder()
 {
+    // Placeholder drawn until the first paint (BGRA, premultiplied): light
+    // grey for opaque views, nothing for transparent ones.
+    const unsigned char c = m_transparent ? 0 : 224;
+    const unsigned char a = m_transparent ? 0 : 255;
+    const unsigned char data[] = {
+        c, c, c, a,  c, c, c, a,
+        c, c, c, a,  c, c, c, a,
+    };
+
+    m_page_width = m_page_height = 2;
+    m_painted = false;
+    m_opaque = !m_transparent;
+    m_uploader.upload(m_target, data, 2, 2, { Rect(0, 0, 2, 2) });
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::RenderHandler::draw(glm::vec4 const& viewport, bool fixed, float depth)
+{
+    // Nothing uploaded yet
+    PooledTexture const& texture = m_target->front();
+    if (texture.id == 0)
+        return ;
+
     // Where to paint on the OpenGL window
-    GLCHECK(glViewport(viewport[0],
-                       viewport[1],
-                       GLsizei(viewport[2] * m_width),
-                       GLsizei(viewport[3] * m_height)));
+    const Rect rect = area(viewport);
+    GLCHECK(glViewport(rect.x, rect.y, rect.w, rect.h));
 
     // Apply a rotation
     glm::mat4 trans = glm::mat4(1.0f); // Identity matrix
@@ -88,19 +135,77 @@ void BrowserView::RenderHandler::draw(glm::vec4 const& viewport, bool fixed)
     }
 
     // See https://learnopengl.com/Getting-started/Textures
-    GLCHECK(glUseProgram(m_prog));
+    Program const& prog = m_opaque ? m_opaque_prog : m_blend_prog;
+    GLCHECK(glUseProgram(prog.id));
     GLCHECK(glBindVertexArray(m_vao));
 
-    GLCHECK(glUniformMatrix4fv(m_mvp_loc, 1, GL_FALSE, glm::value_ptr(trans)));
+    GLCHECK(glUniformMatrix4fv(prog.mvp_loc, 1, GL_FALSE, glm::value_ptr(trans)));
+    GLCHECK(glUniform1f(prog.depth_loc, depth));
+    GLCHECK(glUniform2f(prog.texscale_loc,
+                        float(m_target->pageWidth()) / float(texture.width),
+                        float(m_target->pageHeight()) / float(texture.height)));
     GLCHECK(glBindBuffer(GL_ARRAY_BUFFER, m_vbo));
     GLCHECK(glActiveTexture(GL_TEXTURE0));
-    GLCHECK(glBindTexture(GL_TEXTURE_2D, m_tex));
+    GLCHECK(glBindTexture(GL_TEXTURE_2D, texture.id));
     GLCHECK(glDrawArrays(GL_TRIANGLES, 0, 6));
     GLCHECK(glBindTexture(GL_TEXTURE_2D, 0));
     GLCHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
 
     GLCHECK(glBindVertexArray(0));
     GLCHECK(glUseProgram(0));
+
+    // Keep the upload thread away from the texture until drawn
+    m_target->drawn();
+}
+
+//------------------------------------------------------------------------------
+Rect BrowserView::RenderHandler::area(glm::vec4 const& viewport) const
+{
+    return Rect(int(viewport[0] * float(m_window_width)),
+                int(viewport[1] * float(m_window_height)),
+                int(viewport[2] * float(m_window_width)),
+                int(viewport[3] * float(m_window_height)));
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::RenderHandler::damage(Rect const& area, Region& damage)
+{
+    m_target->flip(m_dirty);
+
+    const GLsizei page_width = m_target->pageWidth();
+    const GLsizei page_height = m_target->pageHeight();
+    if ((page_width <= 0) || (page_height <= 0))
+        return ;
+
+    // Pages have their origin at the top-left corner, the window at the
+    // bottom-left one. Rectangles grow by one pixel for linear filtering.
+    const float sx = float(area.w) / float(page_width);
+    const float sy = float(area.h) / float(page_height);
+    for (auto const& rect: m_dirty)
+    {
+        const int x0 = area.x + int(std::floor(float(rect.x) * sx)) - 1;
+        const int x1 = area.x + int(std::ceil(float(rect.right()) * sx)) + 1;
+        const int y0 = area.top() - int(std::ceil(float(rect.top()) * sy)) - 1;
+        const int y1 = area.top() - int(std::floor(float(rect.y) * sy)) + 1;
+        damage.add(Rect(x0, y0, x1 - x0, y1 - y0).intersection(area));
+    }
+    m_dirty.clear();
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::RenderHandler::waitFirstPaint()
+{
+    m_wait_paint = std::chrono::steady_clock::now();
+    m_first_paint = std::chrono::milliseconds(-1);
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::RenderHandler::trim()
+{
+    // Dirty rectangles of the next paint are relative to a page the uploader
+    // no longer holds.
+    m_page_width = m_page_height = 0;
+    m_uploader.trim(m_target);
 }
 
 //------------------------------------------------------------------------------
@@ -110,6 +215,13 @@ void BrowserView::RenderHandler::reshape(int w, int h)
     m_height = h;
 }
 
+//------------------------------------------------------------------------------
+void BrowserView::RenderHandler::stretch(int w, int h)
+{
+    m_window_width = w;
+    m_window_height = h;
+}
+
 bool BrowserView::viewport(float x, float y, float w, float h)
 {
     if (!(x >= 0.0f) && (x < 1.0f))
@@ -141,7 +253,8 @@ bool BrowserView::viewport(float x, float y, float w, float h)
 //------------------------------------------------------------------------------
 void BrowserView::RenderHandler::GetViewRect(CefRefPtr<CefBrowser> browser, CefRect &rect)
 {
-    rect = CefRect(m_viewport[0], m_viewport[1], m_viewport[2] * m_width, m_viewport[3] * m_height);
+    glm::vec4 const& viewport = *m_viewport;
+    rect = CefRect(viewport[0], viewport[1], viewport[2] * m_width, viewport[3] * m_height);
 }
 
 //------------------------------------------------------------------------------
@@ -150,66 +263,604 @@ void BrowserView::RenderHandler::OnPaint(CefRefPtr<CefBrowser> browser, PaintEle
                                          int width, int height)
 {
     //std::cout << "BrowserView::RenderHandler::OnPaint" << std::endl;
-    GLCHECK(glActiveTexture(GL_TEXTURE0));
-    GLCHECK(glBindTexture(GL_TEXTURE_2D, m_tex));
-    GLCHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_BGRA_EXT,
-                         GL_UNSIGNED_BYTE, (unsigned char*)buffer));
-    GLCHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+    // Popup widgets (i.e. <select>) are not composited yet
+    if ((type != PET_VIEW) || (buffer == nullptr) || (width <= 0) || (height <= 0))
+        return ;
+
+    // When the page dimension changed, dirty rectangles are relative to a
+    // new layout so the whole page is uploaded.
+    std::vector<Rect> rects;
+    if ((width != m_page_width) || (height != m_page_height))
+    {
+        rects.push_back(Rect(0, 0, width, height));
+    }
+    else
+    {
+        for (auto const& rect: dirtyRects)
+        {
+            rects.push_back(Rect(rect.x, rect.y, rect.width, rect.height));
+        }
+    }
+    m_page_width = width;
+    m_page_height = height;
+    m_painted = true;
+    if (m_first_paint.count() < 0)
+    {
+        m_first_paint = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - m_wait_paint);
+        std::cout << "Browser " << browser->GetIdentifier() << " first paint in "
+                  << m_first_paint.count() << " ms" << std::endl;
+    }
+
+    // Opacity of transparent pages: when the page was opaque only the dirty
+    // rectangles can have changed that. Else the whole frame is scanned. Tiles
+    // are scanned on several cores and stop once a transparent one is found.
+    if (m_transparent)
+    {
+        std::vector<FrameTile> scanned;
+        if (m_opaque)
+        {
+            for (auto const& rect: rects)
+            {
+                scanned.push_back(FrameTile{ rect.x, rect.y, rect.w, rect.h });
+            }
+        }
+        else
+        {
+            scanned.push_back(FrameTile{ 0, 0, width, height });
+        }
+
+        m_scan.page = buffer;
+        m_scan.stride = size_t(width);
+        m_scan.opaque = true;
+        m_pipeline.process(scanned);
+        m_opaque = m_scan.opaque;
+    }
+
+    // Copy dirty rectangles: the upload thread puts them into the top-left
+    // corner of the texture.
+    m_uploader.upload(m_target, buffer, width, height, rects);
 }
 
 //------------------------------------------------------------------------------
-BrowserView::BrowserView(const std::string &url)
-    : m_mouse_x(0), m_mouse_y(0), m_viewport(0.0f, 0.0f, 1.0f, 1.0f)
+BrowserView::BrowserView(const std::string &url, TextureUploader& uploader,
+                         bool transparent, CefRefPtr<CefRequestContext> context)
+    : m_mouse_x(0), m_mouse_y(0), m_viewport(0.0f, 0.0f, 1.0f, 1.0f),
+      m_context(context)
 {
-    CefWindowInfo window_info;
-    window_info.SetAsWindowless(0);
-
-    m_render_handler = new RenderHandler(m_viewport);
+    m_render_handler = new RenderHandler(m_viewport, uploader, transparent);
     m_initialized = m_render_handler->init();
     m_render_handler->reshape(128, 128); // initial size
+    m_render_handler->stretch(128, 128);
+
+    m_client = new BrowserClient(this, m_render_handler);
+    if (url.empty())
+    {
+        m_deferred = true;
+        m_loading = false;
+    }
+    else
+    {
+        create(url);
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::create(const std::string &url)
+{
+    CefWindowInfo window_info;
+    window_info.SetAsWindowless(0);
+    m_creation = std::chrono::steady_clock::now();
+    m_url = url;
+    navigating(url);
+    // A new browser has no previous navigation
+    m_superseded.clear();
 
     CefBrowserSettings browserSettings;
-    browserSettings.windowless_frame_rate = 60; // 30 is default
+    browserSettings.windowless_frame_rate = FrameRate; // 30 is default
+    if (m_render_handler->transparent())
+    {
+        // Else CEF paints an opaque white background
+        browserSettings.background_color = CefColorSetARGB(0, 0, 0, 0);
+    }
 
-    m_client = new BrowserClient(m_render_handler);
-    m_browser = CefBrowserHost::CreateBrowserSync(window_info, m_client.get(),
-                                                  url, browserSettings,
-                                                  nullptr, nullptr);
+    // Do not block the window while Chromium starts the render process: the
+    // browser is given by OnAfterCreated().
+    if (!CefBrowserHost::CreateBrowser(window_info, m_client.get(), url,
+                                       browserSettings, nullptr, m_context))
+    {
+        std::cerr << "Failed creating the browser for " << url << std::endl;
+    }
 }
 
 //------------------------------------------------------------------------------
 BrowserView::~BrowserView()
 {
-    CefDoMessageLoopWork();
-    m_browser->GetHost()->CloseBrowser(true);
+    // A browser created after this point is closed by the client
+    m_client->m_view = nullptr;
+    for (auto& script: m_scripts)
+    {
+        script.second(nullptr, "view destroyed");
+    }
+    if (m_browser != nullptr)
+    {
+        ScriptRouter::global().cancel(m_browser->GetIdentifier(), "view destroyed");
+        CefDoMessageLoopWork();
+        m_browser->GetHost()->CloseBrowser(true);
+    }
 
     m_browser = nullptr;
     m_client = nullptr;
 }
 
+//------------------------------------------------------------------------------
+void BrowserView::BrowserClient::OnAfterCreated(CefRefPtr<CefBrowser> browser)
+{
+    if (m_view != nullptr)
+    {
+        m_view->created(browser);
+    }
+    else
+    {
+        browser->GetHost()->CloseBrowser(true);
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::BrowserClient::OnBeforeClose(CefRefPtr<CefBrowser> browser)
+{
+    ScriptRouter& scripts = ScriptRouter::global();
+    scripts.router()->OnBeforeClose(browser);
+    scripts.cancel(browser->GetIdentifier(), "browser closed");
+}
+
+//------------------------------------------------------------------------------
+bool BrowserView::BrowserClient::OnBeforeBrowse(CefRefPtr<CefBrowser> browser,
+                                                CefRefPtr<CefFrame> frame,
+                                                CefRefPtr<CefRequest> /*request*/,
+                                                bool /*user_gesture*/,
+                                                bool /*is_redirect*/)
+{
+    ScriptRouter& scripts = ScriptRouter::global();
+    scripts.router()->OnBeforeBrowse(browser, frame);
+    if (frame->IsMain())
+    {
+        scripts.cancel(browser->GetIdentifier(), "page unloaded");
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::BrowserClient::OnRenderProcessTerminated(CefRefPtr<CefBrowser> browser,
+                                                           TerminationStatus /*status*/)
+{
+    ScriptRouter& scripts = ScriptRouter::global();
+    scripts.router()->OnRenderProcessTerminated(browser);
+    scripts.cancel(browser->GetIdentifier(), "renderer terminated");
+}
+
+//------------------------------------------------------------------------------
+bool BrowserView::BrowserClient::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                                          CefRefPtr<CefFrame> frame,
+                                                          CefProcessId source_process,
+                                                          CefRefPtr<CefProcessMessage> message)
+{
+    return ScriptRouter::global().router()->OnProcessMessageReceived(
+        browser, frame, source_process, message);
+}
+
+//------------------------------------------------------------------------------
+CefRefPtr<CefResourceRequestHandler>
+BrowserView::BrowserClient::GetResourceRequestHandler(
+    CefRefPtr<CefBrowser> /*browser*/, CefRefPtr<CefFrame> /*frame*/,
+    CefRefPtr<CefRequest> /*request*/, bool /*is_navigation*/, bool /*is_download*/,
+    const CefString& /*request_initiator*/, bool& /*disable_default_handling*/)
+{
+    return m_filter;
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::BrowserClient::OnLoadingStateChange(CefRefPtr<CefBrowser> browser,
+                                                      bool isLoading, bool /*canGoBack*/,
+                                                      bool /*canGoForward*/)
+{
+    // Ignore browsers closed by hibernation
+    if ((m_view != nullptr) && (m_view->m_browser != nullptr) &&
+        m_view->m_browser->IsSame(browser))
+    {
+        m_view->m_loading = isLoading;
+    }
+    if (!isLoading)
+    {
+        m_filter->log(browser->GetIdentifier());
+    }
+}
+
+//------------------------------------------------------------------------------
+bool BrowserView::BrowserClient::current(CefRefPtr<CefBrowser> browser,
+                                         CefRefPtr<CefFrame> frame) const
+{
+    return (m_view != nullptr) && (m_view->m_browser != nullptr) &&
+           m_view->m_browser->IsSame(browser) && frame->IsMain();
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::BrowserClient::OnLoadStart(CefRefPtr<CefBrowser> browser,
+                                             CefRefPtr<CefFrame> frame,
+                                             TransitionType /*transition_type*/)
+{
+    if (current(browser, frame) && !m_view->superseded(frame->GetURL()))
+    {
+        m_view->m_committed = true;
+        m_view->m_superseded.clear();
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::BrowserClient::OnLoadEnd(CefRefPtr<CefBrowser> browser,
+                                           CefRefPtr<CefFrame> frame,
+                                           int /*httpStatusCode*/)
+{
+    if (current(browser, frame) && m_view->m_committed)
+    {
+        m_view->m_loaded = true;
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::BrowserClient::OnLoadError(CefRefPtr<CefBrowser> browser,
+                                             CefRefPtr<CefFrame> frame,
+                                             ErrorCode errorCode,
+                                             const CefString& errorText,
+                                             const CefString& failedUrl)
+{
+    // Aborted loads are replaced by another navigation
+    if ((errorCode != ERR_ABORTED) && current(browser, frame) &&
+        !m_view->superseded(failedUrl))
+    {
+        std::cerr << "Failed loading " << failedUrl.ToString() << ": "
+                  << errorText.ToString() << std::endl;
+        m_view->m_loaded = true;
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::created(CefRefPtr<CefBrowser> browser)
+{
+    m_browser = browser;
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - m_creation);
+    std::cout << "Browser " << browser->GetIdentifier() << " created in "
+              << elapsed.count() << " ms, replaying " << m_pending.size()
+              << " calls" << std::endl;
+
+    // The view size is queried by CEF, only the visibility has to be told
+    if (!m_visible)
+    {
+        m_browser->GetHost()->WasHidden(true);
+    }
+
+    std::vector<std::function<void()>> pending;
+    pending.swap(m_pending);
+    for (auto& call: pending)
+    {
+        call();
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::whenCreated(std::function<void()> call)
+{
+    // Loads and input are what uses a view
+    m_last_used = std::chrono::steady_clock::now();
+    wake();
+    if (m_browser != nullptr)
+    {
+        call();
+    }
+    else if (m_pending.size() < MAX_PENDING_CALLS)
+    {
+        m_pending.push_back(std::move(call));
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::input(std::function<void()> call)
+{
+    // Only loads wake a hibernated view: input is dropped
+    if (m_hibernated)
+        return ;
+
+    whenCreated(std::move(call));
+}
+
 //------------------------------------------------------------------------------
 void BrowserView::load(const std::string &url)
 {
     assert(m_initialized);
-    m_browser->GetMainFrame()->LoadURL(url);
+
+    // Loaded once woken up
+    if (m_hibernated)
+    {
+        m_url = url;
+        return ;
+    }
+
+    if (m_deferred)
+    {
+        m_deferred = false;
+        create(url);
+        return ;
+    }
+
+    navigating(url);
+    whenCreated([this, url]()
+    {
+        m_browser->GetMainFrame()->LoadURL(url);
+    });
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::navigating(std::string const& url)
+{
+    // Events of the previous navigation, if not ended, may still come after
+    // this one has been requested (i.e. about:blank of a pooled view).
+    m_superseded = m_loaded ? std::string() : m_navigation;
+    m_navigation = url;
+    m_committed = false;
+    m_loading = true;
+    m_loaded = false;
+    m_render_handler->waitFirstPaint();
+}
+
+//------------------------------------------------------------------------------
+bool BrowserView::superseded(std::string const& url) const
+{
+    return !m_superseded.empty() && (url == m_superseded) && (url != m_navigation);
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::eval(std::string const& script, ScriptRouter::Callback callback)
+{
+    m_last_used = std::chrono::steady_clock::now();
+    wake();
+    m_scripts.emplace_back(script, std::move(callback));
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::flushScripts()
+{
+    if (m_scripts.empty() || (m_browser == nullptr))
+        return ;
+
+    ScriptRouter::global().run(m_browser, m_scripts);
+    m_scripts.clear();
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::swap(BrowserView& other)
+{
+    assert(created() && other.created());
+
+    std::swap(m_browser, other.m_browser);
+    std::swap(m_client, other.m_client);
+    std::swap(m_render_handler, other.m_render_handler);
+    std::swap(m_context, other.m_context);
+    std::swap(m_loading, other.m_loading);
+    std::swap(m_loaded, other.m_loaded);
+    std::swap(m_committed, other.m_committed);
+    std::swap(m_navigation, other.m_navigation);
+    std::swap(m_superseded, other.m_superseded);
+    std::swap(m_creation, other.m_creation);
+    std::swap(m_url, other.m_url);
+
+    // CEF events and layouts follow the page
+    for (BrowserView* view: { this, &other })
+    {
+        view->m_client->m_view = view;
+        view->m_render_handler->viewport(view->m_viewport);
+        view->m_browser->GetHost()->WasHidden(!view->m_visible);
+        view->m_browser->GetHost()->WasResized();
+
+        // Redraw the whole area
+        view->m_drawn_visible = false;
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::frameRate(int fps)
+{
+    whenCreated([this, fps]()
+    {
+        m_browser->GetHost()->SetWindowlessFrameRate(fps);
+    });
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::repaint()
+{
+    m_render_handler->waitFirstPaint();
+    whenCreated([this]()
+    {
+        m_browser->GetHost()->Invalidate(PET_VIEW);
+    });
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::reset()
+{
+    // The next view using this browser shall not show the previous page
+    // until its own page paints.
+    m_render_handler->trim();
+    m_render_handler->placeholder();
+    load("about:blank");
+    visible(false);
+    m_viewport = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    m_zorder = 0;
+    m_fixed = true;
+    m_drawn_visible = false;
+}
+
+//------------------------------------------------------------------------------
+bool BrowserView::transparent() const
+{
+    return m_render_handler->transparent();
+}
+
+//------------------------------------------------------------------------------
+bool BrowserView::painted() const
+{
+    return m_render_handler->painted();
 }
 
 //------------------------------------------------------------------------------
-void BrowserView::draw()
+std::chrono::milliseconds BrowserView::firstPaint() const
 {
-    CefDoMessageLoopWork();
-    m_render_handler->draw(m_viewport, m_fixed);
+    return m_render_handler->firstPaint();
+}
+
+//------------------------------------------------------------------------------
+bool BrowserView::hibernate()
+{
+    if (m_hibernated || (m_browser == nullptr))
+        return false;
+
+    // CEF cannot restore the navigation history of a new browser: only the
+    // current page is kept.
+    m_url = m_browser->GetMainFrame()->GetURL();
+    m_hibernated = true;
+
+    m_render_handler->trim();
+    ScriptRouter::global().cancel(m_browser->GetIdentifier(), "page hibernated");
+    m_browser->GetHost()->CloseBrowser(true);
+    m_browser = nullptr;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+std::chrono::steady_clock::time_point BrowserView::lastUsed() const
+{
+    return m_visible ? std::chrono::steady_clock::now() : m_last_used;
+}
+
+//------------------------------------------------------------------------------
+size_t BrowserView::textureBytes() const
+{
+    return m_render_handler->bytes();
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::trim()
+{
+    m_render_handler->trim();
+}
+
+//------------------------------------------------------------------------------
+std::string BrowserView::url() const
+{
+    if (m_browser != nullptr)
+        return m_browser->GetMainFrame()->GetURL();
+    return m_url;
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::wake()
+{
+    if (!m_hibernated)
+        return ;
+
+    m_hibernated = false;
+    create(m_url);
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::draw(float depth)
+{
+    m_render_handler->draw(m_viewport, m_fixed, depth);
+}
+
+//------------------------------------------------------------------------------
+Rect BrowserView::area() const
+{
+    return m_render_handler->area(m_viewport);
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::visible(bool visible)
+{
+    if (visible == m_visible)
+        return ;
+
+    m_visible = visible;
+    if (!visible)
+    {
+        m_last_used = std::chrono::steady_clock::now();
+    }
+
+    if (visible && m_hibernated)
+    {
+        wake();
+    }
+    else if (m_browser != nullptr)
+    {
+        m_browser->GetHost()->WasHidden(!visible);
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::damage(Region& damage)
+{
+    const Rect rect = area();
+    const bool opaque = this->opaque();
+
+    if ((rect != m_drawn_area) || (m_visible != m_drawn_visible) ||
+        (m_zorder != m_drawn_zorder) || (opaque != m_drawn_opaque) || !m_fixed)
+    {
+        if (m_drawn_visible)
+        {
+            damage.add(m_drawn_area);
+        }
+        if (m_visible)
+        {
+            damage.add(rect);
+        }
+    }
+
+    // Painted rectangles are consumed even when the view is hidden: mapped
+    // onto an empty area they damage nothing.
+    m_render_handler->damage(m_visible ? rect : Rect(), damage);
+
+    m_drawn_area = rect;
+    m_drawn_visible = m_visible;
+    m_drawn_zorder = m_zorder;
+    m_drawn_opaque = opaque;
+}
+
+//------------------------------------------------------------------------------
+bool BrowserView::opaque() const
+{
+    return m_render_handler->opaque();
 }
 
 //------------------------------------------------------------------------------
 void BrowserView::reshape(int w, int h)
 {
+    m_render_handler->stretch(w, h);
     m_render_handler->reshape(w, h);
-    GLCHECK(glViewport(m_viewport[0],
-                       m_viewport[1],
-                       GLsizei(m_viewport[2] * w),
-                       GLsizei(m_viewport[3] * h)));
-    m_browser->GetHost()->WasResized();
+
+    // Not yet created: CEF will query the new size
+    if (m_browser != nullptr)
+    {
+        m_browser->GetHost()->WasResized();
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserView::stretch(int w, int h)
+{
+    m_render_handler->stretch(w, h);
 }
 
 //------------------------------------------------------------------------------
@@ -223,7 +874,10 @@ void BrowserView::mouseMove(int x, int y)
     evt.y = y;
 
     bool mouse_leave = false; // TODO
-    m_browser->GetHost()->SendMouseMoveEvent(evt, mouse_leave);
+    input([this, evt, mouse_leave]()
+    {
+        m_browser->GetHost()->SendMouseMoveEvent(evt, mouse_leave);
+    });
 }
 
 //------------------------------------------------------------------------------
@@ -234,7 +888,10 @@ void BrowserView::mouseClick(CefBrowserHost::MouseButtonType btn, bool mouse_up)
     evt.y = m_mouse_y;
 
     int click_count = 1; // TODO
-    m_browser->GetHost()->SendMouseClickEvent(evt, btn, mouse_up, click_count);
+    input([this, evt, btn, mouse_up, click_count]()
+    {
+        m_browser->GetHost()->SendMouseClickEvent(evt, btn, mouse_up, click_count);
+    });
 }
 
 //------------------------------------------------------------------------------
@@ -245,5 +902,8 @@ void BrowserView::keyPress(int key, bool pressed)
     evt.native_key_code = key;
     evt.type = pressed ? KEYEVENT_CHAR : KEYEVENT_KEYUP;
 
-    m_browser->GetHost()->SendKeyEvent(evt);
+    input([this, evt]()
+    {
+        m_browser->GetHost()->SendKeyEvent(evt);
+    });
 }
@@ -14,6 +14,19 @@
 #  include <glm/glm.hpp>
 #  include <glm/ext.hpp>
 
+// Upload pages into recycled OpenGL textures
+#  include "TextureUploader.hpp"
+// Area covered on the window
+#  include "Region.hpp"
+// Parallel processing of painted pages
+#  include "FramePipeline.hpp"
+// Memory budget
+#  include "MemoryGovernor.hpp"
+// Blocked and shared requests
+#  include "RequestFilter.hpp"
+// Scripts evaluated by batches
+#  include "ScriptRouter.hpp"
+
 // Chromium Embedded Framework
 #  include <cef_render_handler.h>
 #  include <cef_client.h>
@@ -23,29 +36,147 @@
 #  include <vector>
 #  include <memory>
 #  include <algorithm>
+#  include <chrono>
+#  include <functional>
 
 // ****************************************************************************
 //! \brief Interface class rendering a single web page.
 // ****************************************************************************
-class BrowserView
+class BrowserView: public MemoryGovernor::View
 {
 public:
 
-    //! \brief Default Constructor using a given URL.
-    BrowserView(const std::string &url);
+    //! \brief Default Constructor using a given URL. Pages are uploaded into
+    //! textures by the given uploader. A transparent view has no
+    //! default background: pages not painting one are blended over the views
+    //! behind it. The browser is created asynchronously: a placeholder is
+    //! drawn until its first page is painted and calls needing the browser
+    //! are replayed once it exists. Cookies and caches are the ones of the
+    //! given request context (the global one when nullptr). With an empty URL
+    //! the browser is only created by the first load().
+    BrowserView(const std::string &url, TextureUploader& uploader,
+                bool transparent = false,
+                CefRefPtr<CefRequestContext> context = nullptr);
 
     //! \brief
     ~BrowserView();
 
-    //! \brief Load the given web page.
+    //! \brief Load the given web page in place: the current page is replaced
+    //! as soon as the new one paints. See Prerenderer to show it once loaded.
     void load(const std::string &url);
 
-    //! \brief Render the web page.
-    void draw();
+    //! \brief Exchange the pages (browser, textures, URL, loading state) of
+    //! the two views. Viewports, z-orders, animations and visibility stay with
+    //! the views. Both browsers shall be created.
+    void swap(BrowserView& other);
+
+    //! \brief Set the maximum number of paints per second of the browser.
+    void frameRate(int fps);
+
+    //! \brief Ask CEF to paint the whole page again: firstPaint() is measured
+    //! from now.
+    void repaint();
+
+    //! \brief Request context given at the creation (nullptr: global one).
+    inline CefRefPtr<CefRequestContext> context() const
+    {
+        return m_context;
+    }
+
+    //! \brief Default frame rate of browsers.
+    static int FrameRate;
+
+    //! \brief Go back to a hidden about:blank page with the default
+    //! viewport, z-order and animation, ready to be reused by another view.
+    //! The placeholder is drawn until the next paint. The navigation history
+    //! is kept by CEF.
+    void reset();
+
+    //! \brief Return true if the view has been created transparent.
+    bool transparent() const;
+
+    //! \brief Return true once CEF has created the browser.
+    inline bool created() const
+    {
+        return m_browser != nullptr;
+    }
+
+    //! \brief Return true once CEF has painted a page: before, a placeholder
+    //! is drawn.
+    bool painted() const;
+
+    //! \brief Time between the last creation of the browser and its first
+    //! paint, negative until painted.
+    std::chrono::milliseconds firstPaint() const;
+
+    //! \brief Requests of the browser.
+    inline RequestFilter const& requests() const
+    {
+        return *m_client->m_filter;
+    }
+
+    //! \brief Return true while the page or its resources are loading.
+    inline bool loading() const
+    {
+        return m_loading;
+    }
+
+    //! \brief Return true once the main frame of the last page loaded has
+    //! ended loading, successfully or not.
+    inline bool loaded() const
+    {
+        return m_loaded;
+    }
+
+    //! \brief Close the browser to free its render process, keeping the last
+    //! page as a snapshot and its URL. The browser is created again, showing
+    //! the snapshot until its first paint, when the view is shown or gets
+    //! input.
+    //! \return false if the browser is not created yet or already closed.
+    virtual bool hibernate() override;
 
-    //! \brief Set the windows size.
+    //! \brief Return true if the browser has been closed by hibernate().
+    inline bool hibernated() const
+    {
+        return m_hibernated;
+    }
+
+    //! \brief URL of the current page, or of the page to load once the
+    //! browser is created.
+    std::string url() const;
+
+    //! \brief Last time the view has been shown or got input (now when
+    //! visible).
+    virtual std::chrono::steady_clock::time_point lastUsed() const override;
+
+    //! \brief Browser, nullptr while not created or hibernated.
+    virtual CefRefPtr<CefBrowser> browser() const override
+    {
+        return m_browser;
+    }
+
+    //! \brief GPU and CPU memory holding the page.
+    virtual size_t textureBytes() const override;
+
+    //! \brief Keep only the texture being drawn.
+    virtual void trim() override;
+
+    //! \brief Render the web page. \c depth orders views on the window:
+    //! in [-1 .. 1], the lower the more in front.
+    void draw(float depth);
+
+    //! \brief Return true if the last frame of the web page has no
+    //! transparent pixel. Opaque views are drawn without blending.
+    bool opaque() const;
+
+    //! \brief Set the windows size and make CEF re-layout the page to it.
     void reshape(int w, int h);
 
+    //! \brief Set the windows size without notifying CEF: the last frame is
+    //! drawn stretched to it until reshape() is called. Cheap enough to be
+    //! called for every event while the window is being resized.
+    void stretch(int w, int h);
+
     //! \brief Set the viewport: the rectangle on the window where to display
     //! the web document.
     //! \return false if arguments are incorrect.
@@ -57,8 +188,49 @@ public:
         return m_viewport;
     }
 
-    //! \brief TODO
-    // void executeJS(const std::string &cmd);
+    //! \brief Rectangle covered by the viewport on the window, in pixels.
+    Rect area() const;
+
+    //! \brief Set the stacking order on the window: views with a greater
+    //! z-order are drawn in front of the others. Views with the same
+    //! z-order are stacked in their creation order.
+    inline void zorder(int z)
+    {
+        m_zorder = z;
+    }
+
+    //! \brief Get the stacking order on the window.
+    inline int zorder() const
+    {
+        return m_zorder;
+    }
+
+    //! \brief Show or hide the view. Hidden views are not drawn and CEF
+    //! stops painting them until they are shown again.
+    void visible(bool visible);
+
+    //! \brief Return false if the view has been hidden.
+    virtual bool visible() const override
+    {
+        return m_visible;
+    }
+
+    //! \brief Add to \c damage the window pixels changed since the last call:
+    //! parts of the page painted by CEF, or the whole old and new areas of
+    //! the view when it moved, got shown or hidden, changed its z-order or
+    //! opacity. Rotating views damage their whole area on each frame.
+    void damage(Region& damage);
+
+    //! \brief Evaluate the JavaScript expression in the main frame of the page
+    //! and call back with its value (see ScriptRouter). Scripts are queued
+    //! and sent together by flushScripts(), once the browser exists.
+    //! Callbacks are called from CefDoMessageLoopWork(), with an error if the
+    //! page navigates, crashes, is closed or has not answered after 5 seconds.
+    void eval(std::string const& script, ScriptRouter::Callback callback);
+
+    //! \brief Send the scripts queued by eval() as a single batch. Called
+    //! once per frame.
+    void flushScripts();
 
     //! \brief Set the new mouse position
     void mouseMove(int x, int y);
@@ -78,7 +250,8 @@ private:
     {
     public:
 
-        RenderHandler(glm::vec4 const& viewport);
+        RenderHandler(glm::vec4 const& viewport, TextureUploader& uploader,
+                      bool transparent);
 
         //! \brief
         ~RenderHandler();
@@ -87,16 +260,78 @@ private:
         //! VBO, texture, locations ...)
         bool init();
 
-        //! \brief Render OpenGL VAO (rotating a textured square)
-        void draw(glm::vec4 const& viewport, bool fixed);
+        //! \brief Render OpenGL VAO (rotating a textured square). Opaque
+        //! pages use a shader without blending, transparent ones a shader
+        //! outputting premultiplied alpha: blending state is set by the
+        //! caller since it depends on the other views.
+        void draw(glm::vec4 const& viewport, bool fixed, float depth);
+
+        //! \brief Return true if the page has no transparent pixel.
+        inline bool opaque() const
+        {
+            return m_opaque;
+        }
+
+        //! \brief Return true if the page has no default background.
+        inline bool transparent() const
+        {
+            return m_transparent;
+        }
+
+        //! \brief Return true once CEF has painted a page.
+        inline bool painted() const
+        {
+            return m_painted;
+        }
+
+        //! \brief Keep only the texture being drawn: the next paint is
+        //! uploaded as a whole page.
+        void trim();
+
+        //! \brief Memory used by the textures and the copy of the page.
+        inline size_t bytes() const
+        {
+            return m_target->bytes();
+        }
+
+        //! \brief Measure the time to the next paint from now.
+        void waitFirstPaint();
+
+        //! \brief Draw the placeholder instead of the page until the next
+        //! paint.
+        void placeholder();
+
+        //! \brief Follow the viewport of the view owning the handler.
+        inline void viewport(glm::vec4 const& viewport)
+        {
+            m_viewport = &viewport;
+        }
+
+        //! \brief Time between waitFirstPaint() and the paint following it,
+        //! negative until painted.
+        inline std::chrono::milliseconds firstPaint() const
+        {
+            return m_first_paint;
+        }
 
-        //! \brief Resize the view
+        //! \brief Rectangle covered by the viewport on the window.
+        Rect area(glm::vec4 const& viewport) const;
+
+        //! \brief Switch to the last uploaded page and add to \c damage the
+        //! page rectangles changed since the last call, mapped onto the
+        //! window rectangle \c area.
+        void damage(Rect const& area, Region& damage);
+
+        //! \brief Resize the view given to CEF
         void reshape(int w, int h);
 
+        //! \brief Resize the window the view is drawn on
+        void stretch(int w, int h);
+
         //! \brief Return the OpenGL texture handle
         GLuint texture() const
         {
-            return m_tex;
+            return m_target->front().id;
         }
 
         //! \brief CefRenderHandler interface
@@ -113,42 +348,95 @@ private:
 
     private:
 
-        //! \brief Dimension
-        int m_width;
-        int m_height;
+        //! \brief Dimension of the view given to CEF
+        int m_width = 0;
+        int m_height = 0;
+
+        //! \brief Dimension of the window the view is drawn on
+        int m_window_width = 0;
+        int m_window_height = 0;
 
         //! \brief Where to draw on the OpenGL window
-        glm::vec4 const& m_viewport;
+        glm::vec4 const* m_viewport;
+
+        //! \brief Upload painted pages into m_target from its own thread.
+        TextureUploader& m_uploader;
+        //! \brief OpenGL textures holding the page in their top-left corner.
+        std::shared_ptr<UploadTarget> m_target;
+        //! \brief Dimension of the last painted page.
+        GLsizei m_page_width = 0;
+        GLsizei m_page_height = 0;
+        //! \brief Page rectangles uploaded and not yet drawn.
+        std::vector<Rect> m_dirty;
+
+        //! \brief Process painted pages on several cores.
+        FramePipeline m_pipeline;
+        //! \brief Page being scanned for transparent pixels by m_pipeline.
+        struct Scan
+        {
+            const void* page = nullptr;
+            size_t stride = 0u;
+            std::atomic<bool> opaque{true};
+        } m_scan;
+
+        // *********************************************************************
+        //! \brief OpenGL shader program handle and its uniform locations.
+        // *********************************************************************
+        struct Program
+        {
+            //! \brief Compile the program and get uniform locations.
+            bool init(const char* frag);
+
+            GLuint id = 0;
+            //! \brief Location of the texture
+            GLint tex_loc = -1;
+            //! \brief Location of the Model View Projection matrix.
+            GLint mvp_loc = -1;
+            //! \brief Location of the part of the texture holding the page.
+            GLint texscale_loc = -1;
+            //! \brief Location of the depth of the view.
+            GLint depth_loc = -1;
+        };
+
+        //! \brief Program for opaque pages: no blending, no discard so early
+        //! depth test keeps working.
+        Program m_opaque_prog;
+        //! \brief Program for transparent pages: premultiplied alpha.
+        Program m_blend_prog;
+
+        //! \brief The page has been created with a transparent background.
+        //! Else it is always opaque and frames are not scanned.
+        bool m_transparent;
+        //! \brief The last frame has no transparent pixel.
+        bool m_opaque;
+        //! \brief The placeholder has been replaced by a page painted by CEF.
+        bool m_painted = false;
+        //! \brief When waitFirstPaint() has been called and the time to the
+        //! paint following it.
+        std::chrono::steady_clock::time_point m_wait_paint;
+        std::chrono::milliseconds m_first_paint{-1};
 
-        //! \brief OpenGL shader program handle
-        GLuint m_prog = 0;
-        //! \brief OpenGL texture handle
-        GLuint m_tex = 0;
         //! \brief OpenGL vertex array object handle
         GLuint m_vao = 0;
         //! \brief OpenGL vertex buffer obejct handle
         GLuint m_vbo = 0;
 
         //! \brief OpenGL shader variable locations for vertices of the
-        //! rectangle
+        //! rectangle (shared by both programs)
         GLint m_pos_loc = -1;
-        //! \brief OpenGL shader variable locations for the texture
-        GLint m_tex_loc = -1;
-        //! \brief OpenGL shader variable locations for the Model View
-        //! Projection matrix.
-        GLint m_mvp_loc = -1;
     };
 
     // *************************************************************************
     //! \brief Provide access to browser-instance-specific callbacks. A single
     //! CefClient instance can be shared among any number of browsers.
     // *************************************************************************
-    class BrowserClient: public CefClient
+    class BrowserClient: public CefClient, public CefLifeSpanHandler,
+                         public CefLoadHandler, public CefRequestHandler
     {
     public:
 
-        BrowserClient(CefRefPtr<CefRenderHandler> ptr)
-            : m_renderHandler(ptr)
+        BrowserClient(BrowserView* view, CefRefPtr<CefRenderHandler> ptr)
+            : m_view(view), m_renderHandler(ptr)
         {}
 
         virtual CefRefPtr<CefRenderHandler> GetRenderHandler() override
@@ -156,11 +444,112 @@ private:
             return m_renderHandler;
         }
 
+        virtual CefRefPtr<CefLifeSpanHandler> GetLifeSpanHandler() override
+        {
+            return this;
+        }
+
+        virtual CefRefPtr<CefLoadHandler> GetLoadHandler() override
+        {
+            return this;
+        }
+
+        virtual CefRefPtr<CefRequestHandler> GetRequestHandler() override
+        {
+            return this;
+        }
+
+        //! \brief CefRequestHandler interface: block requests and share
+        //! responses with other browsers (called on the IO thread).
+        virtual CefRefPtr<CefResourceRequestHandler> GetResourceRequestHandler(
+            CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
+            CefRefPtr<CefRequest> request, bool is_navigation, bool is_download,
+            const CefString& request_initiator, bool& disable_default_handling) override;
+
+        //! \brief CefLifeSpanHandler interface: give the browser to the view,
+        //! or close it if the view has been destroyed meanwhile.
+        virtual void OnAfterCreated(CefRefPtr<CefBrowser> browser) override;
+
+        //! \brief CefLifeSpanHandler interface: fail its waiting scripts.
+        virtual void OnBeforeClose(CefRefPtr<CefBrowser> browser) override;
+
+        //! \brief CefRequestHandler interface: a new page of the main frame
+        //! will not answer the scripts sent to the previous one.
+        virtual bool OnBeforeBrowse(CefRefPtr<CefBrowser> browser,
+                                    CefRefPtr<CefFrame> frame,
+                                    CefRefPtr<CefRequest> request,
+                                    bool user_gesture, bool is_redirect) override;
+
+        //! \brief CefRequestHandler interface: fail the waiting scripts.
+        virtual void OnRenderProcessTerminated(CefRefPtr<CefBrowser> browser,
+                                               TerminationStatus status) override;
+
+        //! \brief CefClient interface: results of scripts.
+        virtual bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                              CefRefPtr<CefFrame> frame,
+                                              CefProcessId source_process,
+                                              CefRefPtr<CefProcessMessage> message) override;
+
+        //! \brief CefLoadHandler interface: track the loading state.
+        virtual void OnLoadingStateChange(CefRefPtr<CefBrowser> browser,
+                                          bool isLoading, bool canGoBack,
+                                          bool canGoForward) override;
+
+        //! \brief CefLoadHandler interface: the main frame committed the
+        //! navigation requested last.
+        virtual void OnLoadStart(CefRefPtr<CefBrowser> browser,
+                                 CefRefPtr<CefFrame> frame,
+                                 TransitionType transition_type) override;
+
+        //! \brief CefLoadHandler interface: the main frame has loaded.
+        virtual void OnLoadEnd(CefRefPtr<CefBrowser> browser,
+                               CefRefPtr<CefFrame> frame,
+                               int httpStatusCode) override;
+
+        //! \brief CefLoadHandler interface: the main frame failed loading.
+        virtual void OnLoadError(CefRefPtr<CefBrowser> browser,
+                                 CefRefPtr<CefFrame> frame,
+                                 ErrorCode errorCode,
+                                 const CefString& errorText,
+                                 const CefString& failedUrl) override;
+
+        //! \brief Return true if the frame is the main one of the current
+        //! browser of the view.
+        bool current(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame) const;
+
+        //! \brief View owning the client. Reset when the view is destroyed.
+        BrowserView* m_view;
         CefRefPtr<CefRenderHandler> m_renderHandler;
+        CefRefPtr<RequestFilter> m_filter = new RequestFilter();
 
         IMPLEMENT_REFCOUNTING(BrowserClient);
     };
 
+    //! \brief Request CEF to create the browser for the given URL.
+    void create(const std::string &url);
+
+    //! \brief Create again the browser closed by hibernate().
+    void wake();
+
+    //! \brief The given URL is requested: loaded() becomes true once it ends.
+    void navigating(std::string const& url);
+
+    //! \brief Return true if the URL is the one of the navigation replaced by
+    //! the last one.
+    bool superseded(std::string const& url) const;
+
+    //! \brief Called by BrowserClient once CEF created the browser: replay
+    //! pending calls.
+    void created(CefRefPtr<CefBrowser> browser);
+
+    //! \brief Run the given call on the browser now if it exists, else once
+    //! created.
+    void whenCreated(std::function<void()> call);
+
+    //! \brief Run the input call like whenCreated(), but drop it if the view
+    //! is hibernated instead of waking it up.
+    void input(std::function<void()> call);
+
 private:
 
     //! \brief Mouse cursor position on the OpenGL window
@@ -178,6 +567,50 @@ private:
     //! \brief OpenGL has created GPU elements with success
     bool m_initialized = false;
 
+    //! \brief Cookies and caches of the browser (nullptr: global ones).
+    CefRefPtr<CefRequestContext> m_context;
+
+    //! \brief The page or its resources are loading.
+    bool m_loading = true;
+    //! \brief The main frame of the last page has ended loading.
+    bool m_loaded = false;
+    //! \brief The main frame has started loading the last page: load ends
+    //! before belong to a previous navigation.
+    bool m_committed = false;
+    //! \brief URL of the last navigation requested.
+    std::string m_navigation;
+    //! \brief URL of the navigation not ended when the last one was
+    //! requested: its events are ignored. Empty once the last one started.
+    std::string m_superseded;
+    //! \brief Created with an empty URL: the browser is created by load().
+    bool m_deferred = false;
+
+    //! \brief Calls waiting for the browser to be created.
+    std::vector<std::function<void()>> m_pending;
+    //! \brief Scripts queued by eval() since the last flushScripts().
+    ScriptRouter::Scripts m_scripts;
+    //! \brief When the browser creation has been requested.
+    std::chrono::steady_clock::time_point m_creation;
+
+    //! \brief The browser has been closed by hibernate(). m_url holds the
+    //! page to load when it is created again.
+    bool m_hibernated = false;
+    std::string m_url;
+    //! \brief Last time the view has been hidden or got input.
+    std::chrono::steady_clock::time_point m_last_used;
+
+    //! \brief Stacking order on the window.
+    int m_zorder = 0;
+
+    //! \brief CEF has not been told the view is hidden.
+    bool m_visible = true;
+
+    //! \brief State of the view when damage() was last called.
+    Rect m_drawn_area;
+    int m_drawn_zorder = 0;
+    bool m_drawn_visible = false;
+    bool m_drawn_opaque = false;
+
 public:
 
     //! \brief If set to false then the web page is turning.
@@ -3,6 +3,29 @@
 
 #include "CEFGLWindow.hpp"
 #include "GLCore.hpp"
+#include "ProcessMemory.hpp"
+#include "BrowserCache.hpp"
+#include "Blocklist.hpp"
+#include "ResponseCache.hpp"
+
+//! \brief Above this number of damaged rectangles, their bounding box is
+//! redrawn instead.
+static const size_t MAX_DAMAGE_RECTS = 8u;
+
+//! \brief Number of browser views kept ready for createBrowser().
+static const size_t BROWSER_POOL_SIZE = 2u;
+
+//! \brief Views hidden for longer are hibernated.
+static const std::chrono::seconds HIBERNATION_DELAY(30);
+
+//! \brief Delay for the render process of a hibernated view to exit.
+static const std::chrono::seconds HIBERNATION_REPORT_DELAY(2);
+
+//! \brief Warm-up views still loading after this delay are closed.
+static const std::chrono::seconds WARM_UP_TIMEOUT(20);
+
+//! \brief The benchmark gives up on views not painted after this delay.
+static const std::chrono::seconds BENCHMARK_TIMEOUT(60);
 
 //------------------------------------------------------------------------------
 //! \brief Callback when the OpenGL base window has been resized. Dispatch this
@@ -13,48 +36,36 @@ static void reshape_callback(GLFWwindow* ptr, int w, int h)
     assert(nullptr != ptr);
     CEFGLWindow* window = static_cast<CEFGLWindow*>(glfwGetWindowUserPointer(ptr));
 
-    // Send screen size to browsers
-    for (auto it: window->browsers())
-    {
-        it->reshape(w, h);
-    }
+    window->resize(w, h);
 }
 
 //------------------------------------------------------------------------------
 //! \brief Callback when the mouse has clicked inside the OpenGL base window.
-//! Dispatch this event to all BrowserView.
+//! Dispatch this event to the view under the cursor.
 //------------------------------------------------------------------------------
 static void mouse_callback(GLFWwindow* ptr, int btn, int state, int /*mods*/)
 {
     assert(nullptr != ptr);
     CEFGLWindow* window = static_cast<CEFGLWindow*>(glfwGetWindowUserPointer(ptr));
 
-    // Send mouse click to browsers
-    for (auto it: window->browsers())
-    {
-        it->mouseClick(CefBrowserHost::MouseButtonType(btn), state == GLFW_PRESS);
-    }
+    window->mouseClick(CefBrowserHost::MouseButtonType(btn), state == GLFW_PRESS);
 }
 
 //------------------------------------------------------------------------------
 //! \brief Callback when the mouse has been displaced inside the OpenGL base
-//! window. Dispatch this event to all BrowserView.
+//! window. Dispatch this event to the view under the cursor.
 //------------------------------------------------------------------------------
 static void motion_callback(GLFWwindow* ptr, double x, double y)
 {
     assert(nullptr != ptr);
     CEFGLWindow* window = static_cast<CEFGLWindow*>(glfwGetWindowUserPointer(ptr));
 
-    // Send mouse movement to browsers
-    for (auto it: window->browsers())
-    {
-        it->mouseMove((int) x, (int) y);
-    }
+    window->mouseMove((int) x, (int) y);
 }
 
 //------------------------------------------------------------------------------
 //! \brief Callback when the keybaord has been pressed inside the OpenGL base
-//! window. Dispatch this event to all BrowserView.
+//! window. Dispatch this event to the view having the keyboard focus.
 //------------------------------------------------------------------------------
 static void keyboard_callback(GLFWwindow* ptr, int key, int /*scancode*/,
                               int action, int /*mods*/)
@@ -62,16 +73,13 @@ static void keyboard_callback(GLFWwindow* ptr, int key, int /*scancode*/,
     assert(nullptr != ptr);
     CEFGLWindow* window = static_cast<CEFGLWindow*>(glfwGetWindowUserPointer(ptr));
 
-    // Send key press to browsers
-    for (auto it: window->browsers())
-    {
-        it->keyPress(key, (action == GLFW_PRESS));
-    }
+    window->keyPress(key, (action == GLFW_PRESS));
 }
 
 //------------------------------------------------------------------------------
 CEFGLWindow::CEFGLWindow(uint32_t const width, uint32_t const height, const char *title)
-    : GLWindow(width, height, title)
+    : GLWindow(width, height, title), m_uploader(m_texture_pool),
+      m_pool(m_uploader, BROWSER_POOL_SIZE), m_prerender(m_pool, m_uploader)
 {
     std::cout << __PRETTY_FUNCTION__ << std::endl;
 }
@@ -80,19 +88,58 @@ CEFGLWindow::CEFGLWindow(uint32_t const width, uint32_t const height, const char
 CEFGLWindow::~CEFGLWindow()
 {
     m_browsers.clear();
+    m_scheduler.clear();
+    m_warming.clear();
+    m_prerender.clear();
+    m_pool.clear();
+    BrowserCache::global().clear();
     CefShutdown();
 }
 
 //------------------------------------------------------------------------------
-std::weak_ptr<BrowserView> CEFGLWindow::createBrowser(const std::string &url)
+void CEFGLWindow::resize(int width, int height)
 {
-    auto web_core = std::make_shared<BrowserView>(url);
+    m_width = uint32_t(width);
+    m_height = uint32_t(height);
+    m_resize.request(width, height);
+
+    // Keep drawing the last frames stretched to the new size
+    for (auto it: m_browsers)
+    {
+        it->stretch(width, height);
+    }
+}
+
+//------------------------------------------------------------------------------
+std::weak_ptr<BrowserView> CEFGLWindow::createBrowser(const std::string &url,
+                                                      bool transparent)
+{
+    // Transparency and request context are set when the browser is created:
+    // pooled views are opaque and use the global context. Scheduled views get
+    // no URL: browsers are created or navigated by the scheduler.
+    const std::string first = m_scheduler.enabled() ? std::string() : url;
+    CefRefPtr<CefRequestContext> context =
+        BrowserCache::global().context("view-" + std::to_string(m_created++));
+    std::shared_ptr<BrowserView> web_core;
+    if (!transparent && (context == nullptr))
+    {
+        web_core = m_pool.acquire(first);
+    }
+    if (web_core == nullptr)
+    {
+        web_core = std::make_shared<BrowserView>(first, m_uploader, transparent, context);
+    }
+    web_core->reshape(int(m_width), int(m_height));
+    if (m_scheduler.enabled())
+    {
+        m_scheduler.schedule(web_core, url);
+    }
     m_browsers.push_back(web_core);
     return web_core;
 }
 
 //------------------------------------------------------------------------------
-void CEFGLWindow::removeBrowser(std::weak_ptr<BrowserView> web_core)
+void CEFGLWindow::removeBrowser(std::weak_ptr<BrowserView> web_core, bool recycle)
 {
     auto elem = web_core.lock();
     if (elem)
@@ -100,9 +147,149 @@ void CEFGLWindow::removeBrowser(std::weak_ptr<BrowserView> web_core)
         auto found = std::find(m_browsers.begin(), m_browsers.end(), elem);
         if (found != m_browsers.end())
         {
+            if (elem->visible())
+            {
+                m_damage.add(elem->area());
+            }
             m_browsers.erase(found);
+            if (recycle)
+            {
+                m_pool.recycle(elem);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void CEFGLWindow::navigate(std::weak_ptr<BrowserView> view, const std::string &url,
+                           bool prerender)
+{
+    auto elem = view.lock();
+    if (elem == nullptr)
+        return ;
+
+    if (prerender)
+    {
+        m_prerender.navigate(elem, url);
+    }
+    else
+    {
+        elem->load(url);
+    }
+}
+
+//------------------------------------------------------------------------------
+bool CEFGLWindow::speculate(const std::string &url)
+{
+    return m_prerender.speculate(url);
+}
+
+//------------------------------------------------------------------------------
+void CEFGLWindow::mouseMove(int x, int y)
+{
+    if (BrowserView* view = focused())
+    {
+        view->mouseMove(x, y);
+    }
+}
+
+//------------------------------------------------------------------------------
+void CEFGLWindow::mouseClick(CefBrowserHost::MouseButtonType btn, bool mouse_up)
+{
+    BrowserView* view = focused();
+    m_keyboard.reset();
+    for (auto const& it: m_browsers)
+    {
+        if (it.get() == view)
+        {
+            m_keyboard = it;
+        }
+    }
+
+    if (view != nullptr)
+    {
+        view->mouseClick(btn, mouse_up);
+    }
+}
+
+//------------------------------------------------------------------------------
+void CEFGLWindow::keyPress(int key, bool pressed)
+{
+    auto view = m_keyboard.lock();
+    if ((view != nullptr) && view->visible())
+    {
+        view->keyPress(key, pressed);
+    }
+}
+
+//------------------------------------------------------------------------------
+BrowserView* CEFGLWindow::focused() const
+{
+    double x, y;
+    glfwGetCursorPos(m_window, &x, &y);
+
+    // View areas have their origin at the bottom-left corner of the window
+    const int px = int(x);
+    const int py = int(m_height) - int(y);
+    for (size_t i = m_stack.size(); i-- > 0u; )
+    {
+        const Rect area = m_stack[i]->area();
+        if ((px >= area.x) && (px < area.right()) && (py >= area.y) && (py < area.top()))
+            return m_stack[i];
+    }
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------
+void CEFGLWindow::cull()
+{
+    // Back to front. Stable sort: views with the same z-order stay in their
+    // creation order.
+    m_stack.clear();
+    for (auto const& it: m_browsers)
+    {
+        m_stack.push_back(it.get());
+    }
+    std::stable_sort(m_stack.begin(), m_stack.end(),
+                     [](BrowserView const* a, BrowserView const* b)
+                     {
+                         return a->zorder() < b->zorder();
+                     });
+
+    // Front to back: a view is visible if it still has a pixel not covered by
+    // the opaque views in front of it. Rotating views do not fill their
+    // viewport so they never hide others.
+    m_uncovered.clear();
+    m_uncovered.add(Rect(0, 0, int(m_width), int(m_height)));
+    for (size_t i = m_stack.size(); i-- > 0u; )
+    {
+        BrowserView* view = m_stack[i];
+        const Rect area = view->area();
+
+        bool visible = false;
+        for (auto const& rect: m_uncovered.rects())
+        {
+            if (!rect.intersection(area).empty())
+            {
+                visible = true;
+                break;
+            }
+        }
+
+        view->visible(visible);
+        if (visible && view->m_fixed && view->opaque())
+        {
+            m_uncovered.subtract(area);
         }
     }
+
+    // Only keep views to draw
+    m_stack.erase(std::remove_if(m_stack.begin(), m_stack.end(),
+                                 [](BrowserView const* view)
+                                 {
+                                     return !view->visible();
+                                 }),
+                  m_stack.end());
 }
 
 //------------------------------------------------------------------------------
@@ -114,6 +301,33 @@ bool CEFGLWindow::setup()
         //"https://www.youtube.com/"
     };
 
+    // Page to show in all views instead (i.e. --url=app://ui/index.html)
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+    if (command_line->HasSwitch("url"))
+    {
+        std::fill(urls.begin(), urls.end(), command_line->GetSwitchValue("url").ToString());
+    }
+
+    // Upload pages from a context shared with the window
+    m_uploader.init(m_window);
+
+    // Fill the cache with local pages loaded in views never drawn
+    for (auto const& url: BrowserCache::global().warmUp())
+    {
+        m_warming.push_back(std::make_shared<BrowserView>(url, m_uploader));
+        m_warming.back()->reshape(int(m_width), int(m_height));
+    }
+    m_warming_since = std::chrono::steady_clock::now();
+    m_prerender.reshape(int(m_width), int(m_height));
+
+    m_benchmark = command_line->HasSwitch("benchmark-first-paint");
+    m_benchmark_since = std::chrono::steady_clock::now();
+    if (command_line->HasSwitch("eval-benchmark"))
+    {
+        m_eval_benchmark = size_t(std::max(0, std::atoi(
+            command_line->GetSwitchValue("eval-benchmark").ToString().c_str())));
+    }
+
     // Create BrowserView
     for (auto const& url: urls)
     {
@@ -125,8 +339,13 @@ bool CEFGLWindow::setup()
     m_browsers[0]->viewport(0.0f, 0.0f, 0.5f, 1.0f);
     m_browsers[1]->viewport(0.5f, 0.0f, 1.0f, 1.0f);
 
-    // Do rotation animation
+    // Do rotation animation over the first browser
     m_browsers[1]->m_fixed = false;
+    m_browsers[0]->zorder(0);
+    m_browsers[1]->zorder(1);
+
+    // Only redraw and present damaged parts of the window
+    m_back_buffer.init(m_window);
 
     // Windows events
     GLCHECK(glfwSetFramebufferSizeCallback(m_window, reshape_callback));
@@ -141,7 +360,8 @@ bool CEFGLWindow::setup()
     GLCHECK(glEnable(GL_DEPTH_TEST));
     GLCHECK(glDepthFunc(GL_LESS));
     GLCHECK(glDisable(GL_BLEND));
-    GLCHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+    // CEF paints premultiplied alpha
+    GLCHECK(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
 
     return true;
 }
@@ -149,12 +369,246 @@ bool CEFGLWindow::setup()
 //------------------------------------------------------------------------------
 bool CEFGLWindow::update()
 {
-    GLCHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
-    for (auto it: m_browsers)
+    // Send screen size to browsers once the resize settled down
+    int width, height;
+    if (m_resize.poll(width, height))
+    {
+        for (auto it: m_browsers)
+        {
+            it->reshape(width, height);
+        }
+        m_pool.reshape(width, height);
+        m_prerender.reshape(width, height);
+    }
+
+    // Swap prerendered pages before culling so they are drawn this frame
+    m_prerender.update();
+
+    cull();
+
+    // Start the next page loads, visible views first
+    m_scheduler.update(focused());
+
+    // Collect window pixels changed since the last frame
+    const Rect window(0, 0, int(m_width), int(m_height));
+    if (m_back_buffer.resize(window.w, window.h))
+    {
+        m_damage.add(window);
+    }
+    for (auto const& it: m_browsers)
+    {
+        it->damage(m_damage);
+    }
+    m_damage.clip(window);
+
+    // Many small rectangles cost more draw calls than the pixels they save
+    if (m_damage.rects().size() > MAX_DAMAGE_RECTS)
+    {
+        const Rect bounds = m_damage.bounds();
+        m_damage.clear();
+        m_damage.add(bounds);
+    }
+
+    // Redraw damaged pixels only
+    if (!m_damage.empty())
     {
-        it->draw();
+        m_back_buffer.bind();
+        GLCHECK(glEnable(GL_SCISSOR_TEST));
+        for (auto const& rect: m_damage.rects())
+        {
+            GLCHECK(glScissor(rect.x, rect.y, rect.w, rect.h));
+            GLCHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+            draw();
+        }
+        GLCHECK(glDisable(GL_SCISSOR_TEST));
+    }
+
+    // Create missing ready views after the frame is drawn
+    m_pool.refill(int(m_width), int(m_height));
+    hibernate();
+    warmUp();
+    benchmark();
+
+    // Keep textures and renderers in the memory budget
+    m_governed.clear();
+    for (auto const& it: m_browsers)
+    {
+        m_governed.push_back(it.get());
     }
+    m_governor.update(m_governed);
+
+    benchmarkScripts();
+
+    // Scripts queued during the frame: one IPC round trip per page
+    for (auto const& it: m_browsers)
+    {
+        it->flushScripts();
+    }
+    ScriptRouter::global().expire();
 
     CefDoMessageLoopWork();
     return true;
 }
+
+//------------------------------------------------------------------------------
+void CEFGLWindow::hibernate()
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    // Report the previous hibernation before starting another one, so the
+    // memory freed is not mixed between views.
+    if (m_hibernating_rss > 0u)
+    {
+        if (now - m_hibernating_since < HIBERNATION_REPORT_DELAY)
+            return ;
+
+        const size_t rss = ProcessMemory::rss("renderer");
+        const double saved = (double(m_hibernating_rss) - double(rss)) / 1048576.0;
+        auto view = m_hibernating.lock();
+        std::cout << "Hibernated " << (view ? view->url() : std::string("view"))
+                  << ": renderer RSS " << double(m_hibernating_rss) / 1048576.0
+                  << " MB -> " << double(rss) / 1048576.0 << " MB, saved "
+                  << saved << " MB" << std::endl;
+        m_hibernating.reset();
+        m_hibernating_rss = 0u;
+    }
+
+    for (auto const& it: m_browsers)
+    {
+        if (it->visible() || it->hibernated() || !it->created() ||
+            (now - it->lastUsed() < HIBERNATION_DELAY))
+            continue;
+
+        m_hibernating_rss = ProcessMemory::rss("renderer");
+        m_hibernating_since = now;
+        m_hibernating = it;
+        it->hibernate();
+        return ;
+    }
+}
+
+//------------------------------------------------------------------------------
+void CEFGLWindow::warmUp()
+{
+    if (m_warming.empty())
+        return ;
+
+    const bool timeout = (std::chrono::steady_clock::now() - m_warming_since > WARM_UP_TIMEOUT);
+    m_warming.erase(std::remove_if(m_warming.begin(), m_warming.end(),
+                                   [timeout](std::shared_ptr<BrowserView> const& view)
+                                   {
+                                       if (view->created() && !view->loading())
+                                       {
+                                           std::cout << "Warmed up " << view->url() << std::endl;
+                                           return true;
+                                       }
+                                       if (timeout)
+                                       {
+                                           std::cerr << "Warm up of " << view->url()
+                                                     << " timed out" << std::endl;
+                                       }
+                                       return timeout;
+                                   }),
+                    m_warming.end());
+}
+
+//------------------------------------------------------------------------------
+void CEFGLWindow::benchmark()
+{
+    if (!m_benchmark)
+        return ;
+
+    const bool timeout = (std::chrono::steady_clock::now() - m_benchmark_since > BENCHMARK_TIMEOUT);
+    long total = 0, worst = 0;
+    for (auto const& it: m_browsers)
+    {
+        const long ms = long(it->firstPaint().count());
+        if ((ms < 0) && !timeout)
+            return ;
+        total += std::max(ms, 0L);
+        worst = std::max(worst, ms);
+    }
+
+    std::cout << "Benchmark: first paint of " << m_browsers.size()
+              << " views in " << worst << " ms (mean "
+              << (m_browsers.empty() ? 0L : total / long(m_browsers.size()))
+              << " ms)" << (timeout ? ", timed out" : "") << std::endl;
+    if (ResponseCache::global() != nullptr)
+    {
+        ResponseCache::global()->log();
+    }
+    Blocklist::global().log();
+    m_benchmark = false;
+    glfwSetWindowShouldClose(m_window, GLFW_TRUE);
+}
+
+//------------------------------------------------------------------------------
+void CEFGLWindow::benchmarkScripts()
+{
+    if ((m_eval_benchmark == 0u) || m_browsers.empty() || !m_browsers[0]->loaded())
+        return ;
+
+    for (size_t i = 0u; i < m_eval_benchmark; ++i)
+    {
+        const int expected = int(i);
+        m_browsers[0]->eval("({ index: " + std::to_string(i) + ", title: document.title })",
+                            [expected](CefRefPtr<CefValue> result, std::string const& error)
+        {
+            if ((result == nullptr) || (result->GetType() != VTYPE_DICTIONARY) ||
+                (result->GetDictionary()->GetInt("index") != expected))
+            {
+                std::cerr << "Script " << expected << " failed: " << error << std::endl;
+            }
+        });
+    }
+}
+
+//------------------------------------------------------------------------------
+bool CEFGLWindow::present()
+{
+    // Nothing changed: do not swap buffers
+    if (m_damage.empty())
+        return false;
+
+    m_back_buffer.present(m_damage);
+    m_damage.clear();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void CEFGLWindow::draw()
+{
+    // Visible browsers sorted back to front: the last one is in front of the
+    // others.
+    const size_t count = m_stack.size();
+    auto depth = [count](size_t i) -> float
+    {
+        return 1.0f - 2.0f * float(i + 1u) / float(count + 1u);
+    };
+
+    // Opaque views front to back without blending: the depth test rejects
+    // hidden fragments before they are shaded.
+    GLCHECK(glDisable(GL_BLEND));
+    GLCHECK(glDepthMask(GL_TRUE));
+    for (size_t i = count; i-- > 0u; )
+    {
+        if (m_stack[i]->opaque())
+        {
+            m_stack[i]->draw(depth(i));
+        }
+    }
+
+    // Transparent views back to front with premultiplied alpha blending.
+    // They are still depth tested against opaque views in front of them.
+    GLCHECK(glEnable(GL_BLEND));
+    GLCHECK(glDepthMask(GL_FALSE));
+    for (size_t i = 0u; i < count; ++i)
+    {
+        if (!m_stack[i]->opaque())
+        {
+            m_stack[i]->draw(depth(i));
+        }
+    }
+    GLCHECK(glDepthMask(GL_TRUE));
+    GLCHECK(glDisable(GL_BLEND));
+}
@@ -7,6 +7,13 @@
 // Base application class
 #  include "GLWindow.hpp"
 #  include "BrowserView.hpp"
+#  include "BrowserPool.hpp"
+#  include "Prerenderer.hpp"
+#  include "LoadScheduler.hpp"
+#  include "ResizeDebouncer.hpp"
+#  include "BackBuffer.hpp"
+
+#  include <chrono>
 
 // ****************************************************************************
 //! \brief Extend the OpenGL base window and add Chromium Embedded Framework
@@ -22,30 +29,149 @@ public:
     //! \brief Destructor
     ~CEFGLWindow();
 
+    //! \brief Called on each window resize event. Browsers are drawn
+    //! stretched immediately but only re-layout once the resize settled down.
+    void resize(int width, int height);
+
     //! \brief Non const getter of the list of browsers
     inline std::vector<std::shared_ptr<BrowserView>>& browsers()
     {
         return m_browsers;
     }
 
+    //! \brief Navigate the view to the URL. When \c prerender is set, the
+    //! page is loaded hidden and only shown once loaded and painted.
+    void navigate(std::weak_ptr<BrowserView> view, const std::string &url,
+                  bool prerender = true);
+
+    //! \brief Prerender a likely next URL for navigate().
+    bool speculate(const std::string &url);
+
+    //! \brief Send the mouse move to the view under the cursor only: input
+    //! shall not keep hidden views from hibernating.
+    void mouseMove(int x, int y);
+
+    //! \brief Send the click to the view under the cursor, which gets the
+    //! keyboard focus.
+    void mouseClick(CefBrowserHost::MouseButtonType btn, bool mouse_up);
+
+    //! \brief Send the key to the last clicked view while it is visible.
+    void keyPress(int key, bool pressed);
+
 private: // Concrete implementation from GLWindow
 
     virtual bool setup() override;
     virtual bool update() override;
+    virtual bool present() override;
 
 private:
 
-    //! \brief Create a new browser view from a given URL
-    std::weak_ptr<BrowserView> createBrowser(const std::string &url);
+    //! \brief Create a new browser view from a given URL. Transparent views
+    //! are blended over the views created before them. The URL is loaded
+    //! once m_scheduler starts it.
+    std::weak_ptr<BrowserView> createBrowser(const std::string &url,
+                                             bool transparent = false);
+
+    //! \brief Destroy the given browser view, or give it back to the pool of
+    //! ready views when \c recycle is set.
+    void removeBrowser(std::weak_ptr<BrowserView> web_core, bool recycle = false);
 
-    //! \brief Destroy the given browser view.
-    void removeBrowser(std::weak_ptr<BrowserView> web_core);
+    //! \brief Stack browser views back to front in m_stack, hide views
+    //! outside the window or covered by opaque views in front of them, and
+    //! show the others again.
+    void cull();
+
+    //! \brief Front-most visible view under the mouse cursor, if any.
+    BrowserView* focused() const;
+
+    //! \brief Draw visible views (m_stack) on the bound framebuffer.
+    void draw();
+
+    //! \brief Hibernate a view hidden for long, one at a time, and report the
+    //! renderer memory freed by the previous one.
+    void hibernate();
+
+    //! \brief Close warm-up views once loaded.
+    void warmUp();
+
+    //! \brief In benchmark mode, report the time to first paint of all views
+    //! and close the window once they have all painted.
+    void benchmark();
+
+    //! \brief With --eval-benchmark=<n>, evaluate n scripts per frame in the
+    //! first view once loaded (ScriptRouter prints the throughput).
+    void benchmarkScripts();
 
 private:
 
+    //! \brief Coalesce resize events before forwarding them to CEF.
+    ResizeDebouncer m_resize;
+
+    //! \brief Textures shared by all BrowserView. Only used by m_uploader.
+    TexturePool m_texture_pool;
+
+    //! \brief Thread uploading pages painted by all BrowserView. Declared
+    //! before m_browsers to outlive them.
+    TextureUploader m_uploader;
+
+    //! \brief Browser views created in advance for createBrowser().
+    BrowserPool m_pool;
+
+    //! \brief Pages loaded hidden for navigate() and speculate().
+    Prerenderer m_prerender;
+
+    //! \brief Start the loads of views created by createBrowser() a few at
+    //! a time.
+    LoadScheduler m_scheduler;
+
     //! \brief List of BrowserView managed by createBrowser() and
     //! removeBrowser() methods.
     std::vector<std::shared_ptr<BrowserView>> m_browsers;
+
+    //! \brief View getting the keyboard input (last clicked one).
+    std::weak_ptr<BrowserView> m_keyboard;
+
+    //! \brief Visible browser views sorted back to front. Rebuilt by cull()
+    //! on each frame.
+    std::vector<BrowserView*> m_stack;
+
+    //! \brief Window area not yet covered while culling (avoid reallocating
+    //! it on each frame).
+    Region m_uncovered;
+
+    //! \brief Window pixels to redraw and present on this frame.
+    Region m_damage;
+
+    //! \brief Window content kept between frames so only m_damage is
+    //! redrawn.
+    BackBuffer m_back_buffer;
+
+    //! \brief Last hibernated view, the renderer memory before and when.
+    //! Its renderer process takes a moment to exit: the memory freed is
+    //! measured later.
+    std::weak_ptr<BrowserView> m_hibernating;
+    size_t m_hibernating_rss = 0u;
+    std::chrono::steady_clock::time_point m_hibernating_since;
+
+    //! \brief Views loading the warm-up URLs of BrowserCache, never drawn.
+    std::vector<std::shared_ptr<BrowserView>> m_warming;
+    std::chrono::steady_clock::time_point m_warming_since;
+
+    //! \brief Number of views created, to name their request context.
+    size_t m_created = 0u;
+
+    //! \brief Measure the time to first paint then quit
+    //! (--benchmark-first-paint).
+    bool m_benchmark = false;
+    std::chrono::steady_clock::time_point m_benchmark_since;
+    //! \brief Scripts evaluated per frame (--eval-benchmark).
+    size_t m_eval_benchmark = 0u;
+
+    //! \brief Memory budget of views and renderer processes.
+    MemoryGovernor m_governor;
+    //! \brief Views given to m_governor (avoid reallocating it on each
+    //! frame).
+    std::vector<MemoryGovernor::View*> m_governed;
 };
 
 #endif // CEFGLWINDOW_HPP
@@ -80,14 +80,20 @@ bool GLWindow::start()
 
     while (!glfwWindowShouldClose(m_window))
     {
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
         if (!update())
             return false;
 
-        glfwSwapBuffers(m_window);
-        glfwPollEvents();
+        if (present())
+            glfwPollEvents();
+        else
+            glfwWaitEventsTimeout(1.0 / 60.0);
     }
 
     return true;
 }
+
+bool GLWindow::present()
+{
+    glfwSwapBuffers(m_window);
+    return true;
+}
@@ -34,6 +34,11 @@ private:
     //! \brief Implement the update for your application. Return false in case of failure.
     virtual bool update() = 0;
 
+    //! \brief Show the frame drawn by update(). By default swap buffers.
+    //! Return false when nothing has been presented: the runtime loop then
+    //! waits for events for up to a frame duration instead of spinning.
+    virtual bool present();
+
 protected:
 
     //! \brief The OpenGL whindows holding the context
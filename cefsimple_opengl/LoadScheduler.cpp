@@ -0,0 +1,158 @@
+// Page loads started a few at a time, most wanted first.
+
+#include "LoadScheduler.hpp"
+
+#include <cef_command_line.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+//! \brief Default number of concurrent loads.
+static const size_t DEFAULT_CONCURRENCY = 4u;
+
+//! \brief Loads not ended after this delay give their slot to the next one.
+static const std::chrono::seconds LOAD_TIMEOUT(15);
+
+//------------------------------------------------------------------------------
+static const char* name(LoadScheduler::Priority priority)
+{
+    switch (priority)
+    {
+    case LoadScheduler::Priority::Focused: return "focused";
+    case LoadScheduler::Priority::Visible: return "visible";
+    default: return "hidden";
+    }
+}
+
+//------------------------------------------------------------------------------
+static long ms(std::chrono::steady_clock::duration duration)
+{
+    return long(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+}
+
+//------------------------------------------------------------------------------
+LoadScheduler::LoadScheduler()
+    : m_concurrency(DEFAULT_CONCURRENCY)
+{
+    std::string concurrency;
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+    if ((command_line != nullptr) && command_line->HasSwitch("load-concurrency"))
+    {
+        concurrency = command_line->GetSwitchValue("load-concurrency").ToString();
+    }
+    else if (const char* env = std::getenv("OFFSCREENCEF_LOAD_CONCURRENCY"))
+    {
+        concurrency = env;
+    }
+    if (!concurrency.empty())
+    {
+        m_concurrency = size_t(std::strtoull(concurrency.c_str(), nullptr, 10));
+    }
+}
+
+//------------------------------------------------------------------------------
+void LoadScheduler::schedule(std::shared_ptr<BrowserView> const& view, std::string const& url)
+{
+    Load load;
+    load.view = view;
+    load.url = url;
+    load.scheduled = std::chrono::steady_clock::now();
+    if (m_waiting.empty() && m_started.empty())
+    {
+        m_first_scheduled = load.scheduled;
+        m_painted = 0u;
+    }
+    m_waiting.push_back(load);
+}
+
+//------------------------------------------------------------------------------
+LoadScheduler::Priority LoadScheduler::priority(BrowserView const& view,
+                                                BrowserView const* focused)
+{
+    if (&view == focused)
+        return Priority::Focused;
+    return view.visible() ? Priority::Visible : Priority::Hidden;
+}
+
+//------------------------------------------------------------------------------
+void LoadScheduler::update(BrowserView const* focused)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    // Free the slots of ended loads and report first paints
+    m_started.erase(std::remove_if(m_started.begin(), m_started.end(),
+                                   [&](Load& load)
+                                   {
+                                       auto view = load.view.lock();
+                                       if (!load.done && ((view == nullptr) || view->loaded() ||
+                                                          (now - load.started > LOAD_TIMEOUT)))
+                                       {
+                                           load.done = true;
+                                           --m_running;
+                                       }
+                                       if (view == nullptr)
+                                           return true;
+                                       if (view->firstPaint().count() < 0)
+                                           return false;
+                                       report(load, *view);
+                                       return true;
+                                   }),
+                    m_started.end());
+
+    // Forget destroyed views then sort waiting loads by priority, the larger
+    // views first, keeping the scheduling order otherwise
+    m_waiting.erase(std::remove_if(m_waiting.begin(), m_waiting.end(),
+                                   [](Load const& load)
+                                   {
+                                       return load.view.expired();
+                                   }),
+                    m_waiting.end());
+    if (m_waiting.empty() || (m_running >= m_concurrency))
+        return ;
+
+    for (auto& load: m_waiting)
+    {
+        load.priority = priority(*load.view.lock(), focused);
+    }
+    std::stable_sort(m_waiting.begin(), m_waiting.end(),
+                     [](Load const& a, Load const& b)
+                     {
+                         if (a.priority != b.priority)
+                             return a.priority < b.priority;
+                         const Rect ra = a.view.lock()->area();
+                         const Rect rb = b.view.lock()->area();
+                         return ra.w * ra.h > rb.w * rb.h;
+                     });
+
+    // Start the most wanted loads in free slots
+    size_t count = 0u;
+    while ((count < m_waiting.size()) && (m_running < m_concurrency))
+    {
+        Load& load = m_waiting[count++];
+        load.started = now;
+        load.view.lock()->load(load.url);
+        m_started.push_back(load);
+        ++m_running;
+    }
+    m_waiting.erase(m_waiting.begin(), m_waiting.begin() + long(count));
+}
+
+//------------------------------------------------------------------------------
+void LoadScheduler::report(Load const& load, BrowserView const& view)
+{
+    ++m_painted;
+    const auto now = std::chrono::steady_clock::now();
+    std::cout << "Load " << m_painted << " (" << name(load.priority) << ") "
+              << load.url << ": waited " << ms(load.started - load.scheduled)
+              << " ms, first paint " << view.firstPaint().count()
+              << " ms after its start, " << ms(now - m_first_scheduled)
+              << " ms after the first load was scheduled" << std::endl;
+}
+
+//------------------------------------------------------------------------------
+void LoadScheduler::clear()
+{
+    m_waiting.clear();
+    m_started.clear();
+    m_running = 0u;
+}
@@ -0,0 +1,87 @@
+// Page loads started a few at a time, most wanted first.
+
+#ifndef LOADSCHEDULER_HPP
+#  define LOADSCHEDULER_HPP
+
+#  include "BrowserView.hpp"
+
+#  include <chrono>
+#  include <memory>
+#  include <string>
+#  include <vector>
+
+// ****************************************************************************
+//! \brief Start page loads a few at a time so the first views are not slowed
+//! down by all the others competing for CPU and disk. Waiting loads start by
+//! priority: the focused view (under the mouse cursor), then visible views
+//! (largest first), then hidden ones, each in the order they were scheduled.
+//! A slot is freed when the main frame of the page has loaded or failed.
+//!
+//! The number of concurrent loads is set with --load-concurrency=<n> or the
+//! OFFSCREENCEF_LOAD_CONCURRENCY environment variable (default 4, 0 to load
+//! everything at once). The time to first paint of each view is printed.
+// ****************************************************************************
+class LoadScheduler
+{
+public:
+
+    enum class Priority { Focused, Visible, Hidden };
+
+    //! \brief Concurrency read from the command line.
+    LoadScheduler();
+
+    //! \brief Return false if loads shall not be delayed.
+    inline bool enabled() const
+    {
+        return m_concurrency > 0u;
+    }
+
+    //! \brief Load the URL in the view once a slot is free. The view shall
+    //! have been created with an empty URL or taken from the pool.
+    void schedule(std::shared_ptr<BrowserView> const& view, std::string const& url);
+
+    //! \brief Start waiting loads in free slots and report first paints. To
+    //! be called on each frame, once the visibility of views is known.
+    //! \param focused view under the mouse cursor if any.
+    void update(BrowserView const* focused);
+
+    //! \brief Forget all loads.
+    void clear();
+
+private:
+
+    // *************************************************************************
+    //! \brief Load of a view, waiting or started.
+    // *************************************************************************
+    struct Load
+    {
+        std::weak_ptr<BrowserView> view;
+        std::string url;
+        Priority priority = Priority::Hidden;
+        std::chrono::steady_clock::time_point scheduled;
+        std::chrono::steady_clock::time_point started;
+        //! \brief Main frame loaded: the slot is free.
+        bool done = false;
+    };
+
+    //! \brief Priority of the view now.
+    static Priority priority(BrowserView const& view, BrowserView const* focused);
+
+    //! \brief Print the time to first paint of the load.
+    void report(Load const& load, BrowserView const& view);
+
+private:
+
+    size_t m_concurrency;
+    //! \brief Loads not started, in scheduling order.
+    std::vector<Load> m_waiting;
+    //! \brief Loads started and not yet painted.
+    std::vector<Load> m_started;
+    //! \brief Number of started loads whose main frame is loading.
+    size_t m_running = 0u;
+    //! \brief Loads painted since the first one was scheduled.
+    size_t m_painted = 0u;
+    std::chrono::steady_clock::time_point m_first_scheduled;
+};
+
+#endif // LOADSCHEDULER_HPP
@@ -0,0 +1,293 @@
+// Pages loaded in hidden browsers before being shown.
+
+#include "Prerenderer.hpp"
+#include "ProcessMemory.hpp"
+
+#include <cef_command_line.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(__linux__)
+#  include <unistd.h>
+#endif
+
+//! \brief Paints per second of a loaded page waiting to be swapped: enough
+//! for its first paint without competing with visible views.
+static const int PRERENDER_FRAME_RATE = 10;
+
+//! \brief Pages not loaded and painted after this delay are swapped anyway.
+static const std::chrono::seconds PRERENDER_TIMEOUT(10);
+
+//! \brief Maximum number of speculative pages.
+static const size_t MAX_SPECULATIONS = 2u;
+
+//! \brief Speculative pages not used after this delay are dropped.
+static const std::chrono::seconds SPECULATION_LIFETIME(60);
+
+//! \brief Command line switch and environment variable setting the memory
+//! of all renderers above which nothing is prerendered.
+static const char* MAX_RENDERER_SWITCH = "prerender-max-renderer-mb";
+static const char* MAX_RENDERER_ENV = "OFFSCREENCEF_PRERENDER_MAX_RENDERER_MB";
+
+//! \brief Default when the physical memory is unknown.
+static const size_t DEFAULT_MAX_RENDERER_MB = 2048u;
+
+//! \brief Delay between two measures of the renderer memory.
+static const std::chrono::seconds BUDGET_CHECK_PERIOD(1);
+
+//------------------------------------------------------------------------------
+Prerenderer::Prerenderer(BrowserPool& pool, TextureUploader& uploader)
+    : m_pool(pool), m_uploader(uploader)
+{
+    std::string mb;
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+    if ((command_line != nullptr) && command_line->HasSwitch(MAX_RENDERER_SWITCH))
+    {
+        mb = command_line->GetSwitchValue(MAX_RENDERER_SWITCH).ToString();
+    }
+    else if (const char* env = std::getenv(MAX_RENDERER_ENV))
+    {
+        mb = env;
+    }
+
+    if (!mb.empty())
+    {
+        m_max_renderer = size_t(std::strtoull(mb.c_str(), nullptr, 10)) * 1024u * 1024u;
+    }
+    else
+    {
+        // Stop speculating before the memory governor (half of the physical
+        // memory) hibernates views.
+#if defined(__linux__)
+        m_max_renderer = size_t(sysconf(_SC_PHYS_PAGES)) * size_t(sysconf(_SC_PAGESIZE)) / 4u;
+#else
+        m_max_renderer = DEFAULT_MAX_RENDERER_MB * 1024u * 1024u;
+#endif
+    }
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<BrowserView> Prerenderer::page(std::string const& url, BrowserView const* like)
+{
+    // Transparency and request context are set when the browser is created:
+    // pooled views are opaque and use the global context.
+    std::shared_ptr<BrowserView> page;
+    if ((like == nullptr) || (!like->transparent() && (like->context() == nullptr)))
+    {
+        page = m_pool.acquire(url);
+    }
+    if (page == nullptr)
+    {
+        page = (like == nullptr)
+               ? std::make_shared<BrowserView>(url, m_uploader)
+               : std::make_shared<BrowserView>(url, m_uploader, like->transparent(), like->context());
+    }
+    page->visible(false);
+    page->reshape(m_width, m_height);
+    return page;
+}
+
+//------------------------------------------------------------------------------
+void Prerenderer::navigate(std::shared_ptr<BrowserView> const& view, std::string const& url)
+{
+    // Pending calls of a view refer to it: only created browsers are swapped
+    if (!view->created() || view->hibernated())
+    {
+        view->load(url);
+        return ;
+    }
+
+    // Cancel the previous navigation of the view
+    auto same_view = [&view](Prerender const& prerender)
+    {
+        return prerender.target.lock() == view;
+    };
+    for (auto& it: m_navigations)
+    {
+        if (same_view(it))
+        {
+            release(it.page);
+        }
+    }
+    m_navigations.erase(std::remove_if(m_navigations.begin(), m_navigations.end(), same_view),
+                        m_navigations.end());
+
+    // Use the speculative page of this URL if any
+    Prerender prerender;
+    auto found = std::find_if(m_speculations.begin(), m_speculations.end(),
+                              [&url, &view](Prerender const& it)
+                              {
+                                  return (it.page->url() == url) &&
+                                         (it.page->transparent() == view->transparent()) &&
+                                         (it.page->context() == view->context());
+                              });
+    if (found != m_speculations.end())
+    {
+        prerender = *found;
+        m_speculations.erase(found);
+    }
+    else
+    {
+        prerender.page = page(url, view.get());
+        prerender.since = std::chrono::steady_clock::now();
+    }
+    prerender.target = view;
+
+    // Lay out the page as in the view
+    glm::vec4 const& viewport = view->viewport();
+    prerender.page->viewport(viewport.x, viewport.y, viewport.z, viewport.w);
+    m_navigations.push_back(prerender);
+}
+
+//------------------------------------------------------------------------------
+bool Prerenderer::speculate(std::string const& url)
+{
+    for (auto const& it: m_speculations)
+    {
+        if (it.page->url() == url)
+            return true;
+    }
+    for (auto const& it: m_navigations)
+    {
+        if (it.page->url() == url)
+            return true;
+    }
+
+    if (ProcessMemory::rss("renderer") > m_max_renderer)
+    {
+        std::cerr << "Prerender of " << url << " skipped: renderers over "
+                  << m_max_renderer / (1024u * 1024u) << " MB" << std::endl;
+        return false;
+    }
+    if (m_speculations.size() >= MAX_SPECULATIONS)
+    {
+        release(m_speculations.front().page);
+        m_speculations.erase(m_speculations.begin());
+    }
+
+    Prerender prerender;
+    prerender.page = page(url, nullptr);
+    prerender.since = std::chrono::steady_clock::now();
+    m_speculations.push_back(prerender);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool Prerenderer::render(Prerender& prerender)
+{
+    std::shared_ptr<BrowserView> const& page = prerender.page;
+    const bool timeout = (std::chrono::steady_clock::now() - prerender.since > PRERENDER_TIMEOUT);
+
+    // Hidden browsers do not paint: show the loaded page (it is not drawn)
+    // at a low frame rate and wait for its first complete paint.
+    if (!prerender.shown && page->created() && !page->loading())
+    {
+        page->frameRate(PRERENDER_FRAME_RATE);
+        page->visible(true);
+        page->repaint();
+        prerender.shown = true;
+    }
+    else if (prerender.shown && (page->firstPaint().count() >= 0))
+    {
+        prerender.painted = true;
+    }
+
+    return prerender.painted || (timeout && page->created());
+}
+
+//------------------------------------------------------------------------------
+void Prerenderer::swap(Prerender& prerender)
+{
+    auto view = prerender.target.lock();
+    std::shared_ptr<BrowserView> const& page = prerender.page;
+
+    std::cout << "Prerendered " << page->url() << " in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - prerender.since).count()
+              << " ms" << (prerender.painted ? "" : " (timed out)") << std::endl;
+
+    view->swap(*page);
+    view->frameRate(BrowserView::FrameRate);
+    release(page);
+}
+
+//------------------------------------------------------------------------------
+void Prerenderer::release(std::shared_ptr<BrowserView> const& page)
+{
+    page->frameRate(BrowserView::FrameRate);
+    m_pool.recycle(page);
+}
+
+//------------------------------------------------------------------------------
+void Prerenderer::update()
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    m_navigations.erase(std::remove_if(m_navigations.begin(), m_navigations.end(),
+                                       [this](Prerender& it)
+                                       {
+                                           auto view = it.target.lock();
+                                           if ((view == nullptr) || view->hibernated())
+                                           {
+                                               release(it.page);
+                                               return true;
+                                           }
+                                           if (!render(it))
+                                               return false;
+                                           swap(it);
+                                           return true;
+                                       }),
+                        m_navigations.end());
+
+    // Painted speculative pages wait hidden
+    for (auto& it: m_speculations)
+    {
+        if (!it.painted && render(it) && it.painted)
+        {
+            it.page->visible(false);
+        }
+    }
+
+    // Drop old speculative pages, and the oldest ones over the budget
+    while (!m_speculations.empty() && (now - m_speculations.front().since > SPECULATION_LIFETIME))
+    {
+        release(m_speculations.front().page);
+        m_speculations.erase(m_speculations.begin());
+    }
+    if (!m_speculations.empty() && (now - m_last_check > BUDGET_CHECK_PERIOD))
+    {
+        m_last_check = now;
+        if (ProcessMemory::rss("renderer") > m_max_renderer)
+        {
+            std::cerr << "Prerender of " << m_speculations.front().page->url()
+                      << " dropped: renderers over " << m_max_renderer / (1024u * 1024u)
+                      << " MB" << std::endl;
+            release(m_speculations.front().page);
+            m_speculations.erase(m_speculations.begin());
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void Prerenderer::reshape(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    for (auto const& it: m_navigations)
+    {
+        it.page->reshape(width, height);
+    }
+    for (auto const& it: m_speculations)
+    {
+        it.page->reshape(width, height);
+    }
+}
+
+//------------------------------------------------------------------------------
+void Prerenderer::clear()
+{
+    m_navigations.clear();
+    m_speculations.clear();
+}
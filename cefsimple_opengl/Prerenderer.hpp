@@ -0,0 +1,101 @@
+// Pages loaded in hidden browsers before being shown.
+
+#ifndef PRERENDERER_HPP
+#  define PRERENDERER_HPP
+
+#  include "BrowserPool.hpp"
+
+#  include <chrono>
+#  include <memory>
+#  include <string>
+#  include <vector>
+
+// ****************************************************************************
+//! \brief Navigate views without showing blank or partially painted pages:
+//! the new page is loaded in a hidden browser (taken from the pool when
+//! possible) then swapped with the page of the view once loaded and painted.
+//! The view keeps its viewport, z-order and animations.
+//!
+//! Likely next URLs can also be prerendered speculatively so navigating to
+//! them is immediate. Speculative pages are limited in number and dropped,
+//! oldest first, when all renderer processes together use more memory than
+//! --prerender-max-renderer-mb=<n> or the OFFSCREENCEF_PRERENDER_MAX_RENDERER_MB
+//! environment variable (default a quarter of the physical memory). This is a
+//! global threshold, not the memory of speculative pages: CEF does not tell
+//! which renderer process draws a page and pages of a site share one.
+// ****************************************************************************
+class Prerenderer
+{
+public:
+
+    //! \brief Pages are taken from the given pool, or created with the given
+    //! uploader when it is empty.
+    Prerenderer(BrowserPool& pool, TextureUploader& uploader);
+
+    //! \brief Load the URL in a hidden browser then show it in the view once
+    //! loaded and painted. Views not yet created or hibernated load in place.
+    void navigate(std::shared_ptr<BrowserView> const& view, std::string const& url);
+
+    //! \brief Load a likely next URL in a hidden browser, reused by
+    //! navigate(). \return false if over the limits.
+    bool speculate(std::string const& url);
+
+    //! \brief Show loaded pages, swap painted ones into their view and drop
+    //! speculative pages over the memory budget. To be called on each frame.
+    void update();
+
+    //! \brief Send the new window size to hidden pages.
+    void reshape(int width, int height);
+
+    //! \brief Destroy hidden pages.
+    void clear();
+
+private:
+
+    // *************************************************************************
+    //! \brief Page loading in a hidden browser, for a view or speculatively
+    //! when the view is empty.
+    // *************************************************************************
+    struct Prerender
+    {
+        std::weak_ptr<BrowserView> target;
+        std::shared_ptr<BrowserView> page;
+        std::chrono::steady_clock::time_point since;
+        //! \brief Loaded and shown, waiting for its first paint.
+        bool shown = false;
+        //! \brief Painted: can be swapped.
+        bool painted = false;
+    };
+
+    //! \brief Hidden page loading the URL, like the given view (transparency
+    //! and request context) if any.
+    std::shared_ptr<BrowserView> page(std::string const& url, BrowserView const* like);
+
+    //! \brief Show the page once loaded and detect its first paint.
+    //! \return true once painted (or timed out).
+    bool render(Prerender& prerender);
+
+    //! \brief Replace the page of the target view by the prerendered one and
+    //! give the previous page back to the pool.
+    void swap(Prerender& prerender);
+
+    //! \brief Give a page back to the pool, else destroy it.
+    void release(std::shared_ptr<BrowserView> const& page);
+
+private:
+
+    BrowserPool& m_pool;
+    TextureUploader& m_uploader;
+    int m_width = 0;
+    int m_height = 0;
+    //! \brief Pages to show in their view.
+    std::vector<Prerender> m_navigations;
+    //! \brief Speculative pages, oldest first.
+    std::vector<Prerender> m_speculations;
+    //! \brief Memory of all renderers above which speculative pages are
+    //! dropped.
+    size_t m_max_renderer;
+    std::chrono::steady_clock::time_point m_last_check;
+};
+
+#endif // PRERENDERER_HPP
@@ -0,0 +1,100 @@
+// Rectangle arithmetic on the OpenGL window.
+
+#include "Region.hpp"
+
+//------------------------------------------------------------------------------
+//! \brief Append to \c out the parts of \c rect outside \c hole (at most four
+//! rectangles: bottom and top bands, then left and right of the hole).
+//------------------------------------------------------------------------------
+static void difference(Rect const& rect, Rect const& hole, std::vector<Rect>& out)
+{
+    const Rect common = rect.intersection(hole);
+    if (common.empty())
+    {
+        out.push_back(rect);
+        return ;
+    }
+
+    if (common.y > rect.y)
+        out.push_back(Rect(rect.x, rect.y, rect.w, common.y - rect.y));
+    if (common.top() < rect.top())
+        out.push_back(Rect(rect.x, common.top(), rect.w, rect.top() - common.top()));
+    if (common.x > rect.x)
+        out.push_back(Rect(rect.x, common.y, common.x - rect.x, common.h));
+    if (common.right() < rect.right())
+        out.push_back(Rect(common.right(), common.y, rect.right() - common.right(), common.h));
+}
+
+//------------------------------------------------------------------------------
+void Region::add(Rect const& rect)
+{
+    if (rect.empty())
+        return ;
+
+    // Only keep the pixels not already covered so rectangles never overlap
+    std::vector<Rect> pieces = { rect };
+    for (auto const& it: m_rects)
+    {
+        std::vector<Rect> remaining;
+        for (auto const& piece: pieces)
+        {
+            difference(piece, it, remaining);
+        }
+        pieces.swap(remaining);
+        if (pieces.empty())
+            return ;
+    }
+
+    m_rects.insert(m_rects.end(), pieces.begin(), pieces.end());
+}
+
+//------------------------------------------------------------------------------
+void Region::subtract(Rect const& rect)
+{
+    if (rect.empty())
+        return ;
+
+    std::vector<Rect> remaining;
+    for (auto const& it: m_rects)
+    {
+        difference(it, rect, remaining);
+    }
+    m_rects.swap(remaining);
+}
+
+//------------------------------------------------------------------------------
+void Region::clip(Rect const& rect)
+{
+    std::vector<Rect> remaining;
+    for (auto const& it: m_rects)
+    {
+        Rect common = it.intersection(rect);
+        if (!common.empty())
+        {
+            remaining.push_back(common);
+        }
+    }
+    m_rects.swap(remaining);
+}
+
+//------------------------------------------------------------------------------
+long Region::area() const
+{
+    long pixels = 0;
+    for (auto const& it: m_rects)
+    {
+        pixels += long(it.w) * long(it.h);
+    }
+    return pixels;
+}
+
+//------------------------------------------------------------------------------
+Rect Region::bounds() const
+{
+    Rect result;
+    for (auto const& it: m_rects)
+    {
+        result = result.bounds(it);
+    }
+    return result;
+}
@@ -0,0 +1,129 @@
+// Rectangle arithmetic on the OpenGL window, used to know which parts of the
+// window are covered by browser views.
+
+#ifndef REGION_HPP
+#  define REGION_HPP
+
+#  include <vector>
+#  include <algorithm>
+
+// ****************************************************************************
+//! \brief Axis aligned rectangle in window pixels (origin at the bottom-left
+//! corner like OpenGL viewports).
+// ****************************************************************************
+struct Rect
+{
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+
+    Rect() = default;
+    Rect(int x_, int y_, int w_, int h_)
+        : x(x_), y(y_), w(w_), h(h_)
+    {}
+
+    inline bool empty() const
+    {
+        return (w <= 0) || (h <= 0);
+    }
+
+    inline bool operator==(Rect const& other) const
+    {
+        return (x == other.x) && (y == other.y) && (w == other.w) && (h == other.h);
+    }
+
+    inline bool operator!=(Rect const& other) const
+    {
+        return !(*this == other);
+    }
+
+    inline int right() const
+    {
+        return x + w;
+    }
+
+    inline int top() const
+    {
+        return y + h;
+    }
+
+    //! \brief Return the common part of the two rectangles (may be empty).
+    Rect intersection(Rect const& other) const
+    {
+        const int x0 = std::max(x, other.x);
+        const int y0 = std::max(y, other.y);
+        const int x1 = std::min(right(), other.right());
+        const int y1 = std::min(top(), other.top());
+        return Rect(x0, y0, x1 - x0, y1 - y0);
+    }
+
+    //! \brief Return the smallest rectangle holding both rectangles.
+    Rect bounds(Rect const& other) const
+    {
+        if (empty())
+            return other;
+        if (other.empty())
+            return *this;
+
+        const int x0 = std::min(x, other.x);
+        const int y0 = std::min(y, other.y);
+        const int x1 = std::max(right(), other.right());
+        const int y1 = std::max(top(), other.top());
+        return Rect(x0, y0, x1 - x0, y1 - y0);
+    }
+};
+
+// ****************************************************************************
+//! \brief Set of non overlapping rectangles.
+// ****************************************************************************
+class Region
+{
+public:
+
+    Region() = default;
+
+    explicit Region(Rect const& rect)
+    {
+        add(rect);
+    }
+
+    //! \brief Return true if the region covers no pixel.
+    inline bool empty() const
+    {
+        return m_rects.empty();
+    }
+
+    //! \brief Rectangles of the region.
+    inline std::vector<Rect> const& rects() const
+    {
+        return m_rects;
+    }
+
+    //! \brief Remove all rectangles.
+    inline void clear()
+    {
+        m_rects.clear();
+    }
+
+    //! \brief Add the part of the rectangle not already in the region.
+    void add(Rect const& rect);
+
+    //! \brief Remove the rectangle from the region.
+    void subtract(Rect const& rect);
+
+    //! \brief Keep only the part of the region inside the rectangle.
+    void clip(Rect const& rect);
+
+    //! \brief Number of pixels covered by the region.
+    long area() const;
+
+    //! \brief Smallest rectangle holding the whole region.
+    Rect bounds() const;
+
+private:
+
+    std::vector<Rect> m_rects;
+};
+
+#endif // REGION_HPP
@@ -0,0 +1,78 @@
+// Pool of OpenGL textures holding web pages.
+
+#include "TexturePool.hpp"
+#include "TextureBucket.hpp"
+#include "GLCore.hpp"
+
+//------------------------------------------------------------------------------
+TexturePool::TexturePool(size_t max_cached)
+    : m_max_cached(max_cached)
+{}
+
+//------------------------------------------------------------------------------
+TexturePool::~TexturePool()
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------
+PooledTexture TexturePool::acquire(GLsizei width, GLsizei height)
+{
+    // Reuse a cached texture of a compatible bucket
+    for (auto it = m_cache.begin(); it != m_cache.end(); ++it)
+    {
+        if (TextureBucket::fits(width, height, it->width, it->height))
+        {
+            PooledTexture texture = *it;
+            m_cache.erase(it);
+            return texture;
+        }
+    }
+
+    if (m_max_size == 0)
+    {
+        GLCHECK(glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_max_size));
+    }
+
+    PooledTexture texture;
+    texture.width = TextureBucket::allocation(width, m_max_size);
+    texture.height = TextureBucket::allocation(height, m_max_size);
+
+    GLCHECK(glGenTextures(1, &texture.id));
+    GLCHECK(glBindTexture(GL_TEXTURE_2D, texture.id));
+    GLCHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GLCHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GLCHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.width, texture.height,
+                         0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, nullptr));
+    GLCHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+    return texture;
+}
+
+//------------------------------------------------------------------------------
+void TexturePool::release(PooledTexture& texture)
+{
+    if (texture.id == 0)
+        return ;
+
+    m_cache.push_front(texture);
+    texture = PooledTexture();
+
+    while (m_cache.size() > m_max_cached)
+    {
+        GLCHECK(glDeleteTextures(1, &m_cache.back().id));
+        m_cache.pop_back();
+    }
+}
+
+//------------------------------------------------------------------------------
+void TexturePool::clear()
+{
+    for (auto& it: m_cache)
+    {
+        GLCHECK(glDeleteTextures(1, &it.id));
+    }
+    m_cache.clear();
+}
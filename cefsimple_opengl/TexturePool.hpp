@@ -0,0 +1,63 @@
+// Pool of OpenGL textures holding web pages. Avoids reallocating GPU memory
+// while a window is resized.
+
+#ifndef TEXTUREPOOL_HPP
+#  define TEXTUREPOOL_HPP
+
+#  include <GL/glew.h>
+#  include <list>
+#  include <cstddef>
+
+// ****************************************************************************
+//! \brief Texture handle and its allocated dimension. Pages are drawn into the
+//! top-left sub-rectangle of it.
+// ****************************************************************************
+struct PooledTexture
+{
+    GLuint id = 0;
+    GLsizei width = 0;
+    GLsizei height = 0;
+
+    //! \brief GPU memory used by the texture (BGRA8).
+    inline size_t bytes() const
+    {
+        return size_t(width) * size_t(height) * 4u;
+    }
+};
+
+// ****************************************************************************
+//! \brief Size-bucketed pool of RGBA textures. Released textures are kept in a
+//! small LRU so a view going back to a previous size (or another view) can
+//! reuse them. The OpenGL context shall be current when calling methods.
+// ****************************************************************************
+class TexturePool
+{
+public:
+
+    //! \brief \c max_cached is the number of released textures kept alive.
+    TexturePool(size_t max_cached = 4);
+
+    //! \brief Delete cached textures.
+    ~TexturePool();
+
+    //! \brief Return a texture able to hold a page of the given dimension:
+    //! reuse a cached one when possible, else allocate a new one.
+    PooledTexture acquire(GLsizei width, GLsizei height);
+
+    //! \brief Give back a texture to the pool. The least recently released
+    //! texture is deleted when the pool is full.
+    void release(PooledTexture& texture);
+
+    //! \brief Delete all cached textures.
+    void clear();
+
+private:
+
+    //! \brief Most recently released first.
+    std::list<PooledTexture> m_cache;
+    size_t m_max_cached;
+    //! \brief GL_MAX_TEXTURE_SIZE (queried lazily once a context exists).
+    GLint m_max_size = 0;
+};
+
+#endif // TEXTUREPOOL_HPP
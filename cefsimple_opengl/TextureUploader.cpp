@@ -0,0 +1,456 @@
+// Upload web pages painted by CEF into OpenGL textures from a dedicated thread
+// so the drawing thread only composites.
+
+#include "TextureUploader.hpp"
+#include "TextureBucket.hpp"
+#include "FrameCopy.hpp"
+#include "GLCore.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+//! \brief Above this number of rectangles missing in a texture, the whole
+//! page is uploaded instead.
+static const size_t MAX_MISSING_RECTS = 16u;
+
+//! \brief Number of free staging buffers kept for reuse.
+static const size_t MAX_STAGING_BUFFERS = 8u;
+
+//------------------------------------------------------------------------------
+bool UploadTarget::flip(std::vector<Rect>& painted)
+{
+    GLsync fence;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_ready < 0)
+            return false;
+
+        // A page of a new dimension is fully damaged
+        if ((m_page_width[m_ready] != m_page_width[m_front]) ||
+            (m_page_height[m_ready] != m_page_height[m_front]))
+        {
+            m_painted.assign(1u, Rect(0, 0, m_page_width[m_ready], m_page_height[m_ready]));
+        }
+
+        m_front = m_ready;
+        m_ready = -1;
+        fence = m_upload_fence;
+        m_upload_fence = nullptr;
+        painted.insert(painted.end(), m_painted.begin(), m_painted.end());
+        m_painted.clear();
+    }
+
+    if (fence != nullptr)
+    {
+        GLCHECK(glWaitSync(fence, 0, GL_TIMEOUT_IGNORED));
+        GLCHECK(glDeleteSync(fence));
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void UploadTarget::drawn()
+{
+    GLsync fence = GLCHECK(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    // The upload context can only wait for fences sent to the GPU
+    GLCHECK(glFlush());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_draw_fence[m_front] != nullptr)
+    {
+        GLCHECK(glDeleteSync(m_draw_fence[m_front]));
+    }
+    m_draw_fence[m_front] = fence;
+}
+
+//------------------------------------------------------------------------------
+TextureUploader::TextureUploader(TexturePool& pool)
+    : m_pool(pool)
+{}
+
+//------------------------------------------------------------------------------
+TextureUploader::~TextureUploader()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_cond.notify_one();
+        m_thread.join();
+    }
+
+    if (m_context != nullptr)
+    {
+        glfwDestroyWindow(m_context);
+    }
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::init(GLFWwindow* window)
+{
+    // Same context hints than the window, but never shown
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    m_context = glfwCreateWindow(1, 1, "uploader", nullptr, window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+    if (m_context == nullptr)
+    {
+        std::cerr << "TextureUploader: no shared context, uploading from the "
+                  << "drawing thread" << std::endl;
+        return ;
+    }
+
+    m_thread = std::thread(&TextureUploader::run, this);
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<UploadTarget> TextureUploader::target()
+{
+    return std::make_shared<UploadTarget>();
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::upload(std::shared_ptr<UploadTarget> const& target,
+                             const void* bgra, GLsizei width, GLsizei height,
+                             std::vector<Rect> const& rects)
+{
+    size_t bytes = 0u;
+    for (auto const& rect: rects)
+    {
+        bytes += size_t(rect.w) * size_t(rect.h) * 4u;
+    }
+
+    Job job;
+    job.target = target;
+    job.staging = staging(bytes);
+    job.rects = rects;
+    job.width = width;
+    job.height = height;
+
+    // Pack rectangles row by row
+    const uint8_t* page = static_cast<const uint8_t*>(bgra);
+    uint8_t* dst = job.staging.data();
+    for (auto const& rect: rects)
+    {
+        const size_t row = size_t(rect.w) * 4u;
+        FrameCopy::copy(dst, row, page + 4u * (size_t(rect.y) * size_t(width) + size_t(rect.x)),
+                        size_t(width) * 4u, row, size_t(rect.h));
+        dst += row * size_t(rect.h);
+    }
+
+    push(std::move(job));
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::release(std::shared_ptr<UploadTarget> const& target)
+{
+    Job job;
+    job.target = target;
+    job.release = true;
+    push(std::move(job));
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::trim(std::shared_ptr<UploadTarget> const& target)
+{
+    Job job;
+    job.target = target;
+    job.trim = true;
+    push(std::move(job));
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::push(Job&& job)
+{
+    if (!m_thread.joinable())
+    {
+        std::deque<Job> jobs;
+        jobs.push_back(std::move(job));
+        process(jobs);
+        return ;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_cond.notify_one();
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::run()
+{
+    glfwMakeContextCurrent(m_context);
+
+    std::deque<Job> jobs;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return m_quit || !m_jobs.empty(); });
+
+            // Queued jobs are done before quitting
+            if (m_jobs.empty())
+                break;
+            jobs.swap(m_jobs);
+        }
+
+        process(jobs);
+        jobs.clear();
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::process(std::deque<Job>& jobs)
+{
+    std::vector<UploadTarget*> targets;
+    for (auto& job: jobs)
+    {
+        UploadTarget* target = job.target.get();
+        auto found = std::find(targets.begin(), targets.end(), target);
+
+        if (job.release)
+        {
+            if (found != targets.end())
+            {
+                targets.erase(found);
+            }
+            destroy(*target);
+            continue;
+        }
+
+        if (job.trim)
+        {
+            // Upload what has been painted before
+            if (found != targets.end())
+            {
+                update(*target);
+                targets.erase(found);
+            }
+            shrink(*target);
+            continue;
+        }
+
+        apply(job);
+        recycle(std::move(job.staging));
+        if (found == targets.end())
+        {
+            targets.push_back(target);
+        }
+    }
+
+    // Jobs still hold their target
+    for (auto target: targets)
+    {
+        update(*target);
+    }
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::apply(Job& job)
+{
+    UploadTarget& target = *job.target;
+    const Rect page(0, 0, job.width, job.height);
+
+    if ((job.width != target.m_width) || (job.height != target.m_height))
+    {
+        target.m_width = job.width;
+        target.m_height = job.height;
+        target.m_shadow.resize(size_t(job.width) * size_t(job.height) * 4u);
+    }
+
+    const uint8_t* src = job.staging.data();
+    for (auto const& rect: job.rects)
+    {
+        const size_t row = size_t(rect.w) * 4u;
+        FrameCopy::copy(&target.m_shadow[4u * (size_t(rect.y) * size_t(job.width) + size_t(rect.x))],
+                        size_t(job.width) * 4u, src, row, row, size_t(rect.h));
+        src += row * size_t(rect.h);
+
+        target.m_uploaded.push_back(rect);
+        for (auto& missing: target.m_missing)
+        {
+            missing.push_back(rect);
+            if (missing.size() > MAX_MISSING_RECTS)
+            {
+                missing.assign(1u, page);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::update(UploadTarget& target)
+{
+    int back;
+    GLsync draw_fence;
+    {
+        std::lock_guard<std::mutex> lock(target.m_mutex);
+        back = 1 - target.m_front;
+
+        // Rewritten: it cannot be flipped until uploaded again
+        if (target.m_ready == back)
+        {
+            target.m_ready = -1;
+        }
+        draw_fence = target.m_draw_fence[back];
+        target.m_draw_fence[back] = nullptr;
+    }
+
+    // Do not overwrite a texture the GPU may still be drawing
+    if (draw_fence != nullptr)
+    {
+        GLCHECK(glWaitSync(draw_fence, 0, GL_TIMEOUT_IGNORED));
+        GLCHECK(glDeleteSync(draw_fence));
+    }
+
+    PooledTexture& texture = target.m_textures[back];
+    std::vector<Rect>& missing = target.m_missing[back];
+    if (!TextureBucket::fits(target.m_width, target.m_height, texture.width, texture.height))
+    {
+        m_pool.release(texture);
+        texture = m_pool.acquire(target.m_width, target.m_height);
+        missing.assign(1u, Rect(0, 0, target.m_width, target.m_height));
+    }
+
+    GLCHECK(glBindTexture(GL_TEXTURE_2D, texture.id));
+    GLCHECK(glPixelStorei(GL_UNPACK_ROW_LENGTH, target.m_width));
+    for (auto const& rect: missing)
+    {
+        GLCHECK(glPixelStorei(GL_UNPACK_SKIP_PIXELS, rect.x));
+        GLCHECK(glPixelStorei(GL_UNPACK_SKIP_ROWS, rect.y));
+        GLCHECK(glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.w, rect.h,
+                                GL_BGRA_EXT, GL_UNSIGNED_BYTE, target.m_shadow.data()));
+    }
+    GLCHECK(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+    GLCHECK(glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0));
+    GLCHECK(glPixelStorei(GL_UNPACK_SKIP_ROWS, 0));
+    GLCHECK(glBindTexture(GL_TEXTURE_2D, 0));
+    missing.clear();
+
+    // The drawing thread waits on this fence before sampling the texture
+    GLsync fence = GLCHECK(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    GLCHECK(glFlush());
+
+    std::lock_guard<std::mutex> lock(target.m_mutex);
+    target.m_page_width[back] = target.m_width;
+    target.m_page_height[back] = target.m_height;
+    if (target.m_upload_fence != nullptr)
+    {
+        GLCHECK(glDeleteSync(target.m_upload_fence));
+    }
+    target.m_upload_fence = fence;
+    target.m_ready = back;
+    target.m_painted.insert(target.m_painted.end(), target.m_uploaded.begin(),
+                            target.m_uploaded.end());
+    target.m_uploaded.clear();
+    measure(target);
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::measure(UploadTarget& target)
+{
+    target.m_bytes = target.m_textures[0].bytes() + target.m_textures[1].bytes()
+                     + target.m_shadow.capacity();
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::destroy(UploadTarget& target)
+{
+    std::lock_guard<std::mutex> lock(target.m_mutex);
+
+    GLsync fences[] = { target.m_upload_fence, target.m_draw_fence[0], target.m_draw_fence[1] };
+    for (auto fence: fences)
+    {
+        if (fence != nullptr)
+        {
+            GLCHECK(glDeleteSync(fence));
+        }
+    }
+    target.m_upload_fence = target.m_draw_fence[0] = target.m_draw_fence[1] = nullptr;
+
+    m_pool.release(target.m_textures[0]);
+    m_pool.release(target.m_textures[1]);
+    target.m_ready = -1;
+    target.m_shadow.clear();
+    target.m_shadow.shrink_to_fit();
+    measure(target);
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::shrink(UploadTarget& target)
+{
+    GLsync draw_fence = nullptr;
+    int back;
+    {
+        std::lock_guard<std::mutex> lock(target.m_mutex);
+
+        // The back texture is the last upload, waiting to be flipped: keep it
+        back = 1 - target.m_front;
+        if (target.m_ready != back)
+        {
+            draw_fence = target.m_draw_fence[back];
+            target.m_draw_fence[back] = nullptr;
+        }
+        else
+        {
+            back = -1;
+        }
+    }
+
+    if (back >= 0)
+    {
+        if (draw_fence != nullptr)
+        {
+            GLCHECK(glWaitSync(draw_fence, 0, GL_TIMEOUT_IGNORED));
+            GLCHECK(glDeleteSync(draw_fence));
+        }
+        m_pool.release(target.m_textures[back]);
+    }
+
+    target.m_shadow.clear();
+    target.m_shadow.shrink_to_fit();
+    target.m_width = target.m_height = 0;
+    target.m_missing[0].clear();
+    target.m_missing[1].clear();
+    target.m_uploaded.clear();
+    measure(target);
+
+    // Released textures are not kept for reuse
+    m_pool.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_staging.clear();
+}
+
+//------------------------------------------------------------------------------
+std::vector<uint8_t> TextureUploader::staging(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto it = m_staging.begin(); it != m_staging.end(); ++it)
+    {
+        if (it->capacity() >= bytes)
+        {
+            std::vector<uint8_t> buffer(std::move(*it));
+            m_staging.erase(it);
+            buffer.resize(bytes);
+            return buffer;
+        }
+    }
+    return std::vector<uint8_t>(bytes);
+}
+
+//------------------------------------------------------------------------------
+void TextureUploader::recycle(std::vector<uint8_t>&& buffer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_staging.size() < MAX_STAGING_BUFFERS)
+    {
+        m_staging.push_back(std::move(buffer));
+    }
+}
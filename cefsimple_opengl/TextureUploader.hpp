@@ -0,0 +1,208 @@
+// Upload web pages painted by CEF into OpenGL textures from a dedicated thread
+// so the drawing thread only composites.
+
+#ifndef TEXTUREUPLOADER_HPP
+#  define TEXTUREUPLOADER_HPP
+
+#  include <GL/glew.h>
+#  include <GLFW/glfw3.h>
+
+#  include "TexturePool.hpp"
+#  include "Region.hpp"
+
+#  include <atomic>
+#  include <condition_variable>
+#  include <cstdint>
+#  include <deque>
+#  include <memory>
+#  include <mutex>
+#  include <thread>
+#  include <vector>
+
+// ****************************************************************************
+//! \brief Pair of textures holding a page: the drawing thread samples the
+//! front one while the upload thread writes into the back one. Rectangles are
+//! in page pixels (origin at the top-left corner). Created by
+//! TextureUploader::target().
+// ****************************************************************************
+class UploadTarget
+{
+public:
+
+    //! \brief Drawing thread: make the last uploaded texture the front one.
+    //! The GPU waits for the end of its upload (the CPU does not block). Page
+    //! rectangles changed compared to the previous front texture are appended
+    //! to \c painted.
+    //! \return true if the front texture changed.
+    bool flip(std::vector<Rect>& painted);
+
+    //! \brief Drawing thread: to call after drawing the front texture so the
+    //! upload thread does not overwrite it while the GPU still reads it.
+    void drawn();
+
+    //! \brief Texture to draw (id is 0 until a page has been uploaded).
+    inline PooledTexture const& front() const
+    {
+        return m_textures[m_front];
+    }
+
+    //! \brief Dimension of the page inside the front texture.
+    inline GLsizei pageWidth() const
+    {
+        return m_page_width[m_front];
+    }
+
+    inline GLsizei pageHeight() const
+    {
+        return m_page_height[m_front];
+    }
+
+    //! \brief Memory used by both textures and the copy of the page.
+    inline size_t bytes() const
+    {
+        return m_bytes;
+    }
+
+private:
+
+    friend class TextureUploader;
+
+    //! \brief Protect the texture exchange between both threads.
+    std::mutex m_mutex;
+
+    //! \brief Double buffered textures and the page dimension they hold.
+    PooledTexture m_textures[2];
+    GLsizei m_page_width[2] = { 0, 0 };
+    GLsizei m_page_height[2] = { 0, 0 };
+    //! \brief Index of the texture sampled by the drawing thread.
+    int m_front = 0;
+    //! \brief Index of the uploaded texture waiting for flip(), else -1.
+    int m_ready = -1;
+    //! \brief Signaled when the upload of the ready texture is done.
+    GLsync m_upload_fence = nullptr;
+    //! \brief Signaled when the GPU no longer draws with each texture.
+    GLsync m_draw_fence[2] = { nullptr, nullptr };
+    //! \brief Rectangles uploaded since the last flip().
+    std::vector<Rect> m_painted;
+
+    //! \brief Upload thread only: copy of the last page and rectangles each
+    //! texture is missing compared to it.
+    std::vector<uint8_t> m_shadow;
+    GLsizei m_width = 0;
+    GLsizei m_height = 0;
+    std::vector<Rect> m_missing[2];
+    //! \brief Upload thread only: rectangles copied in m_shadow since the
+    //! last upload.
+    std::vector<Rect> m_uploaded;
+    //! \brief Set by the upload thread when textures or m_shadow change.
+    std::atomic<size_t> m_bytes{0u};
+};
+
+// ****************************************************************************
+//! \brief Upload thread owning an OpenGL context shared with the window.
+//! OnPaint() buffers are copied into pooled staging memory and queued, the
+//! thread uploads them into the back texture of their UploadTarget and
+//! signals a fence the drawing thread waits on. Pages painted several times
+//! before the thread wakes up are uploaded once. When the shared context
+//! cannot be created uploads are done on the calling thread.
+// ****************************************************************************
+class TextureUploader
+{
+public:
+
+    //! \brief Textures are taken from the given pool, which shall then only be
+    //! used through the uploader.
+    TextureUploader(TexturePool& pool);
+
+    //! \brief Finish queued uploads, stop the thread and destroy its context.
+    ~TextureUploader();
+
+    //! \brief Create the shared context and start the thread. To be called
+    //! from the main thread once the window has been created.
+    void init(GLFWwindow* window);
+
+    //! \brief Create a new pair of textures.
+    std::shared_ptr<UploadTarget> target();
+
+    //! \brief Copy the given rectangles of the BGRA8 page into staging memory
+    //! and queue their upload. Whole pages shall be given when the page
+    //! dimension changed.
+    void upload(std::shared_ptr<UploadTarget> const& target, const void* bgra,
+                GLsizei width, GLsizei height, std::vector<Rect> const& rects);
+
+    //! \brief Queue the release of the textures of the target to the pool.
+    void release(std::shared_ptr<UploadTarget> const& target);
+
+    //! \brief Queue the release of everything but the front texture: the back
+    //! texture and the copy of the page. The next upload of the target shall
+    //! be a whole page. Textures cached by the pool and free staging memory
+    //! are deleted too.
+    void trim(std::shared_ptr<UploadTarget> const& target);
+
+private:
+
+    // *************************************************************************
+    //! \brief Queued page rectangles, packed row by row in staging memory.
+    // *************************************************************************
+    struct Job
+    {
+        std::shared_ptr<UploadTarget> target;
+        std::vector<uint8_t> staging;
+        std::vector<Rect> rects;
+        GLsizei width = 0;
+        GLsizei height = 0;
+        //! \brief Release the target instead of uploading.
+        bool release = false;
+        //! \brief Trim the target instead of uploading.
+        bool trim = false;
+    };
+
+    //! \brief Upload thread main loop.
+    void run();
+
+    //! \brief Copy queued jobs into page shadows, then upload each touched
+    //! target once.
+    void process(std::deque<Job>& jobs);
+
+    //! \brief Copy the job rectangles into the page shadow of its target.
+    void apply(Job& job);
+
+    //! \brief Upload what the back texture of the target is missing.
+    void update(UploadTarget& target);
+
+    //! \brief Give back textures and fences of the target.
+    void destroy(UploadTarget& target);
+
+    //! \brief Give back the back texture and the page copy of the target.
+    void shrink(UploadTarget& target);
+
+    //! \brief Update the memory used by the target.
+    void measure(UploadTarget& target);
+
+    //! \brief Queue a job (or process it when there is no upload thread).
+    void push(Job&& job);
+
+    //! \brief Get staging memory of the given size (reused when possible).
+    std::vector<uint8_t> staging(size_t bytes);
+
+    //! \brief Give back staging memory.
+    void recycle(std::vector<uint8_t>&& buffer);
+
+private:
+
+    TexturePool& m_pool;
+
+    //! \brief Hidden window holding the context shared with the main one.
+    GLFWwindow* m_context = nullptr;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<Job> m_jobs;
+    bool m_quit = false;
+
+    //! \brief Free staging memory (guarded by m_mutex).
+    std::vector<std::vector<uint8_t>> m_staging;
+};
+
+#endif // TEXTUREUPLOADER_HPP
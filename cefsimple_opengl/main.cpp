@@ -1,4 +1,6 @@
 #include "CEFGLWindow.hpp"
+#include "BrowserApp.hpp"
+#include "BrowserCache.hpp"
 
 //------------------------------------------------------------------------------
 static void CEFsetUp(int argc, char** argv)
@@ -14,7 +16,8 @@ static void CEFsetUp(int argc, char** argv)
     // |windows_sandbox_info| parameter is only used on Windows and may be NULL (see
     // cef_sandbox_win.h for details).
     CefMainArgs args(argc, argv);
-    int exit_code = CefExecuteProcess(args, nullptr, nullptr);
+    CefRefPtr<BrowserApp> app = new BrowserApp();
+    int exit_code = CefExecuteProcess(args, app, nullptr);
     if (exit_code >= 0)
     {
         // Sub proccess has endend, so exit
@@ -31,13 +34,19 @@ static void CEFsetUp(int argc, char** argv)
     //CefString(&settings.locales_dir_path) = "/home/qq/MyGitHub/OffScreenCEF/godot/locales";
     //CefString(&settings.resources_dir_path) = "/home/qq/MyGitHub/OffScreenCEF/godot/";
     //CefString(&settings.framework_dir_path) = "/home/qq/MyGitHub/OffScreenCEF/godot/";
-    //CefString(&settings.cache_path) = "/home/qq/MyGitHub/OffScreenCEF/godot/";
     settings.windowless_rendering_enabled = true;
 #if !defined(CEF_USE_SANDBOX)
     settings.no_sandbox = true;
 #endif
 
-    bool result = CefInitialize(args, settings, nullptr, nullptr);
+    // Persistent caches for warm starts (--cache-dir, --cache-mode ...)
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::CreateCommandLine();
+    command_line->InitFromArgv(argc, argv);
+    BrowserCache::global().configure(command_line, settings);
+
+    // The application selects the performance profile (--perf-profile=name)
+    // and applies it to all CEF processes.
+    bool result = CefInitialize(args, settings, app, nullptr);
     if (!result)
     {
         std::cerr << "CefInitialize: failed" << std::endl;
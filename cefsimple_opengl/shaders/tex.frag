@@ -6,10 +6,9 @@ out vec4 outputColor;
 
 uniform sampler2D tex;
 
+// Transparent pages: CEF paints premultiplied alpha, to be blended with
+// glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA). No discard: it would disable
+// early depth test.
 void main() {
   outputColor = texture2D(tex, Texcoord);
-  if (outputColor.a < 0.1)
-  {
-    discard;
-  }
 }
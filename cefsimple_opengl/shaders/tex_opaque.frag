@@ -0,0 +1,12 @@
+#version 150
+
+in vec2 Texcoord;
+
+out vec4 outputColor;
+
+uniform sampler2D tex;
+
+// Opaque pages: drawn without blending.
+void main() {
+  outputColor = vec4(texture2D(tex, Texcoord).rgb, 1.0);
+}
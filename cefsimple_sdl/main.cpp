@@ -3,6 +3,7 @@
 #include <sstream>
 #include <cassert>
 #include <mutex>
+#include <algorithm>
 #include <atomic>
 
 #include <cef_app.h>
@@ -15,23 +16,44 @@
 #include <SDL2/SDL.h>
 #include <SDL_image.h>
 #include "sdl_cef_events.hpp"
+#include "sdl_cef_audio.hpp"
+#include "sdl_texture_pool.hpp"
+#include "TextureBucket.hpp"
+#include "FrameCopy.hpp"
+#include "FramePipeline.hpp"
+#include "ResizeDebouncer.hpp"
+#include "BrowserApp.hpp"
+#include "BrowserCache.hpp"
+#include "MemoryGovernor.hpp"
+#include "RequestFilter.hpp"
 
 class RenderHandler: public CefRenderHandler
 {
 public:
 
-    RenderHandler(SDL_Renderer& renderer, int w, int h)
-        : m_renderer(renderer)
+    RenderHandler(SDL_Renderer& renderer, SDLTexturePool& pool, int w, int h)
+        : m_renderer(renderer), m_pool(pool), m_width(w), m_height(h),
+          m_pipeline("sdl")
     {
-        resize(w, h);
+        // Copy a tile of the page into the locked part of the texture
+        m_pipeline.stage("copy", [this](FrameTile const& tile)
+        {
+            unsigned char* dst = m_painting.pixels
+                + (tile.y - m_painting.area.y) * m_painting.pitch
+                + (tile.x - m_painting.area.x) * 4;
+            const unsigned char* src = m_painting.page
+                + (static_cast<size_t>(tile.y) * m_page_width + tile.x) * 4;
+            FrameCopy::copy(dst, static_cast<size_t>(m_painting.pitch), src,
+                            static_cast<size_t>(m_page_width * 4),
+                            static_cast<size_t>(tile.width * 4),
+                            static_cast<size_t>(tile.height));
+        });
     }
 
     ~RenderHandler()
     {
-        if (m_texture != nullptr)
-        {
-            SDL_DestroyTexture(m_texture);
-        }
+        std::lock_guard<std::mutex> locker(m_mutex_texture);
+        m_pool.release(m_texture);
     }
 
     virtual void GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect) override
@@ -40,61 +62,138 @@ public:
     }
 
     virtual void OnPaint(CefRefPtr<CefBrowser> browser, PaintElementType type,
-                         const RectList &dirtyRects, const void* buffer,
+                         const RectList& dirtyRects, const void* buffer,
                          int w, int h) override
     {
-        resize(w, h); // FIXME: I dunno why this avoid segfault
+        // Popup widgets (i.e. <select>) are not composited yet
+        if (type != PET_VIEW)
+            return ;
+
         std::lock_guard<std::mutex> locker(m_mutex_texture);
 
-        if ((m_texture == nullptr) || (buffer == nullptr) || (w <= 0) || (h <= 0)) {
+        if ((buffer == nullptr) || (w <= 0) || (h <= 0)) {
             std::cerr << "OnPaint: bad texture or bad size" << std::endl;
             return ;
         }
 
+        // The page may be painted at a size not yet seen by resize()
+        reserve(w, h);
+        if (m_texture.texture == nullptr) {
+            std::cerr << "OnPaint: bad texture or bad size" << std::endl;
+            return ;
+        }
+
+        // Only the bounding box of dirty rectangles is locked, unless the
+        // texture or the page size changed. Locked pixels are write-only so
+        // the whole box is copied.
+        SDL_Rect area = { 0, 0, w, h };
+        if ((m_page_width == w) && (m_page_height == h) && !dirtyRects.empty())
+        {
+            int x0 = w, y0 = h, x1 = 0, y1 = 0;
+            for (auto const& rect: dirtyRects)
+            {
+                x0 = std::min(x0, std::max(0, rect.x));
+                y0 = std::min(y0, std::max(0, rect.y));
+                x1 = std::max(x1, std::min(w, rect.x + rect.width));
+                y1 = std::max(y1, std::min(h, rect.y + rect.height));
+            }
+            if ((x1 <= x0) || (y1 <= y0))
+                return ;
+            area = { x0, y0, x1 - x0, y1 - y0 };
+        }
+        m_page_width = w;
+        m_page_height = h;
+
+        // Copy the box into the pooled texture (the page is in its top-left
+        // corner), tile by tile on several cores.
         unsigned char* texture_data = nullptr;
         int texture_pitch = 0;
 
-        SDL_LockTexture(m_texture, nullptr, (void**) &texture_data, &texture_pitch);
-        memcpy(texture_data, buffer, static_cast<size_t>(w * h * 4));
-        SDL_UnlockTexture(m_texture);
+        if (SDL_LockTexture(m_texture.texture, &area, (void**) &texture_data,
+                            &texture_pitch) != 0) {
+            return ;
+        }
+
+        m_painting = { static_cast<const unsigned char*>(buffer), texture_data,
+                       texture_pitch, area };
+        m_pipeline.process({ FrameTile{ area.x, area.y, area.w, area.h } });
+        SDL_UnlockTexture(m_texture.texture);
     }
 
+    //! \brief Change the view size given to CEF. The texture is adapted by
+    //! the next OnPaint() so the previous page keeps being drawn meanwhile.
     void resize(int w, int h)
     {
         std::lock_guard<std::mutex> locker(m_mutex_texture);
 
-        if ((w == m_width) && (h == m_height)) {
-            return ;
-        }
-
-        if (m_texture != nullptr) {
-            SDL_DestroyTexture(m_texture);
-        }
-
-        m_texture = SDL_CreateTexture(&m_renderer, SDL_PIXELFORMAT_UNKNOWN,
-                                      SDL_TEXTUREACCESS_STREAMING, w, h);
-        assert(m_texture != nullptr);
         m_width = w;
         m_height = h;
     }
 
+    //! \brief Video memory of the texture holding the page.
+    size_t textureBytes()
+    {
+        std::lock_guard<std::mutex> locker(m_mutex_texture);
+        return m_texture.bytes();
+    }
+
     void render()
     {
         std::lock_guard<std::mutex> locker(m_mutex_texture);
 
-        if (m_texture != nullptr)
+        if ((m_texture.texture != nullptr) && (m_page_width > 0))
         {
-            SDL_RenderCopy(&m_renderer, m_texture, nullptr, nullptr);
+            // Stretched to the window until the page is painted at its size
+            SDL_Rect page = { 0, 0, m_page_width, m_page_height };
+            SDL_RenderCopy(&m_renderer, m_texture.texture, &page, nullptr);
         }
     }
 
+private:
+
+    //! \brief Make sure the texture can hold a page of the given size. The
+    //! texture is only swapped when the size leaves its bucket so resizing the
+    //! window does not recreate a texture for every intermediate size.
+    //! m_mutex_texture shall be locked.
+    void reserve(int w, int h)
+    {
+        if ((w <= 0) || (h <= 0)) {
+            return ;
+        }
+
+        if ((m_texture.texture != nullptr) &&
+            TextureBucket::fits(w, h, m_texture.width, m_texture.height)) {
+            return ;
+        }
+
+        m_pool.release(m_texture);
+        m_texture = m_pool.acquire(w, h);
+        m_page_width = m_page_height = 0;
+    }
+
 private:
 
     SDL_Renderer& m_renderer;
-    SDL_Texture* m_texture = nullptr;
-    std::mutex m_mutex_texture;
+    SDLTexturePool& m_pool;
+    //! \brief View size given to CEF
     int m_width = 0;
     int m_height = 0;
+    PooledSDLTexture m_texture;
+    std::mutex m_mutex_texture;
+    //! \brief Size of the last painted page inside m_texture
+    int m_page_width = 0;
+    int m_page_height = 0;
+
+    //! \brief Page being copied by m_pipeline into the locked texture area.
+    struct Painting
+    {
+        const unsigned char* page;
+        unsigned char* pixels;
+        int pitch;
+        SDL_Rect area;
+    } m_painting = { nullptr, nullptr, 0, { 0, 0, 0, 0 } };
+    //! \brief Process painted pages on several cores.
+    FramePipeline m_pipeline;
 
     IMPLEMENT_REFCOUNTING(RenderHandler);
 };
@@ -102,12 +201,13 @@ private:
 // for manual render handler
 class BrowserClient: public CefClient,
                      public CefLifeSpanHandler,
-                     public CefLoadHandler
+                     public CefLoadHandler,
+                     public CefRequestHandler
 {
 public:
 
-    BrowserClient(CefRefPtr<CefRenderHandler> ptr)
-        : m_handler(ptr)
+    BrowserClient(CefRefPtr<CefRenderHandler> ptr, CefRefPtr<CefAudioHandler> audio)
+        : m_handler(ptr), m_audio(audio)
     {
         assert(ptr != nullptr);
     }
@@ -127,6 +227,26 @@ public:
         return m_handler;
     }
 
+    virtual CefRefPtr<CefAudioHandler> GetAudioHandler() override
+    {
+        return m_audio;
+    }
+
+    virtual CefRefPtr<CefRequestHandler> GetRequestHandler() override
+    {
+        return this;
+    }
+
+    // CefRequestHandler methods: block requests and share responses with
+    // other browsers.
+    virtual CefRefPtr<CefResourceRequestHandler> GetResourceRequestHandler(
+        CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
+        CefRefPtr<CefRequest> request, bool is_navigation, bool is_download,
+        const CefString& request_initiator, bool& disable_default_handling) override
+    {
+        return m_filter;
+    }
+
     // CefLifeSpanHandler methods.
     virtual void OnAfterCreated(CefRefPtr<CefBrowser> browser) override
     {
@@ -170,6 +290,10 @@ public:
                                       bool canGoBack, bool canGoForward) override
     {
         std::cout << "OnLoadingStateChange()" << std::endl;
+        if (!isLoading)
+        {
+            m_filter->log(browser->GetIdentifier());
+        }
     }
 
     // FIXME virtual override ?
@@ -204,10 +328,77 @@ private:
     std::atomic<bool> m_closing{false};
     std::atomic<bool> m_loaded{false};
     CefRefPtr<CefRenderHandler> m_handler = nullptr;
+    CefRefPtr<CefAudioHandler> m_audio = nullptr;
+    CefRefPtr<RequestFilter> m_filter = new RequestFilter();
 
     IMPLEMENT_REFCOUNTING(BrowserClient);
 };
 
+// ****************************************************************************
+//! \brief The browser of the window as seen by the memory governor. The
+//! window has a single browser: it is never hibernated.
+// ****************************************************************************
+class GovernedView: public MemoryGovernor::View
+{
+public:
+
+    //! \brief Browser and handler are referenced: once reset by the caller
+    //! the view has no browser.
+    GovernedView(CefRefPtr<CefBrowser> const& browser,
+                 CefRefPtr<RenderHandler> const& handler, SDLTexturePool& pool)
+        : m_browser(browser), m_handler(handler), m_pool(pool)
+    {}
+
+    virtual CefRefPtr<CefBrowser> browser() const override
+    {
+        return m_browser;
+    }
+
+    virtual size_t textureBytes() const override
+    {
+        return m_handler->textureBytes();
+    }
+
+    //! \brief The texture in use is needed: only cached ones are destroyed.
+    virtual void trim() override
+    {
+        m_pool.clear();
+    }
+
+    virtual bool hibernate() override
+    {
+        return false;
+    }
+
+    virtual bool visible() const override
+    {
+        return m_visible;
+    }
+
+    virtual std::chrono::steady_clock::time_point lastUsed() const override
+    {
+        return m_visible ? std::chrono::steady_clock::now() : m_hidden_since;
+    }
+
+    //! \brief Called when the window is shown or hidden.
+    void visible(bool visible)
+    {
+        m_visible = visible;
+        if (!visible)
+        {
+            m_hidden_since = std::chrono::steady_clock::now();
+        }
+    }
+
+private:
+
+    CefRefPtr<CefBrowser> const& m_browser;
+    CefRefPtr<RenderHandler> const& m_handler;
+    SDLTexturePool& m_pool;
+    bool m_visible = true;
+    std::chrono::steady_clock::time_point m_hidden_since;
+};
+
 CefBrowserHost::MouseButtonType translateMouseButton(SDL_MouseButtonEvent const &e)
 {
     CefBrowserHost::MouseButtonType result;
@@ -243,10 +434,11 @@ int main(int argc, char * argv[])
     // |windows_sandbox_info| parameter is only used on Windows and may be nullptr (see
     // cef_sandbox_win.h for details).
     CefMainArgs args(argc, argv);
-    int result = CefExecuteProcess(args, nullptr, nullptr);
 
-    // checkout CefApp, derive it and set it as second parameter, for more control on
-    // command args and resources.
+    // BrowserApp applies the performance profile (--perf-profile=name) to the
+    // command line of all CEF processes.
+    CefRefPtr<BrowserApp> app = new BrowserApp();
+    int result = CefExecuteProcess(args, app, nullptr);
     if (result >= 0)
     {
         // Forked process has ended, so exit
@@ -268,18 +460,24 @@ int main(int argc, char * argv[])
     settings.no_sandbox = true;
 #endif
 
+    // Persistent caches for warm starts (--cache-dir, --cache-mode ...)
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::CreateCommandLine();
+    command_line->InitFromArgv(argc, argv);
+    BrowserCache::global().configure(command_line, settings);
+
     // CefInitialize creates a sub-proccess and executes the same executeable,
     // as calling CefInitialize, if not set different in
     // settings.browser_subprocess_path if you create an extra program just for
     // the childproccess you only have to call CefExecuteProcess(...) in it.
-    if (!CefInitialize(args, settings, nullptr, nullptr))
+    if (!CefInitialize(args, settings, app, nullptr))
     {
         // handle error
         return EXIT_FAILURE;
     }
 
-    // Initialize SDL
-    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    // Initialize SDL. Audio works with the dummy driver too
+    // (SDL_AUDIODRIVER=dummy) for machines without sound card.
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
     {
         std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
         return EXIT_FAILURE;
@@ -311,12 +509,19 @@ int main(int argc, char * argv[])
             return EXIT_FAILURE;
         }
 
+        // Textures holding the web page, recycled while resizing
+        SDLTexturePool texturePool(*m_renderer);
+
         CefRefPtr<RenderHandler> renderHandler =
-                new RenderHandler(*m_renderer, width, height);
+                new RenderHandler(*m_renderer, texturePool, width, height);
         assert(renderHandler != nullptr);
 
+        // Mix audio of all browsers into the SDL audio device
+        AudioMixer audioMixer;
+        CefRefPtr<AudioHandler> audioHandler = new AudioHandler(audioMixer);
+
         CefRefPtr<BrowserClient> browserClient;
-        browserClient = new BrowserClient(renderHandler);
+        browserClient = new BrowserClient(renderHandler, audioHandler);
         assert(browserClient != nullptr);
 
         CefBrowserSettings browserSettings;
@@ -342,7 +547,13 @@ int main(int argc, char * argv[])
         // browser->GetHost()->SendMouseClickEvent(...);
         // browser->GetHost()->SendMouseWheelEvent(...);
 
+        // Keep the texture and the renderer in the memory budget
+        MemoryGovernor memoryGovernor;
+        GovernedView governedView(browser, renderHandler, texturePool);
+        const std::vector<MemoryGovernor::View*> governedViews = { &governedView };
+
         SDL_Event e;
+        ResizeDebouncer resizeDebouncer;
         bool shutdown = false;
         //bool js_executed = false;
 
@@ -367,8 +578,9 @@ int main(int argc, char * argv[])
                     switch (e.window.event)
                     {
                     case SDL_WINDOWEVENT_SIZE_CHANGED:
-                        renderHandler->resize(e.window.data1, e.window.data2);
-                        browser->GetHost()->WasResized();
+                        // The last frame is stretched to the window until
+                        // the resize settles down.
+                        resizeDebouncer.request(e.window.data1, e.window.data2);
                         break;
 
                     case SDL_WINDOWEVENT_FOCUS_GAINED:
@@ -383,12 +595,14 @@ int main(int argc, char * argv[])
                     case SDL_WINDOWEVENT_MINIMIZED:
                         // browser->GetHost()->SetWindowVisibility(false);
                         browser->GetHost()->WasHidden(true);
+                        governedView.visible(false);
                         break;
 
                     case SDL_WINDOWEVENT_SHOWN:
                     case SDL_WINDOWEVENT_RESTORED:
                         //browser->GetHost()->SetWindowVisibility(true);
                         browser->GetHost()->WasHidden(false);
+                        governedView.visible(true);
                         break;
 
                     case SDL_WINDOWEVENT_CLOSE:
@@ -461,8 +675,17 @@ int main(int argc, char * argv[])
             }
 #endif
 
+            // Make CEF re-layout the page at most once per debounce interval
+            int resizedWidth, resizedHeight;
+            if (resizeDebouncer.poll(resizedWidth, resizedHeight))
+            {
+                renderHandler->resize(resizedWidth, resizedHeight);
+                browser->GetHost()->WasResized();
+            }
+
             // let browser process events
             CefDoMessageLoopWork();
+            memoryGovernor.update(governedViews);
 
             // render
             SDL_RenderClear(m_renderer);
@@ -476,9 +699,11 @@ int main(int argc, char * argv[])
         browser = nullptr;
         browserClient = nullptr;
         renderHandler = nullptr;
+        audioHandler = nullptr;
 
         CefShutdown();
 
+        texturePool.clear();
         SDL_DestroyRenderer(m_renderer);
     }
 
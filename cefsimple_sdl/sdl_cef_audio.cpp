@@ -0,0 +1,287 @@
+//
+// Route Chromium audio streams to SDL2 audio.
+//
+
+#include "sdl_cef_audio.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+//! \brief Device channels: Chromium streams are downmixed/upmixed to stereo.
+static const int OUTPUT_CHANNELS = 2;
+//! \brief Ring depth in milliseconds. Only filled when the producer is ahead
+//! of the device, so this is a bound, not the latency.
+static const int RING_DEPTH_MS = 200;
+
+//------------------------------------------------------------------------------
+AudioStream::AudioStream(int device_rate, int source_rate, int channels)
+    : m_device_rate(device_rate),
+      m_source_rate(source_rate),
+      m_channels(channels),
+      m_ring(size_t(device_rate * RING_DEPTH_MS / 1000 * OUTPUT_CHANNELS))
+{}
+
+//------------------------------------------------------------------------------
+void AudioStream::write(const float** data, int frames)
+{
+    if ((data == nullptr) || (frames <= 0) || (m_channels <= 0))
+        return ;
+
+    // Stereo view of a planar source frame (mono is duplicated, extra
+    // channels beyond the front pair are ignored).
+    const float* left = data[0];
+    const float* right = (m_channels > 1) ? data[1] : data[0];
+
+    if (m_source_rate == m_device_rate)
+    {
+        m_resampled.resize(size_t(frames * OUTPUT_CHANNELS));
+        for (int i = 0; i < frames; ++i)
+        {
+            m_resampled[2 * i] = left[i];
+            m_resampled[2 * i + 1] = right[i];
+        }
+    }
+    else
+    {
+        // Linear interpolation. m_position is relative to the first frame of
+        // this packet; -1 is the last frame of the previous packet.
+        const double step = double(m_source_rate) / double(m_device_rate);
+        m_resampled.clear();
+        while (m_position < double(frames - 1))
+        {
+            const int i = int(m_position < 0.0 ? -1 : m_position);
+            const float t = float(m_position - double(i));
+            const float l0 = (i < 0) ? m_last[0] : left[i];
+            const float r0 = (i < 0) ? m_last[1] : right[i];
+            m_resampled.push_back(l0 + t * (left[i + 1] - l0));
+            m_resampled.push_back(r0 + t * (right[i + 1] - r0));
+            m_position += step;
+        }
+        m_position -= double(frames);
+        m_last[0] = left[frames - 1];
+        m_last[1] = right[frames - 1];
+    }
+
+    const size_t written = m_ring.push(m_resampled.data(), m_resampled.size());
+    m_overruns += (m_resampled.size() - written) / OUTPUT_CHANNELS;
+    m_max_queued = std::max(m_max_queued.load(), m_ring.size());
+}
+
+//------------------------------------------------------------------------------
+void AudioStream::mixInto(float* out, int frames, float gain)
+{
+    const size_t wanted = size_t(frames * OUTPUT_CHANNELS);
+    m_popped.resize(wanted);
+
+    const size_t got = m_ring.pop(m_popped.data(), wanted);
+    for (size_t i = 0; i < got; ++i)
+    {
+        out[i] += gain * m_popped[i];
+    }
+    m_underruns += (wanted - got) / OUTPUT_CHANNELS;
+}
+
+//------------------------------------------------------------------------------
+float AudioStream::latencyMs() const
+{
+    return 1000.0f * float(m_ring.size() / OUTPUT_CHANNELS) / float(m_device_rate);
+}
+
+//------------------------------------------------------------------------------
+float AudioStream::maxLatencyMs() const
+{
+    return 1000.0f * float(m_max_queued / OUTPUT_CHANNELS) / float(m_device_rate);
+}
+
+//------------------------------------------------------------------------------
+AudioMixer::AudioMixer(int sample_rate, int buffer_frames)
+{
+    SDL_AudioSpec wanted;
+    SDL_zero(wanted);
+    wanted.freq = sample_rate;
+    wanted.format = AUDIO_F32SYS;
+    wanted.channels = OUTPUT_CHANNELS;
+    wanted.samples = Uint16(buffer_frames);
+    wanted.callback = AudioMixer::callback;
+    wanted.userdata = this;
+
+    SDL_zero(m_spec);
+    m_device = SDL_OpenAudioDevice(nullptr, 0, &wanted, &m_spec,
+                                   SDL_AUDIO_ALLOW_FREQUENCY_CHANGE |
+                                   SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+    if (m_device == 0)
+    {
+        std::cerr << "SDL could not open audio! SDL_Error: "
+                  << SDL_GetError() << std::endl;
+        return ;
+    }
+
+    std::cout << "Audio: " << m_spec.freq << " Hz, " << m_spec.samples
+              << " frames period (" << SDL_GetCurrentAudioDriver() << ")"
+              << std::endl;
+    SDL_PauseAudioDevice(m_device, 0);
+}
+
+//------------------------------------------------------------------------------
+AudioMixer::~AudioMixer()
+{
+    if (m_device != 0)
+    {
+        SDL_CloseAudioDevice(m_device);
+    }
+}
+
+//------------------------------------------------------------------------------
+void AudioMixer::addStream(int browser_id, int source_rate, int channels)
+{
+    if (!isOpen())
+        return ;
+
+    // Allocate outside the audio lock
+    Channel channel;
+    channel.stream = std::make_shared<AudioStream>(m_spec.freq, source_rate, channels);
+
+    std::lock_guard<std::mutex> locker(m_mutex);
+    SDL_LockAudioDevice(m_device);
+    m_channels[browser_id] = channel;
+    SDL_UnlockAudioDevice(m_device);
+}
+
+//------------------------------------------------------------------------------
+void AudioMixer::removeStream(int browser_id)
+{
+    if (!isOpen())
+        return ;
+
+    // Keep the stream alive until the callback can no longer reach it
+    std::shared_ptr<AudioStream> stream;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        auto it = m_channels.find(browser_id);
+        if (it == m_channels.end())
+            return ;
+
+        stream = it->second.stream;
+        SDL_LockAudioDevice(m_device);
+        m_channels.erase(it);
+        SDL_UnlockAudioDevice(m_device);
+    }
+
+    const float device = 1000.0f * float(m_spec.samples) / float(m_spec.freq);
+    std::cout << "Audio stream " << browser_id << " stopped: max latency "
+              << stream->maxLatencyMs() + device << " ms, "
+              << stream->underruns() << " underruns, "
+              << stream->overruns() << " overruns" << std::endl;
+}
+
+//------------------------------------------------------------------------------
+void AudioMixer::write(int browser_id, const float** data, int frames)
+{
+    std::shared_ptr<AudioStream> stream;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        auto it = m_channels.find(browser_id);
+        if (it == m_channels.end())
+            return ;
+        stream = it->second.stream;
+    }
+
+    stream->write(data, frames);
+}
+
+//------------------------------------------------------------------------------
+void AudioMixer::gain(int browser_id, float gain)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    auto it = m_channels.find(browser_id);
+    if (it != m_channels.end())
+    {
+        SDL_LockAudioDevice(m_device);
+        it->second.gain = std::max(0.0f, std::min(1.0f, gain));
+        SDL_UnlockAudioDevice(m_device);
+    }
+}
+
+//------------------------------------------------------------------------------
+float AudioMixer::latencyMs(int browser_id)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    auto it = m_channels.find(browser_id);
+    if (it == m_channels.end())
+        return -1.0f;
+
+    const float device = 1000.0f * float(m_spec.samples) / float(m_spec.freq);
+    return it->second.stream->latencyMs() + device;
+}
+
+//------------------------------------------------------------------------------
+void AudioMixer::callback(void* userdata, Uint8* stream, int len)
+{
+    AudioMixer* self = static_cast<AudioMixer*>(userdata);
+    const int frames = len / int(sizeof(float) * OUTPUT_CHANNELS);
+    self->mix(reinterpret_cast<float*>(stream), frames);
+}
+
+//------------------------------------------------------------------------------
+void AudioMixer::mix(float* out, int frames)
+{
+    const size_t count = size_t(frames * OUTPUT_CHANNELS);
+    std::fill(out, out + count, 0.0f);
+
+    for (auto& it: m_channels)
+    {
+        it.second.stream->mixInto(out, frames, it.second.gain);
+    }
+
+    // Hard clip the sum of the streams
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = std::max(-1.0f, std::min(1.0f, out[i]));
+    }
+}
+
+//------------------------------------------------------------------------------
+bool AudioHandler::GetAudioParameters(CefRefPtr<CefBrowser> browser,
+                                      CefAudioParameters& params)
+{
+    if (m_mixer.isOpen())
+    {
+        params.sample_rate = m_mixer.sampleRate();
+        params.frames_per_buffer = m_mixer.bufferFrames();
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void AudioHandler::OnAudioStreamStarted(CefRefPtr<CefBrowser> browser,
+                                        const CefAudioParameters& params,
+                                        int channels)
+{
+    std::cout << "Audio stream " << browser->GetIdentifier() << " started: "
+              << params.sample_rate << " Hz, " << channels << " channels"
+              << std::endl;
+    m_mixer.addStream(browser->GetIdentifier(), params.sample_rate, channels);
+}
+
+//------------------------------------------------------------------------------
+void AudioHandler::OnAudioStreamPacket(CefRefPtr<CefBrowser> browser,
+                                       const float** data, int frames,
+                                       int64_t pts)
+{
+    m_mixer.write(browser->GetIdentifier(), data, frames);
+}
+
+//------------------------------------------------------------------------------
+void AudioHandler::OnAudioStreamStopped(CefRefPtr<CefBrowser> browser)
+{
+    m_mixer.removeStream(browser->GetIdentifier());
+}
+
+//------------------------------------------------------------------------------
+void AudioHandler::OnAudioStreamError(CefRefPtr<CefBrowser> browser,
+                                      const CefString& message)
+{
+    std::cerr << "Audio stream " << browser->GetIdentifier() << " error: "
+              << message.ToString() << std::endl;
+    m_mixer.removeStream(browser->GetIdentifier());
+}
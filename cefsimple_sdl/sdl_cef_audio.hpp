@@ -0,0 +1,192 @@
+//
+// Route Chromium audio streams to SDL2 audio. Each browser owns a stream fed
+// by CEF audio threads through a lock-free ring. The SDL audio callback mixes
+// all streams together.
+//
+
+#ifndef CEF_SDL_CEF_AUDIO_H
+#  define CEF_SDL_CEF_AUDIO_H
+
+#include <SDL2/SDL.h>
+#include <cef_audio_handler.h>
+#include "SpscRing.hpp"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ****************************************************************************
+//! \brief Audio samples of a single browser, converted to the device format
+//! (interleaved stereo float at the device sample rate).
+// ****************************************************************************
+class AudioStream
+{
+public:
+
+    //! \brief \c device_rate is the SDL device sample rate, \c source_rate
+    //! the one of the Chromium stream, \c channels the Chromium channels.
+    AudioStream(int device_rate, int source_rate, int channels);
+
+    //! \brief Producer side (CEF audio thread): downmix/upmix planar samples
+    //! to stereo, resample them and push them into the ring.
+    void write(const float** data, int frames);
+
+    //! \brief Consumer side (SDL audio thread): add \c frames stereo frames
+    //! to \c out. Missing samples are counted as underruns.
+    void mixInto(float* out, int frames, float gain);
+
+    //! \brief Latency added by the ring in milliseconds.
+    float latencyMs() const;
+
+    //! \brief Highest latency added by the ring since the stream started.
+    float maxLatencyMs() const;
+
+    //! \brief Number of frames dropped because the ring was full.
+    inline size_t overruns() const
+    {
+        return m_overruns;
+    }
+
+    //! \brief Number of frames missing when the device asked for them.
+    inline size_t underruns() const
+    {
+        return m_underruns;
+    }
+
+private:
+
+    int m_device_rate;
+    int m_source_rate;
+    int m_channels;
+
+    //! \brief Interleaved stereo samples
+    SpscRing<float> m_ring;
+    //! \brief Producer scratch buffer (no allocation on the audio thread
+    //! after the first packets).
+    std::vector<float> m_resampled;
+    //! \brief Consumer scratch buffer
+    std::vector<float> m_popped;
+
+    //! \brief Linear resampler: fractional read position and last frame of
+    //! the previous packet to interpolate across packet boundaries.
+    double m_position = 0.0;
+    float m_last[2] = { 0.0f, 0.0f };
+
+    //! \brief Highest ring fill level seen by the producer (in samples).
+    std::atomic<size_t> m_max_queued{0u};
+    std::atomic<size_t> m_overruns{0u};
+    std::atomic<size_t> m_underruns{0u};
+};
+
+// ****************************************************************************
+//! \brief Open the SDL audio device and mix all browser streams into it.
+//! Streams are identified by the browser identifier.
+// ****************************************************************************
+class AudioMixer
+{
+public:
+
+    //! \brief Open the default SDL audio device (SDL_INIT_AUDIO shall have been
+    //! called). \c buffer_frames is the device period: the smaller, the lower
+    //! the latency.
+    AudioMixer(int sample_rate = 48000, int buffer_frames = 256);
+
+    ~AudioMixer();
+
+    //! \brief Return true if the SDL audio device has been opened.
+    inline bool isOpen() const
+    {
+        return m_device != 0;
+    }
+
+    //! \brief Sample rate obtained from SDL.
+    inline int sampleRate() const
+    {
+        return m_spec.freq;
+    }
+
+    //! \brief Device period obtained from SDL (in frames).
+    inline int bufferFrames() const
+    {
+        return m_spec.samples;
+    }
+
+    //! \brief Create the stream of the given browser.
+    void addStream(int browser_id, int source_rate, int channels);
+
+    //! \brief Destroy the stream of the given browser.
+    void removeStream(int browser_id);
+
+    //! \brief Feed the stream of the given browser (CEF audio thread).
+    void write(int browser_id, const float** data, int frames);
+
+    //! \brief Set the volume [0 .. 1] of the given browser.
+    void gain(int browser_id, float gain);
+
+    //! \brief Total latency (ring + device period) in milliseconds added to
+    //! the stream of the given browser. Return -1 if the stream does not exist.
+    float latencyMs(int browser_id);
+
+private:
+
+    //! \brief SDL audio callback.
+    static void callback(void* userdata, Uint8* stream, int len);
+    void mix(float* out, int frames);
+
+private:
+
+    struct Channel
+    {
+        std::shared_ptr<AudioStream> stream;
+        float gain = 1.0f;
+    };
+
+    SDL_AudioDeviceID m_device = 0;
+    SDL_AudioSpec m_spec;
+    //! \brief Modified under both m_mutex (CEF threads looking for their
+    //! stream) and SDL_LockAudioDevice() (so the callback never sees a half
+    //! updated map). Samples themselves never cross a lock.
+    std::map<int, Channel> m_channels;
+    std::mutex m_mutex;
+};
+
+// ****************************************************************************
+//! \brief CEF audio handler pushing PCM of all browsers of a client into the
+//! mixer.
+// ****************************************************************************
+class AudioHandler: public CefAudioHandler
+{
+public:
+
+    AudioHandler(AudioMixer& mixer)
+        : m_mixer(mixer)
+    {}
+
+    //! \brief Ask Chromium to produce samples at the device rate so the
+    //! resampler is bypassed.
+    virtual bool GetAudioParameters(CefRefPtr<CefBrowser> browser,
+                                    CefAudioParameters& params) override;
+
+    virtual void OnAudioStreamStarted(CefRefPtr<CefBrowser> browser,
+                                      const CefAudioParameters& params,
+                                      int channels) override;
+
+    virtual void OnAudioStreamPacket(CefRefPtr<CefBrowser> browser,
+                                     const float** data, int frames,
+                                     int64_t pts) override;
+
+    virtual void OnAudioStreamStopped(CefRefPtr<CefBrowser> browser) override;
+
+    virtual void OnAudioStreamError(CefRefPtr<CefBrowser> browser,
+                                    const CefString& message) override;
+
+private:
+
+    AudioMixer& m_mixer;
+
+    IMPLEMENT_REFCOUNTING(AudioHandler);
+};
+
+#endif // CEF_SDL_CEF_AUDIO_H
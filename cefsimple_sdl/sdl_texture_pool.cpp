@@ -0,0 +1,81 @@
+//
+// Pool of SDL streaming textures holding web pages.
+//
+
+#include "sdl_texture_pool.hpp"
+#include "TextureBucket.hpp"
+#include <iostream>
+
+//------------------------------------------------------------------------------
+SDLTexturePool::SDLTexturePool(SDL_Renderer& renderer, size_t max_cached)
+    : m_renderer(renderer), m_max_cached(max_cached)
+{
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(&m_renderer, &info) == 0)
+    {
+        m_max_width = info.max_texture_width;
+        m_max_height = info.max_texture_height;
+    }
+}
+
+//------------------------------------------------------------------------------
+SDLTexturePool::~SDLTexturePool()
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------
+PooledSDLTexture SDLTexturePool::acquire(int width, int height)
+{
+    // Reuse a cached texture of a compatible bucket
+    for (auto it = m_cache.begin(); it != m_cache.end(); ++it)
+    {
+        if (TextureBucket::fits(width, height, it->width, it->height))
+        {
+            PooledSDLTexture texture = *it;
+            m_cache.erase(it);
+            return texture;
+        }
+    }
+
+    PooledSDLTexture texture;
+    texture.width = TextureBucket::allocation(width, m_max_width);
+    texture.height = TextureBucket::allocation(height, m_max_height);
+    texture.texture = SDL_CreateTexture(&m_renderer, SDL_PIXELFORMAT_ARGB8888,
+                                        SDL_TEXTUREACCESS_STREAMING,
+                                        texture.width, texture.height);
+    if (texture.texture == nullptr)
+    {
+        std::cerr << "SDL could not create texture! SDL_Error: "
+                  << SDL_GetError() << std::endl;
+        return PooledSDLTexture();
+    }
+
+    return texture;
+}
+
+//------------------------------------------------------------------------------
+void SDLTexturePool::release(PooledSDLTexture& texture)
+{
+    if (texture.texture == nullptr)
+        return ;
+
+    m_cache.push_front(texture);
+    texture = PooledSDLTexture();
+
+    while (m_cache.size() > m_max_cached)
+    {
+        SDL_DestroyTexture(m_cache.back().texture);
+        m_cache.pop_back();
+    }
+}
+
+//------------------------------------------------------------------------------
+void SDLTexturePool::clear()
+{
+    for (auto& it: m_cache)
+    {
+        SDL_DestroyTexture(it.texture);
+    }
+    m_cache.clear();
+}
@@ -0,0 +1,67 @@
+//
+// Pool of SDL streaming textures holding web pages. Avoids destroying and
+// recreating textures for every intermediate size while a window is resized.
+//
+
+#ifndef CEF_SDL_TEXTURE_POOL_H
+#  define CEF_SDL_TEXTURE_POOL_H
+
+#include <SDL2/SDL.h>
+#include <list>
+#include <cstddef>
+
+// ****************************************************************************
+//! \brief Texture and its allocated dimension. Pages are drawn into the
+//! top-left sub-rectangle of it.
+// ****************************************************************************
+struct PooledSDLTexture
+{
+    SDL_Texture* texture = nullptr;
+    int width = 0;
+    int height = 0;
+
+    //! \brief Video memory used by the texture (BGRA8).
+    inline size_t bytes() const
+    {
+        return size_t(width) * size_t(height) * 4u;
+    }
+};
+
+// ****************************************************************************
+//! \brief Size-bucketed pool of streaming textures for a given renderer.
+//! Released textures are kept in a small LRU.
+// ****************************************************************************
+class SDLTexturePool
+{
+public:
+
+    //! \brief \c max_cached is the number of released textures kept alive.
+    SDLTexturePool(SDL_Renderer& renderer, size_t max_cached = 4);
+
+    //! \brief Destroy cached textures.
+    ~SDLTexturePool();
+
+    //! \brief Return a texture able to hold a page of the given dimension:
+    //! reuse a cached one when possible, else create a new one. The returned
+    //! texture is empty when SDL failed.
+    PooledSDLTexture acquire(int width, int height);
+
+    //! \brief Give back a texture to the pool. The least recently released
+    //! texture is destroyed when the pool is full.
+    void release(PooledSDLTexture& texture);
+
+    //! \brief Destroy all cached textures.
+    void clear();
+
+private:
+
+    SDL_Renderer& m_renderer;
+    //! \brief Most recently released first.
+    std::list<PooledSDLTexture> m_cache;
+    size_t m_max_cached;
+    //! \brief Texture limits of the renderer (0 if unlimited).
+    int m_max_width = 0;
+    int m_max_height = 0;
+};
+
+#endif // CEF_SDL_TEXTURE_POOL_H
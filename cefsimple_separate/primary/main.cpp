@@ -6,9 +6,12 @@
 #include <iostream>
 #include <sstream>
 #include <mutex>
+#include <algorithm>
+#include <cstring>
 
 #include <cef_app.h>
 #include <cef_browser.h>
+#include <cef_command_line.h>
 #include <cef_client.h>
 #include <cef_render_handler.h>
 #include <cef_life_span_handler.h>
@@ -18,11 +21,26 @@
 #include <SDL2/SDL.h>
 #include <SDL_image.h>
 //#include "sdl_keyboard_utils.h"
+#include "sdl_cef_audio.hpp"
+#include "sdl_texture_pool.hpp"
+#include "TextureBucket.hpp"
+#include "FrameCopy.hpp"
+#include "FramePipeline.hpp"
+#include "ResizeDebouncer.hpp"
+#include "PerformanceProfile.hpp"
+#include "MessageChannel.hpp"
+#include "SharedFeed.hpp"
+#include "StartupTrace.hpp"
+#include "ProcessPlacement.hpp"
+
+#include <functional>
+#include <map>
 
 //=============================================================================
 //
 //=============================================================================
-class BluManager : public CefApp
+class BluManager : public CefApp,
+                   public CefBrowserProcessHandler
 {
 public:
 
@@ -31,40 +49,31 @@ public:
         CefDoMessageLoopWork();
     }
 
+    virtual CefRefPtr<CefBrowserProcessHandler> GetBrowserProcessHandler() override
+    {
+        return this;
+    }
+
+    // Only called for the browser process: subprocesses run the secondary
+    // executable and receive their switches from OnBeforeChildProcessLaunch().
     virtual void OnBeforeCommandLineProcessing(
         const CefString& ProcessType,
         CefRefPtr<CefCommandLine> CommandLine) override
-    { // FIXME LeCrapouille: does not this way!
+    {
+        // Chromium switches tuning performance are grouped by profile
+        // (--perf-profile=name or OFFSCREENCEF_PROFILE=name).
+        Profile = PerformanceProfile::select(CommandLine);
+        Profile.log();
+        Profile.apply(ProcessType, CommandLine);
 
         /**
-         * Used to pick command line switches
-         * If set to "true": CEF will use less CPU, but rendering performance will be lower. CSS3 and WebGL are not be usable
-         * If set to "false": CEF will use more CPU, but rendering will be better, CSS3 and WebGL will also be usable
+         * The software-only profile makes CEF use less CPU, but rendering
+         * performance will be lower. CSS3 and WebGL are not be usable.
          */
-        BluManager::CPURenderSettings = false;
+        BluManager::CPURenderSettings = Profile.softwareOnly();
 
-        CommandLine->AppendSwitch("off-screen-rendering-enabled");
-        CommandLine->AppendSwitchWithValue("off-screen-frame-rate", "60");
-        CommandLine->AppendSwitch("enable-font-antialiasing");
         CommandLine->AppendSwitch("enable-media-stream");
 
-        // Should we use the render settings that use less CPU?
-        if (CPURenderSettings)
-        {
-            CommandLine->AppendSwitch("disable-gpu");
-            CommandLine->AppendSwitch("disable-gpu-compositing");
-            CommandLine->AppendSwitch("enable-begin-frame-scheduling");
-        }
-        else
-        {
-            // Enables things like CSS3 and WebGL
-            CommandLine->AppendSwitch("enable-gpu-rasterization");
-            CommandLine->AppendSwitch("enable-webgl");
-            CommandLine->AppendSwitch("disable-web-security");
-        }
-
-        CommandLine->AppendSwitchWithValue("enable-blink-features", "HTMLImports");
-
         if (AutoPlay)
         {
             CommandLine->AppendSwitchWithValue("autoplay-policy", "no-user-gesture-required");
@@ -74,8 +83,19 @@ public:
         // Visit Peter Beverloo's site: http://peter.sh/experiments/chromium-command-line-switches/ for more info on the switches
     }
 
+    // Called in the browser process for each renderer, GPU or utility
+    // process about to be launched.
+    virtual void OnBeforeChildProcessLaunch(
+        CefRefPtr<CefCommandLine> CommandLine) override
+    {
+        const std::string type = CommandLine->GetSwitchValue("type");
+        StartupTrace::mark(type.c_str(), "launch");
+        Profile.apply(type, CommandLine);
+    }
+
     static CefSettings Settings;
     static CefMainArgs MainArgs;
+    static PerformanceProfile Profile;
     static bool CPURenderSettings;
     static bool AutoPlay;
 
@@ -84,6 +104,7 @@ public:
 
 CefSettings BluManager::Settings;
 CefMainArgs BluManager::MainArgs;
+PerformanceProfile BluManager::Profile;
 bool BluManager::CPURenderSettings = false;
 bool BluManager::AutoPlay = true;
 
@@ -94,18 +115,29 @@ class RenderHandler: public CefRenderHandler
 {
 public:
 
-    RenderHandler(SDL_Renderer& renderer, int w, int h)
-        : m_renderer(renderer)
+    RenderHandler(SDL_Renderer& renderer, SDLTexturePool& pool, int w, int h)
+        : m_renderer(renderer), m_pool(pool), m_width(w), m_height(h),
+          m_pipeline("primary")
     {
-        resize(w, h);
+        // Copy a tile of the page into the locked part of the texture
+        m_pipeline.stage("copy", [this](FrameTile const& tile)
+        {
+            unsigned char* dst = m_painting.pixels
+                + (tile.y - m_painting.area.y) * m_painting.pitch
+                + (tile.x - m_painting.area.x) * 4;
+            const unsigned char* src = m_painting.page
+                + (static_cast<size_t>(tile.y) * m_page_width + tile.x) * 4;
+            FrameCopy::copy(dst, static_cast<size_t>(m_painting.pitch), src,
+                            static_cast<size_t>(m_page_width * 4),
+                            static_cast<size_t>(tile.width * 4),
+                            static_cast<size_t>(tile.height));
+        });
     }
 
     ~RenderHandler()
     {
-        if (m_texture != nullptr)
-        {
-            SDL_DestroyTexture(m_texture);
-        }
+        std::lock_guard<std::mutex> locker(m_mutex_texture);
+        m_pool.release(m_texture);
     }
 
     virtual void GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect) override
@@ -117,58 +149,142 @@ public:
                          const RectList& dirtyRects, const void* buffer,
                          int w, int h) override
     {
-        resize(w, h); // FIXME: I dunno why this avoid segfault
+        // Popup widgets (i.e. <select>) are not composited yet
+        if (type != PET_VIEW)
+            return ;
+
         std::lock_guard<std::mutex> locker(m_mutex_texture);
 
-        if ((m_texture == nullptr) || (buffer == nullptr) || (w <= 0) || (h <= 0)) {
+        if (!m_painted)
+        {
+            StartupTrace::mark("browser", "first-paint");
+            m_painted = true;
+        }
+
+        if ((buffer == nullptr) || (w <= 0) || (h <= 0)) {
+            std::cerr << "OnPaint: bad texture or bad size" << std::endl;
+            return ;
+        }
+
+        // The page may be painted at a size not yet seen by resize()
+        reserve(w, h);
+        if (m_texture.texture == nullptr) {
             std::cerr << "OnPaint: bad texture or bad size" << std::endl;
             return ;
         }
 
+        // Only the bounding box of dirty rectangles is locked, unless the
+        // texture or the page size changed. Locked pixels are write-only so
+        // the whole box is copied.
+        SDL_Rect area = { 0, 0, w, h };
+        if ((m_page_width == w) && (m_page_height == h) && !dirtyRects.empty())
+        {
+            int x0 = w, y0 = h, x1 = 0, y1 = 0;
+            for (auto const& rect: dirtyRects)
+            {
+                x0 = std::min(x0, std::max(0, rect.x));
+                y0 = std::min(y0, std::max(0, rect.y));
+                x1 = std::max(x1, std::min(w, rect.x + rect.width));
+                y1 = std::max(y1, std::min(h, rect.y + rect.height));
+            }
+            if ((x1 <= x0) || (y1 <= y0))
+                return ;
+            area = { x0, y0, x1 - x0, y1 - y0 };
+        }
+        m_page_width = w;
+        m_page_height = h;
+
+        // Copy the box into the pooled texture (the page is in its top-left
+        // corner), tile by tile on several cores.
         unsigned char* texture_data = nullptr;
         int texture_pitch = 0;
 
-        SDL_LockTexture(m_texture, nullptr, (void**) &texture_data, &texture_pitch);
-        memcpy(texture_data, buffer, static_cast<size_t>(w * h * 4));
-        SDL_UnlockTexture(m_texture);
+        if (SDL_LockTexture(m_texture.texture, &area, (void**) &texture_data,
+                            &texture_pitch) != 0) {
+            return ;
+        }
+
+        m_painting = { static_cast<const unsigned char*>(buffer), texture_data,
+                       texture_pitch, area };
+        m_pipeline.process({ FrameTile{ area.x, area.y, area.w, area.h } });
+        SDL_UnlockTexture(m_texture.texture);
     }
 
+    //! \brief Change the view size given to CEF. The texture is adapted by
+    //! the next OnPaint() so the previous page keeps being drawn meanwhile.
     void resize(int w, int h)
     {
         std::lock_guard<std::mutex> locker(m_mutex_texture);
 
-        if ((w == m_width) && (h == m_height)) {
-            return ;
-        }
-
-        if (m_texture != nullptr) {
-            SDL_DestroyTexture(m_texture);
-        }
-
-        m_texture = SDL_CreateTexture(&m_renderer, SDL_PIXELFORMAT_UNKNOWN,
-                                      SDL_TEXTUREACCESS_STREAMING, w, h);
-        assert(m_texture != nullptr);
         m_width = w;
         m_height = h;
     }
 
+    //! \brief Return true once CEF has painted the page.
+    bool painted() const
+    {
+        return m_painted;
+    }
+
     void render()
     {
         std::lock_guard<std::mutex> locker(m_mutex_texture);
 
-        if (m_texture != nullptr)
+        if ((m_texture.texture != nullptr) && (m_page_width > 0))
         {
-            SDL_RenderCopy(&m_renderer, m_texture, nullptr, nullptr);
+            // Stretched to the window until the page is painted at its size
+            SDL_Rect page = { 0, 0, m_page_width, m_page_height };
+            SDL_RenderCopy(&m_renderer, m_texture.texture, &page, nullptr);
+        }
+    }
+
+private:
+
+    //! \brief Make sure the texture can hold a page of the given size. The
+    //! texture is only swapped when the size leaves its bucket so resizing the
+    //! window does not recreate a texture for every intermediate size.
+    //! m_mutex_texture shall be locked.
+    void reserve(int w, int h)
+    {
+        if ((w <= 0) || (h <= 0)) {
+            return ;
         }
+
+        if ((m_texture.texture != nullptr) &&
+            TextureBucket::fits(w, h, m_texture.width, m_texture.height)) {
+            return ;
+        }
+
+        m_pool.release(m_texture);
+        m_texture = m_pool.acquire(w, h);
+        m_page_width = m_page_height = 0;
     }
 
 private:
 
     SDL_Renderer& m_renderer;
-    SDL_Texture* m_texture = nullptr;
+    SDLTexturePool& m_pool;
+    //! \brief View size given to CEF
+    int m_width = 0;
+    int m_height = 0;
+    PooledSDLTexture m_texture;
     std::mutex m_mutex_texture;
-    int m_width;
-    int m_height;
+    //! \brief Size of the last painted page inside m_texture
+    int m_page_width = 0;
+    int m_page_height = 0;
+    //! \brief OnPaint() has been called once.
+    std::atomic<bool> m_painted{false};
+
+    //! \brief Page being copied by m_pipeline into the locked texture area.
+    struct Painting
+    {
+        const unsigned char* page;
+        unsigned char* pixels;
+        int pitch;
+        SDL_Rect area;
+    } m_painting = { nullptr, nullptr, 0, { 0, 0, 0, 0 } };
+    //! \brief Process painted pages on several cores.
+    FramePipeline m_pipeline;
 
     IMPLEMENT_REFCOUNTING(RenderHandler);
 };
@@ -184,15 +300,122 @@ class BrowserClient: public CefClient,
 {
 public:
 
-    BrowserClient(CefRefPtr<CefRenderHandler> ptr)
-        : m_handler(ptr)
+    //! \brief Called for messages sent by the page with blu.send(). \c data
+    //! is only valid during the call.
+    typedef std::function<void(const char* data, size_t size, bool text)> Listener;
+
+    BrowserClient(CefRefPtr<CefRenderHandler> ptr, CefRefPtr<CefAudioHandler> audio)
+        : m_handler(ptr), m_audio(audio), m_channel(PID_RENDERER)
     {}
 
+    //! \brief Dispatch batches of page messages to listeners.
     virtual bool OnProcessMessageReceived(CefRefPtr<CefBrowser> Browser,
                                           CefRefPtr<CefFrame> Frame,
                                           CefProcessId SourceProcess,
                                           CefRefPtr<CefProcessMessage> Message) override
     {
+        return m_channel.receive(Message, [this, Frame](std::string const& channel,
+                                                        const char* data, size_t size, bool text)
+        {
+            if (channel == "blu.feed.subscribe")
+            {
+                subscribe(std::string(data, size));
+                return ;
+            }
+            if (channel.compare(0u, 9u, "blu.feed.") == 0)
+            {
+                // Ignore pages replaced since (i.e. by another renderer)
+                if (Frame->IsMain() && (m_browser != nullptr) &&
+                    (Frame->GetIdentifier() == m_browser->GetMainFrame()->GetIdentifier()))
+                {
+                    feedMessage(channel, data, size);
+                }
+                return ;
+            }
+
+            auto it = m_listeners.find(channel);
+            if (it != m_listeners.end())
+            {
+                it->second(data, size, text);
+            }
+        });
+    }
+
+    //! \brief Listen to the messages of the page on the given channel.
+    void on(std::string const& channel, Listener listener)
+    {
+        m_listeners[channel] = listener;
+    }
+
+    //! \brief Send a message to the callbacks given by the page to blu.on().
+    //! Small messages are sent by the next flush().
+    void send(std::string const& channel, const void* data, size_t size, bool text)
+    {
+        if (m_browser != nullptr)
+        {
+            m_channel.post(m_browser->GetMainFrame(), channel, data, size, text);
+        }
+    }
+
+    //! \brief Send queued messages to the page. To be called once per frame.
+    void flush()
+    {
+        if (m_browser != nullptr)
+        {
+            m_channel.flush(m_browser->GetMainFrame());
+        }
+        m_channel.log("host");
+        for (auto& it: m_feeds)
+        {
+            it.second.memory->log(it.first);
+        }
+    }
+
+    //! \brief Create a feed of frames given to the page callback of
+    //! blu.feed(name) as ArrayBuffers over shared memory: \c slots frames of
+    //! at most \c slot_size bytes can be held by the page at once.
+    bool feed(std::string const& name, size_t slots, size_t slot_size)
+    {
+        std::shared_ptr<SharedFeed> memory = SharedFeed::create(slots, slot_size);
+        if (memory == nullptr)
+            return false;
+        m_feeds[name].memory = memory;
+        return true;
+    }
+
+    //! \brief Memory of a free frame of the feed, to be written in place then
+    //! given to commitFrame(). \return nullptr if the page did not subscribe
+    //! or holds all frames.
+    char* reserveFrame(std::string const& name, int& slot)
+    {
+        auto it = m_feeds.find(name);
+        if ((it == m_feeds.end()) || !it->second.subscribed)
+            return nullptr;
+        slot = it->second.memory->reserve();
+        return (slot < 0) ? nullptr : it->second.memory->data(size_t(slot));
+    }
+
+    //! \brief Give the frame written in the reserved slot to the page.
+    void commitFrame(std::string const& name, int slot, size_t size)
+    {
+        auto it = m_feeds.find(name);
+        if ((it == m_feeds.end()) || (slot < 0))
+            return ;
+        it->second.memory->commit(size_t(slot), size);
+        const uint32_t frame[2] = { uint32_t(slot), uint32_t(size) };
+        send("blu.feed:" + name, frame, sizeof(frame), false);
+    }
+
+    //! \brief Copy a frame into the feed. \return false if dropped.
+    bool pushFrame(std::string const& name, const void* data, size_t size)
+    {
+        int slot;
+        char* memory = reserveFrame(name, slot);
+        if (memory == nullptr)
+            return false;
+        size = std::min(size, m_feeds[name].memory->slotSize());
+        std::memcpy(memory, data, size);
+        commitFrame(name, slot, size);
         return true;
     }
 
@@ -270,12 +493,18 @@ public:
         return m_handler;
     }
 
+    virtual CefRefPtr<CefAudioHandler> GetAudioHandler() override
+    {
+        return m_audio;
+    }
+
     // CefLifeSpanHandler methods.
     virtual void OnAfterCreated(CefRefPtr<CefBrowser> browser) override
     {
         // Must be executed on the UI thread.
         // CEF_REQUIRE_UI_THREAD();
 
+        StartupTrace::mark("browser", "after-created");
         if (!m_browser.get())
         {
             // Keep a reference to the main browser.
@@ -284,6 +513,18 @@ public:
         }
     }
 
+    // CefLoadHandler methods.
+    virtual void OnLoadStart(CefRefPtr<CefBrowser> browser,
+                             CefRefPtr<CefFrame> frame,
+                             TransitionType transition_type) override
+    {
+        // The page of the previous document is gone with its feeds
+        if (frame->IsMain())
+        {
+            unsubscribeAll();
+        }
+    }
+
     virtual void OnBeforeClose(CefRefPtr<CefBrowser> browser) override
     {
         // CEF_REQUIRE_UI_THREAD();
@@ -318,8 +559,75 @@ private:
 
     int m_browser_id;
     CefRefPtr<CefRenderHandler> m_handler;
+    CefRefPtr<CefAudioHandler> m_audio;
     CefRefPtr<CefBrowser> m_browser;
     bool m_is_closing;
+    //! \brief Messages with the page (window.blu) and their listeners.
+    MessageChannel m_channel;
+    std::map<std::string, Listener> m_listeners;
+
+    //! \brief Answer blu.feed(name) with the shared memory of the feed.
+    //! Slots held by a previous page are given back.
+    void subscribe(std::string const& name)
+    {
+        auto it = m_feeds.find(name);
+        if (it == m_feeds.end())
+        {
+            std::cerr << "Page subscribed to unknown feed " << name << std::endl;
+            return ;
+        }
+        it->second.memory->reset();
+        it->second.subscribed = true;
+        std::string const& memory = it->second.memory->name();
+        send("blu.feed.open:" + name, memory.data(), memory.size(), true);
+    }
+
+    //! \brief Feed messages of the page: its context has been released
+    //! ("blu.feed.unsubscribe", payload: the feed name) or it got a frame it
+    //! cannot release itself ("blu.feed.release:<name>", payload: the slot).
+    void feedMessage(std::string const& channel, const char* data, size_t size)
+    {
+        static const std::string RELEASE = "blu.feed.release:";
+
+        if (channel == "blu.feed.unsubscribe")
+        {
+            auto it = m_feeds.find(std::string(data, size));
+            if (it != m_feeds.end())
+            {
+                it->second.subscribed = false;
+                it->second.memory->reset();
+            }
+        }
+        else if ((channel.compare(0u, RELEASE.size(), RELEASE) == 0) &&
+                 (size == sizeof(uint32_t)))
+        {
+            auto it = m_feeds.find(channel.substr(RELEASE.size()));
+            uint32_t slot;
+            std::memcpy(&slot, data, sizeof(slot));
+            if (it != m_feeds.end())
+            {
+                it->second.memory->release(slot);
+            }
+        }
+    }
+
+    //! \brief A new page no longer holds the frames of the previous one.
+    void unsubscribeAll()
+    {
+        for (auto& it: m_feeds)
+        {
+            it.second.subscribed = false;
+            it.second.memory->reset();
+        }
+    }
+
+    //! \brief Frames streamed to the page, by name.
+    struct Feed
+    {
+        std::shared_ptr<SharedFeed> memory;
+        bool subscribed = false;
+    };
+    std::map<std::string, Feed> m_feeds;
 
     IMPLEMENT_REFCOUNTING(BrowserClient);
 };
@@ -356,6 +664,7 @@ void StartupModule()
     CefRefPtr<BluManager> BluApp = new BluManager();
 
     //CefExecuteProcess(BluManager::main_args, BluApp, nullptr);
+    StartupTrace::mark("browser", "initialize");
     CefInitialize(BluManager::MainArgs, BluManager::Settings, BluApp, nullptr);
 
     std::cout << "StartupModule end" << std::endl;
@@ -379,7 +688,7 @@ public:
         bool bAutoPlayEnabled = true;
     };
 
-    void init(SDL_Renderer *sdl, int w, int h)
+    void init(SDL_Renderer *sdl, SDLTexturePool& pool, AudioMixer& mixer, int w, int h)
     {
 // FIXME Lecrapouille: this does not work like this !
 
@@ -419,11 +728,34 @@ public:
         //NB: this setting will change it globally for all new instances
         BluManager::AutoPlay = Settings.bAutoPlayEnabled;
 
-        Renderer = new RenderHandler(*sdl, Settings.Width, Settings.Height);
-        ClientHandler = new BrowserClient(Renderer);
+        Renderer = new RenderHandler(*sdl, pool, Settings.Width, Settings.Height);
+        ClientHandler = new BrowserClient(Renderer, new AudioHandler(mixer));
+
+        // Pages push data with blu.send("telemetry", data) and get back what
+        // they send on "echo" (see tools/channel_benchmark.html).
+        ClientHandler->on("telemetry", [](const char*, size_t, bool) {});
+        ClientHandler->on("echo", [this](const char* data, size_t size, bool text)
+        {
+            ClientHandler->send("echo", data, size, text);
+        });
+
+        // Page given with --url=<url>
+        std::string url = "https://github.com/Lecrapouille/gdcef";
+        CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+        if (command_line->HasSwitch("url"))
+        {
+            url = command_line->GetSwitchValue("url").ToString();
+        }
+
+        // Stream 1 MB frames to blu.feed("sensor") as fast as the page
+        // releases them (see tools/feed_benchmark.sh).
+        m_feed_benchmark = command_line->HasSwitch("feed-benchmark") &&
+                           ClientHandler->feed("sensor", FEED_SLOTS, FEED_FRAME_SIZE);
+
+        StartupTrace::mark("browser", "create-browser");
         Browser = CefBrowserHost::CreateBrowserSync(Info,
                                                     ClientHandler.get(),
-                                                    "https://github.com/Lecrapouille/gdcef",
+                                                    url,
                                                     BrowserSettings,
                                                     nullptr,
                                                     nullptr);
@@ -616,6 +948,32 @@ public:
         return m_closing;
     }
 
+    bool painted() const
+    {
+        return (Renderer != nullptr) && Renderer->painted();
+    }
+
+    //! \brief Send messages queued for the page since the last frame.
+    void flush()
+    {
+        if (m_feed_benchmark)
+        {
+            feedBenchmark();
+        }
+        ClientHandler->flush();
+    }
+
+    //! \brief Write a frame in each slot released by the page.
+    void feedBenchmark()
+    {
+        int slot;
+        while (char* frame = ClientHandler->reserveFrame("sensor", slot))
+        {
+            std::memset(frame, int(++m_feed_frames & 0xff), FEED_FRAME_SIZE);
+            ClientHandler->commitFrame("sensor", slot, FEED_FRAME_SIZE);
+        }
+    }
+
     void render()
     {
         assert(Renderer != nullptr);
@@ -631,6 +989,12 @@ private:
     RenderHandler* Renderer = nullptr;
     CefRefPtr<CefBrowser> Browser = nullptr;
     bool m_closing = false;
+
+    //! \brief Frames of the feed benchmark (--feed-benchmark).
+    static const size_t FEED_SLOTS = 8u;
+    static const size_t FEED_FRAME_SIZE = 1024u * 1024u;
+    bool m_feed_benchmark = false;
+    uint32_t m_feed_frames = 0u;
 };
 
 //=============================================================================
@@ -638,10 +1002,15 @@ private:
 //=============================================================================
 int main(int argc, char * argv[])
 {
+    // Give our command line to CEF so --perf-profile= can be read
+    BluManager::MainArgs = CefMainArgs(argc, argv);
+
+    // Subprocesses place themselves by type (--placement=<file>)
+    ProcessPlacement::forward(argc, argv);
     StartupModule();
 
     // Initialize SDL
-    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
     {
         std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
         return EXIT_FAILURE;
@@ -673,12 +1042,26 @@ int main(int argc, char * argv[])
     }
 
     SDL_Event e;
+    AudioMixer audio_mixer;
+    SDLTexturePool texture_pool(*sdl_renderer);
     BrowserView browser_client;
-    browser_client.init(sdl_renderer, width, height);
+    browser_client.init(sdl_renderer, texture_pool, audio_mixer, width, height);
+
+    // Quit once the page is painted to measure the startup of the browser
+    // and its subprocesses (see tools/startup_benchmark.sh).
+    const bool startup_benchmark =
+        CefCommandLine::GetGlobalCommandLine()->HasSwitch("startup-benchmark");
 
+    ResizeDebouncer resize_debouncer;
     bool shutdown = false;
     while (!browser_client.closeAllowed())
     {
+        if (startup_benchmark && !shutdown && browser_client.painted())
+        {
+            shutdown = true;
+            browser_client.CloseBrowser();
+        }
+
         // send events to browser
         while ((!shutdown) && (SDL_PollEvent(&e) != 0))
         {
@@ -692,12 +1075,13 @@ int main(int argc, char * argv[])
                 switch (e.window.event)
                 {
                 case SDL_WINDOWEVENT_SIZE_CHANGED:
-                    browser_client.ResizeBrowser(e.window.data1, e.window.data2);
-                    browser_client.WasResized();
+                    // The last frame is stretched to the window until the
+                    // resize settles down.
+                    resize_debouncer.request(e.window.data1, e.window.data2);
                     break;
 
                 case SDL_WINDOWEVENT_FOCUS_GAINED:
-                    browser_client.ResizeBrowser(e.window.data1, e.window.data2);
+                    browser_client.SetFocus(true);
                     break;
 
                 case SDL_WINDOWEVENT_FOCUS_LOST:
@@ -726,7 +1110,15 @@ int main(int argc, char * argv[])
             }
         }
 
+        // Make CEF re-layout the page at most once per debounce interval
+        int resized_width, resized_height;
+        if (resize_debouncer.poll(resized_width, resized_height))
+        {
+            browser_client.ResizeBrowser(resized_width, resized_height);
+        }
+
         // let browser process events
+        browser_client.flush();
         CefDoMessageLoopWork();
 
         // render
@@ -736,6 +1128,7 @@ int main(int argc, char * argv[])
     }
 
     CefShutdown();
+    texture_pool.clear();
     SDL_DestroyRenderer(sdl_renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
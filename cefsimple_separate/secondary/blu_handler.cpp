@@ -12,7 +12,6 @@
 #include "include/wrapper/cef_closure_task.h"
 #include "include/wrapper/cef_helpers.h"
 
-#include <sstream>
 #include <string>
 
 static BluHandler* g_instance = nullptr;
@@ -104,13 +103,13 @@ void BluHandler::OnLoadError(CefRefPtr<CefBrowser> browser,
     CEF_REQUIRE_UI_THREAD();
 
     // Display a load error message using a data: URI.
-    std::stringstream ss;
-    ss << "<html><body bgcolor=\"white\">"
-            "<h2>Failed to load URL "
-       << std::string(failedUrl) << " with error " << std::string(errorText)
-       << " (" << errorCode << ").</h2></body></html>";
+    const std::string html =
+        "<html><body bgcolor=\"white\">"
+        "<h2>Failed to load URL " + std::string(failedUrl) + " with error " +
+        std::string(errorText) + " (" + std::to_string(errorCode) +
+        ").</h2></body></html>";
 
-    frame->LoadURL(GetDataURI(ss.str(), "text/html"));
+    frame->LoadURL(GetDataURI(html, "text/html"));
 }
 
 void BluHandler::CloseAllBrowsers(bool force_close)
@@ -0,0 +1,306 @@
+// JavaScript API of the message channel between pages and the host
+// (window.blu).
+
+#include "blu_script_handler.h"
+
+#include "include/base/cef_bind.h"
+#include "include/wrapper/cef_closure_task.h"
+#include "include/wrapper/cef_helpers.h"
+
+#include <atomic>
+#include <cstring>
+
+// Delay before sending messages queued by pages: one frame.
+static const int64_t FLUSH_DELAY_MS = 16;
+
+// Frees the copy of a host message given to a page as an ArrayBuffer once
+// the page no longer references it.
+class FreeBuffer : public CefV8ArrayBufferReleaseCallback
+{
+public:
+
+    virtual void ReleaseBuffer(void* buffer) override
+    {
+        delete[] static_cast<char*>(buffer);
+    }
+
+    IMPLEMENT_REFCOUNTING(FreeBuffer);
+};
+
+// Gives a feed frame back to the host once the page no longer references its
+// ArrayBuffer, or earlier with blu.release().
+class FeedRelease : public CefV8ArrayBufferReleaseCallback
+{
+public:
+
+    FeedRelease(std::shared_ptr<SharedFeed> feed, size_t slot)
+        : m_feed(feed), m_slot(slot)
+    {}
+
+    void Release()
+    {
+        if (!m_released.exchange(true))
+        {
+            m_feed->release(m_slot);
+        }
+    }
+
+    virtual void ReleaseBuffer(void* /*buffer*/) override
+    {
+        Release();
+    }
+
+private:
+
+    // Keeps the memory mapped while the page holds the buffer.
+    std::shared_ptr<SharedFeed> m_feed;
+    size_t m_slot;
+    std::atomic<bool> m_released{false};
+
+    IMPLEMENT_REFCOUNTING(FeedRelease);
+};
+
+// Frame of a feed announced by the host (channel "blu.feed:<name>").
+struct FeedFrame
+{
+    uint32_t slot;
+    uint32_t size;
+};
+
+BluScriptHandler::BluScriptHandler(CefRefPtr<CefV8Context> context)
+    : m_context(context), m_channel(PID_BROWSER)
+{}
+
+void BluScriptHandler::Install()
+{
+    CefRefPtr<CefV8Value> blu = CefV8Value::CreateObject(nullptr, nullptr);
+    for (const char* name : { "send", "on", "feed", "release" })
+    {
+        blu->SetValue(name, CefV8Value::CreateFunction(name, this),
+                      V8_PROPERTY_ATTRIBUTE_READONLY);
+    }
+    m_context->GetGlobal()->SetValue("blu", blu, V8_PROPERTY_ATTRIBUTE_READONLY);
+}
+
+bool BluScriptHandler::IsSame(CefRefPtr<CefV8Context> context) const
+{
+    return m_context->IsSame(context);
+}
+
+void BluScriptHandler::Release()
+{
+    // Sent at once: no flush will run for this context
+    m_callbacks.clear();
+    for (auto const& it : m_feeds)
+    {
+        m_channel.post(m_context->GetFrame(), "blu.feed.unsubscribe",
+                       it.first.data(), it.first.size(), true);
+    }
+    m_feeds.clear();
+    if (m_channel.pending())
+    {
+        m_channel.flush(m_context->GetFrame());
+    }
+}
+
+void BluScriptHandler::ReleaseSlot(std::string const& name, uint32_t slot)
+{
+    Post("blu.feed.release:" + name, &slot, sizeof(slot), false);
+}
+
+bool BluScriptHandler::Execute(const CefString& name,
+                               CefRefPtr<CefV8Value> /*object*/,
+                               const CefV8ValueList& arguments,
+                               CefRefPtr<CefV8Value>& retval,
+                               CefString& exception)
+{
+    CEF_REQUIRE_RENDERER_THREAD();
+
+    // Give the slot back then detach the buffer: the host may write the slot
+    if (name == "release")
+    {
+        if ((arguments.size() != 1u) || !arguments[0]->IsArrayBuffer())
+        {
+            exception = "blu.release(buffer): buffer is not an ArrayBuffer";
+            return true;
+        }
+        CefRefPtr<CefV8ArrayBufferReleaseCallback> release =
+            arguments[0]->GetArrayBufferReleaseCallback();
+        if (FeedRelease* frame = dynamic_cast<FeedRelease*>(release.get()))
+        {
+            frame->Release();
+            arguments[0]->NeuterArrayBuffer();
+        }
+        retval = CefV8Value::CreateUndefined();
+        return true;
+    }
+
+    if ((arguments.size() != 2u) || !arguments[0]->IsString())
+    {
+        exception = "blu." + name.ToString() + "(channel, ...): invalid arguments";
+        return true;
+    }
+    const std::string channel = arguments[0]->GetStringValue();
+    if (channel.empty())
+    {
+        exception = "blu." + name.ToString() + "(channel, ...): empty channel name";
+        return true;
+    }
+
+    if (name == "on")
+    {
+        if (!arguments[1]->IsFunction())
+        {
+            exception = "blu.on(channel, callback): callback is not a function";
+            return true;
+        }
+        m_callbacks[channel].push_back(arguments[1]);
+        retval = CefV8Value::CreateUndefined();
+        return true;
+    }
+
+    // The host answers with the name of the shared memory of the feed
+    if (name == "feed")
+    {
+        if (!arguments[1]->IsFunction())
+        {
+            exception = "blu.feed(name, callback): callback is not a function";
+            return true;
+        }
+        m_feeds[channel].callback = arguments[1];
+        Post("blu.feed.subscribe", channel.data(), channel.size(), true);
+        retval = CefV8Value::CreateUndefined();
+        return true;
+    }
+
+    // blu.send(): ArrayBuffers are read in place, strings are converted to
+    // UTF-8 once.
+    if (arguments[1]->IsArrayBuffer())
+    {
+        Post(channel, arguments[1]->GetArrayBufferData(),
+             arguments[1]->GetArrayBufferByteLength(), false);
+    }
+    else if (arguments[1]->IsString())
+    {
+        const std::string text = arguments[1]->GetStringValue();
+        Post(channel, text.data(), text.size(), true);
+    }
+    else
+    {
+        exception = "blu.send(channel, data): data is not a string or an ArrayBuffer";
+        return true;
+    }
+    retval = CefV8Value::CreateUndefined();
+    return true;
+}
+
+void BluScriptHandler::Post(std::string const& channel, const void* data,
+                            size_t size, bool text)
+{
+    m_channel.post(m_context->GetFrame(), channel, data, size, text);
+    if (m_channel.pending() && !m_flush_posted)
+    {
+        m_flush_posted = true;
+        CefPostDelayedTask(TID_RENDERER, base::BindOnce(&BluScriptHandler::Flush, this),
+                           FLUSH_DELAY_MS);
+    }
+}
+
+bool BluScriptHandler::OnFeedMessage(std::string const& channel, const char* data, size_t size)
+{
+    static const std::string OPEN = "blu.feed.open:";
+    static const std::string FRAME = "blu.feed:";
+
+    if (channel.compare(0u, OPEN.size(), OPEN) == 0)
+    {
+        auto it = m_feeds.find(channel.substr(OPEN.size()));
+        if (it != m_feeds.end())
+        {
+            it->second.memory = SharedFeed::open(std::string(data, size));
+        }
+        return true;
+    }
+    if (channel.compare(0u, FRAME.size(), FRAME) != 0)
+        return false;
+
+    FeedFrame frame;
+    if (size != sizeof(frame))
+        return true;
+    std::memcpy(&frame, data, sizeof(frame));
+
+    // Frames of unknown feeds or without page callback go back to the host
+    const std::string name = channel.substr(FRAME.size());
+    auto it = m_feeds.find(name);
+    if ((it == m_feeds.end()) || (it->second.memory == nullptr))
+    {
+        ReleaseSlot(name, frame.slot);
+        return true;
+    }
+    Feed const& feed = it->second;
+    const size_t bytes = feed.memory->size(frame.slot);
+    if (bytes == 0u)
+        return true;
+    CefRefPtr<FeedRelease> release = new FeedRelease(feed.memory, frame.slot);
+    if (feed.callback == nullptr)
+    {
+        release->Release();
+        return true;
+    }
+
+    // The page reads the slot in place
+    CefRefPtr<CefV8Value> buffer = CefV8Value::CreateArrayBuffer(
+        feed.memory->data(frame.slot), bytes, release);
+    feed.callback->ExecuteFunction(nullptr, { buffer });
+    return true;
+}
+
+void BluScriptHandler::Flush()
+{
+    m_flush_posted = false;
+    if (m_context->IsValid())
+    {
+        m_channel.flush(m_context->GetFrame());
+    }
+    m_channel.log("page");
+}
+
+bool BluScriptHandler::OnProcessMessageReceived(CefRefPtr<CefProcessMessage> message)
+{
+    CEF_REQUIRE_RENDERER_THREAD();
+
+    if (!m_context->IsValid() || !m_context->Enter())
+        return false;
+
+    const bool handled = m_channel.receive(message,
+        [this](std::string const& channel, const char* data, size_t size, bool text)
+    {
+        if (OnFeedMessage(channel, data, size))
+            return;
+
+        auto it = m_callbacks.find(channel);
+        if (it == m_callbacks.end())
+            return;
+
+        CefRefPtr<CefV8Value> value;
+        if (text)
+        {
+            value = CefV8Value::CreateString(std::string(data, size));
+        }
+        else
+        {
+            // The message only lives during the call: the page gets a copy
+            char* copy = new char[size > 0u ? size : 1u];
+            std::memcpy(copy, data, size);
+            value = CefV8Value::CreateArrayBuffer(copy, size, new FreeBuffer());
+        }
+
+        const CefV8ValueList arguments = { value };
+        for (auto const& callback : it->second)
+        {
+            callback->ExecuteFunction(nullptr, arguments);
+        }
+    });
+
+    m_context->Exit();
+    return handled;
+}
@@ -0,0 +1,84 @@
+// JavaScript API of the message channel between pages and the host
+// (window.blu).
+
+#ifndef BLU_SCRIPT_HANDLER_H_
+#define BLU_SCRIPT_HANDLER_H_
+
+#include "include/cef_v8.h"
+#include "MessageChannel.hpp"
+#include "SharedFeed.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Gives pages of a V8 context the window.blu object:
+//   blu.send(channel, data)     data is a string or an ArrayBuffer
+//   blu.on(channel, callback)   callback(data) for messages of the host
+//   blu.feed(name, callback)    callback(buffer) for each frame of the host
+//                               feed, an ArrayBuffer over shared memory
+//   blu.release(buffer)         give a feed frame back to the host now
+//                               (else when garbage collected)
+// Messages sent by the page are batched and flushed to the browser process
+// once per frame (large ones at once, through shared memory).
+class BluScriptHandler : public CefV8Handler
+{
+public:
+
+    explicit BluScriptHandler(CefRefPtr<CefV8Context> context);
+
+    // Add window.blu to the context.
+    void Install();
+
+    // Return true if the handler serves the given context.
+    bool IsSame(CefRefPtr<CefV8Context> context) const;
+
+    // Give the messages of the host to page callbacks. Return false if the
+    // process message is not for the channel.
+    bool OnProcessMessageReceived(CefRefPtr<CefProcessMessage> message);
+
+    // Drop page callbacks when the context is released and tell the host to
+    // take the frames of its feeds back.
+    void Release();
+
+    // CefV8Handler methods: blu.send() and blu.on().
+    virtual bool Execute(const CefString& name,
+                         CefRefPtr<CefV8Value> object,
+                         const CefV8ValueList& arguments,
+                         CefRefPtr<CefV8Value>& retval,
+                         CefString& exception) override;
+
+private:
+
+    // Queue a message to the host and schedule its flush.
+    void Post(std::string const& channel, const void* data, size_t size, bool text);
+
+    // Send messages queued by blu.send() since the last frame.
+    void Flush();
+
+    // Handle a message of the host about feeds. Return false if the message
+    // is not about feeds.
+    bool OnFeedMessage(std::string const& channel, const char* data, size_t size);
+
+    // Ask the host to release a slot the page cannot release itself (feed
+    // not opened).
+    void ReleaseSlot(std::string const& name, uint32_t slot);
+
+    // Frames of the host subscribed with blu.feed().
+    struct Feed
+    {
+        std::shared_ptr<SharedFeed> memory;
+        CefRefPtr<CefV8Value> callback;
+    };
+
+    CefRefPtr<CefV8Context> m_context;
+    MessageChannel m_channel;
+    std::map<std::string, std::vector<CefRefPtr<CefV8Value>>> m_callbacks;
+    std::map<std::string, Feed> m_feeds;
+    bool m_flush_posted = false;
+
+    IMPLEMENT_REFCOUNTING(BluScriptHandler);
+};
+
+#endif // BLU_SCRIPT_HANDLER_H_
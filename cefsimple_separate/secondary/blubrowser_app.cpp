@@ -3,13 +3,29 @@
 
 #include "blubrowser_app.h"
 #include "blu_handler.h"
+#include "StartupTrace.hpp"
 #include "include/cef_browser.h"
 #include "include/cef_command_line.h"
 #include "include/wrapper/cef_helpers.h"
-//#include "script_handler.h"
 
 #include <string>
 
+void BluBrowser::OnBeforeCommandLineProcessing(const CefString& process_type,
+                                               CefRefPtr<CefCommandLine> command_line)
+{
+    if (!process_type.empty())
+        return;
+
+    m_profile = PerformanceProfile::select(command_line);
+    m_profile.log();
+    m_profile.apply("", command_line);
+}
+
+void BluBrowser::OnBeforeChildProcessLaunch(CefRefPtr<CefCommandLine> command_line)
+{
+    m_profile.apply(command_line->GetSwitchValue("type"), command_line);
+}
+
 void BluBrowser::OnContextInitialized()
 {
     CEF_REQUIRE_UI_THREAD();
@@ -47,19 +63,53 @@ void BluBrowser::OnContextInitialized()
 
 }
 
+// Startup steps of render processes (see tools/startup_benchmark.sh)
+void BluBrowser::OnWebKitInitialized()
+{
+    StartupTrace::mark("renderer", "webkit");
+}
+
+void BluBrowser::OnBrowserCreated(CefRefPtr<CefBrowser> browser,
+                                  CefRefPtr<CefDictionaryValue> extra_info)
+{
+    StartupTrace::mark("renderer", "ready");
+}
+
 void BluBrowser::OnContextCreated(CefRefPtr<CefBrowser> browser,
                                   CefRefPtr<CefFrame> frame,
                                   CefRefPtr<CefV8Context> context)
 {
+    // Add window.blu: the message channel with the host
+    CefRefPtr<BluScriptHandler> handler = new BluScriptHandler(context);
+    handler->Install();
+    m_scripts.push_back(handler);
+}
 
-    // no handler yet, we need to create it first
-    //FIXME handler = new BluScriptHandler(browser);
-
-    // Retrieve the context's window object.
-    CefRefPtr<CefV8Value> object = context->GetGlobal();
-
-    //FIXME CefRefPtr<CefV8Value> func = CefV8Value::CreateFunction("blu_event", handler);
+void BluBrowser::OnContextReleased(CefRefPtr<CefBrowser> browser,
+                                   CefRefPtr<CefFrame> frame,
+                                   CefRefPtr<CefV8Context> context)
+{
+    for (auto it = m_scripts.begin(); it != m_scripts.end(); ++it)
+    {
+        if ((*it)->IsSame(context))
+        {
+            (*it)->Release();
+            m_scripts.erase(it);
+            break;
+        }
+    }
+}
 
-    // Add the string to the window object as "window.myval". See the "JS Objects" section below.
-    //FIXME object->SetValue("blu_event", func, V8_PROPERTY_ATTRIBUTE_NONE);
+bool BluBrowser::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                          CefRefPtr<CefFrame> frame,
+                                          CefProcessId source_process,
+                                          CefRefPtr<CefProcessMessage> message)
+{
+    CefRefPtr<CefV8Context> context = frame->GetV8Context();
+    for (auto const& script : m_scripts)
+    {
+        if (script->IsSame(context))
+            return script->OnProcessMessageReceived(message);
+    }
+    return false;
 }
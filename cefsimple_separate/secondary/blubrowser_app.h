@@ -4,8 +4,11 @@
 #ifndef CEF_TESTS_CEFSIMPLE_SIMPLE_APP_H_
 #define CEF_TESTS_CEFSIMPLE_SIMPLE_APP_H_
 
-//#include "script_handler.h"
+#include "blu_script_handler.h"
 #include "include/cef_app.h"
+#include "PerformanceProfile.hpp"
+
+#include <vector>
 
 class BluBrowser : public CefApp,
                    public CefBrowserProcessHandler,
@@ -24,16 +27,39 @@ public:
         return this;
     }
 
+    // CefApp methods (only does something when this executable is launched
+    // directly as the browser process):
+    virtual void OnBeforeCommandLineProcessing(
+        const CefString& process_type,
+        CefRefPtr<CefCommandLine> command_line) override;
+
     // CefBrowserProcessHandler methods:
     virtual void OnContextInitialized() override;
+    virtual void OnBeforeChildProcessLaunch(
+        CefRefPtr<CefCommandLine> command_line) override;
 
 private:
 
+    // CefRenderProcessHandler methods:
+    virtual void OnWebKitInitialized() override;
+    virtual void OnBrowserCreated(CefRefPtr<CefBrowser> browser,
+                                  CefRefPtr<CefDictionaryValue> extra_info) override;
     virtual void OnContextCreated(CefRefPtr<CefBrowser> browser,
                                   CefRefPtr<CefFrame> frame,
                                   CefRefPtr<CefV8Context> context) override;
+    virtual void OnContextReleased(CefRefPtr<CefBrowser> browser,
+                                   CefRefPtr<CefFrame> frame,
+                                   CefRefPtr<CefV8Context> context) override;
+    virtual bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                          CefRefPtr<CefFrame> frame,
+                                          CefProcessId source_process,
+                                          CefRefPtr<CefProcessMessage> message) override;
+
+    // window.blu of each V8 context of this render process.
+    std::vector<CefRefPtr<BluScriptHandler>> m_scripts;
 
-    // BluScriptHandler* handler;
+    // Chromium switches applied to the browser and child processes.
+    PerformanceProfile m_profile;
 
     IMPLEMENT_REFCOUNTING(BluBrowser);
 };
@@ -1,19 +1,24 @@
 // This code is a modification of the original projects that can be found at
 // https://github.com/ashea-code/BluBrowser
 
-#include "include/base/cef_logging.h"
 #include "blubrowser_app.h"
-#include <iostream>
+#include "ProcessPlacement.hpp"
+#include "StartupTrace.hpp"
 
 // Entry point function for all processes.
+//
+// This executable is mostly launched as a renderer, GPU, utility or zygote
+// subprocess each time a browser is created: nothing is printed nor
+// initialized before CefExecuteProcess(). Set OFFSCREENCEF_STARTUP_TRACE to
+// trace when subprocesses start (see tools/startup_benchmark.sh).
 int main(int argc, char* argv[])
 {
-    std::cout << ::getpid() << "::" << ::getppid() << ": subprocess "
-              << __FILE__ << ": " << __PRETTY_FUNCTION__ << std::endl;
-    for (int i = 0; i < argc; ++i)
-    {
-        std::cerr << "subprocess arg " << i << ": " << argv[i] << std::endl;
-    }
+    const char* type = StartupTrace::type(argc, argv);
+    StartupTrace::mark(type, "main");
+
+    // CPUs, nice level and cgroup by process type, before Chromium starts
+    // its threads (see cefsimple_separate/placement.conf).
+    ProcessPlacement::setup(argc, argv);
 
     // Provide CEF with command-line arguments.
     CefMainArgs main_args(argc, argv);
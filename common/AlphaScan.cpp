@@ -0,0 +1,64 @@
+// Detect whether a region of a BGRA8 frame painted by CEF is fully opaque.
+
+#include "AlphaScan.hpp"
+#include <cstring>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+//! \brief Alpha byte of each little-endian BGRA8 pixel.
+static const uint32_t ALPHA_MASK = 0xFF000000u;
+
+//------------------------------------------------------------------------------
+//! \brief AND all pixels of a row together: the row is opaque if the alpha
+//! byte of the result is still 0xFF.
+//------------------------------------------------------------------------------
+static bool opaqueRow(const uint8_t* row, int width)
+{
+    uint32_t acc = 0xFFFFFFFFu;
+    int i = 0;
+
+#if defined(__SSE2__)
+    // 4 pixels per load, 16 pixels per iteration
+    __m128i acc0 = _mm_set1_epi32(-1);
+    __m128i acc1 = acc0;
+    for (; i + 16 <= width; i += 16)
+    {
+        const __m128i* p = reinterpret_cast<const __m128i*>(row + 4 * i);
+        acc0 = _mm_and_si128(acc0, _mm_and_si128(_mm_loadu_si128(p + 0),
+                                                 _mm_loadu_si128(p + 1)));
+        acc1 = _mm_and_si128(acc1, _mm_and_si128(_mm_loadu_si128(p + 2),
+                                                 _mm_loadu_si128(p + 3)));
+    }
+    acc0 = _mm_and_si128(acc0, acc1);
+
+    // Alpha bytes are the bytes 3, 7, 11 and 15
+    const __m128i alpha = _mm_set1_epi32(int(ALPHA_MASK));
+    const __m128i opaque = _mm_cmpeq_epi32(_mm_and_si128(acc0, alpha), alpha);
+    if (_mm_movemask_epi8(opaque) != 0xFFFF)
+        return false;
+#endif
+
+    for (; i < width; ++i)
+    {
+        uint32_t pixel;
+        std::memcpy(&pixel, row + 4 * i, sizeof(pixel));
+        acc &= pixel;
+    }
+
+    return (acc & ALPHA_MASK) == ALPHA_MASK;
+}
+
+//------------------------------------------------------------------------------
+bool AlphaScan::opaque(const void* bgra, size_t stride, int x, int y,
+                       int width, int height)
+{
+    const uint8_t* frame = static_cast<const uint8_t*>(bgra);
+    for (int j = y; j < y + height; ++j)
+    {
+        if (!opaqueRow(frame + 4u * (size_t(j) * stride + size_t(x)), width))
+            return false;
+    }
+    return true;
+}
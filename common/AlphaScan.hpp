@@ -0,0 +1,25 @@
+// Detect whether a region of a BGRA8 frame painted by CEF is fully opaque.
+
+#ifndef ALPHASCAN_HPP
+#  define ALPHASCAN_HPP
+
+#  include <cstddef>
+#  include <cstdint>
+
+// *****************************************************************************
+//! \brief Scan the alpha channel of BGRA8 frames. Opaque pages can be drawn
+//! without blending nor discard, which keeps early depth test working and
+//! makes them cheaper to fill than transparent overlays.
+// *****************************************************************************
+class AlphaScan
+{
+public:
+
+    //! \brief Return true if all pixels of the rectangle (x, y, width, height)
+    //! of the frame have an alpha of 255. \c stride is the number of pixels
+    //! of a frame row. Stops at the first non opaque pixel row.
+    static bool opaque(const void* bgra, size_t stride, int x, int y,
+                       int width, int height);
+};
+
+#endif // ALPHASCAN_HPP
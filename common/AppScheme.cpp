@@ -0,0 +1,177 @@
+// app:// URLs served from an AssetBundle.
+
+#include "AppScheme.hpp"
+
+#include <cef_command_line.h>
+#include <cef_parser.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+//! \brief Name of the scheme.
+static const char* SCHEME = "app";
+
+//! \brief Command line switch and environment variable naming the bundle.
+static const char* BUNDLE_SWITCH = "app-bundle";
+static const char* BUNDLE_ENV = "OFFSCREENCEF_APP_BUNDLE";
+
+// *****************************************************************************
+//! \brief Stream an asset straight from the mapped bundle to CEF buffers.
+// *****************************************************************************
+class AssetHandler: public CefResourceHandler
+{
+public:
+
+    AssetHandler(std::shared_ptr<AssetBundle> bundle, std::string path)
+        : m_bundle(std::move(bundle)), m_path(std::move(path))
+    {}
+
+private: // CefResourceHandler interfaces
+
+    virtual bool Open(CefRefPtr<CefRequest> request, bool& handle_request,
+                      CefRefPtr<CefCallback> /*callback*/) override
+    {
+        // The bundle is mapped: answer immediately
+        handle_request = true;
+
+        const std::string accept = request->GetHeaderByName("Accept-Encoding");
+        m_found = m_bundle->find(m_path.c_str(), m_path.size(),
+                                 accept.find("gzip") != std::string::npos,
+                                 m_asset);
+        return true;
+    }
+
+    virtual void GetResponseHeaders(CefRefPtr<CefResponse> response,
+                                    int64_t& response_length,
+                                    CefString& /*redirectUrl*/) override
+    {
+        if (!m_found)
+        {
+            response->SetStatus(404);
+            response->SetStatusText("Not Found");
+            response->SetMimeType("text/plain");
+            response_length = 0;
+            return ;
+        }
+
+        const size_t dot = m_path.rfind('.');
+        const std::string mime = (dot == std::string::npos) ? std::string() :
+            CefGetMimeType(m_path.substr(dot + 1u)).ToString();
+        response->SetStatus(200);
+        response->SetStatusText("OK");
+        response->SetMimeType(mime.empty() ? "application/octet-stream" : mime);
+        if (m_asset.gzip)
+        {
+            response->SetHeaderByName("Content-Encoding", "gzip", true);
+        }
+        response_length = int64_t(m_asset.size);
+    }
+
+    virtual bool Skip(int64_t bytes_to_skip, int64_t& bytes_skipped,
+                      CefRefPtr<CefResourceSkipCallback> /*callback*/) override
+    {
+        // Nothing left: a failure needs a negative error code (skipping 0
+        // bytes and returning true would wait for the callback).
+        if (m_offset >= m_asset.size)
+        {
+            bytes_skipped = ERR_REQUEST_RANGE_NOT_SATISFIABLE;
+            return false;
+        }
+        const size_t skip = std::min(size_t(bytes_to_skip), m_asset.size - m_offset);
+        m_offset += skip;
+        bytes_skipped = int64_t(skip);
+        return true;
+    }
+
+    virtual bool Read(void* data_out, int bytes_to_read, int& bytes_read,
+                      CefRefPtr<CefResourceReadCallback> /*callback*/) override
+    {
+        // The only copy: from the mapping to the buffer of CEF
+        const size_t n = std::min(size_t(bytes_to_read), m_asset.size - m_offset);
+        std::memcpy(data_out, m_asset.data + m_offset, n);
+        m_offset += n;
+        bytes_read = int(n);
+        return n > 0u;
+    }
+
+    virtual void Cancel() override
+    {}
+
+private:
+
+    //! \brief Keep the mapping alive while reading.
+    std::shared_ptr<AssetBundle> m_bundle;
+    std::string m_path;
+    AssetBundle::Asset m_asset;
+    bool m_found = false;
+    size_t m_offset = 0u;
+
+    IMPLEMENT_REFCOUNTING(AssetHandler);
+};
+
+//------------------------------------------------------------------------------
+//! \brief Path of the asset of an app://host/path?query#fragment URL.
+//------------------------------------------------------------------------------
+static std::string assetPath(std::string const& url)
+{
+    size_t start = url.find("://");
+    start = (start == std::string::npos) ? 0u : url.find('/', start + 3u);
+    if (start == std::string::npos)
+        return "index.html";
+
+    const size_t end = url.find_first_of("?#", start);
+    std::string path = CefURIDecode(url.substr(start + 1u, end - start - 1u), true,
+                                    cef_uri_unescape_rule_t(UU_NORMAL | UU_SPACES)).ToString();
+    if (path.empty() || (path.back() == '/'))
+    {
+        path += "index.html";
+    }
+    return path;
+}
+
+//------------------------------------------------------------------------------
+void AppScheme::registerScheme(CefRawPtr<CefSchemeRegistrar> registrar)
+{
+    registrar->AddCustomScheme(SCHEME, CEF_SCHEME_OPTION_STANDARD |
+                               CEF_SCHEME_OPTION_SECURE |
+                               CEF_SCHEME_OPTION_CORS_ENABLED |
+                               CEF_SCHEME_OPTION_FETCH_ENABLED);
+}
+
+//------------------------------------------------------------------------------
+bool AppScheme::install(CefRefPtr<CefCommandLine> command_line)
+{
+    std::string filename;
+    if ((command_line != nullptr) && command_line->HasSwitch(BUNDLE_SWITCH))
+    {
+        filename = command_line->GetSwitchValue(BUNDLE_SWITCH).ToString();
+    }
+    else if (const char* env = std::getenv(BUNDLE_ENV))
+    {
+        filename = env;
+    }
+    if (filename.empty())
+        return false;
+
+    auto bundle = std::make_shared<AssetBundle>();
+    if (!bundle->open(filename))
+        return false;
+
+    return CefRegisterSchemeHandlerFactory(SCHEME, "", new AppScheme(bundle));
+}
+
+//------------------------------------------------------------------------------
+AppScheme::AppScheme(std::shared_ptr<AssetBundle> bundle)
+    : m_bundle(std::move(bundle))
+{}
+
+//------------------------------------------------------------------------------
+CefRefPtr<CefResourceHandler> AppScheme::Create(CefRefPtr<CefBrowser> /*browser*/,
+                                                CefRefPtr<CefFrame> /*frame*/,
+                                                const CefString& /*scheme_name*/,
+                                                CefRefPtr<CefRequest> request)
+{
+    return new AssetHandler(m_bundle, assetPath(request->GetURL().ToString()));
+}
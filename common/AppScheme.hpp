@@ -0,0 +1,53 @@
+// app:// URLs served from an AssetBundle.
+
+#ifndef APPSCHEME_HPP
+#  define APPSCHEME_HPP
+
+#  include "AssetBundle.hpp"
+
+#  include <cef_resource_handler.h>
+#  include <cef_scheme.h>
+
+#  include <memory>
+
+// *****************************************************************************
+//! \brief Serve app://<any host>/<path> URLs from the assets of a bundle
+//! created by tools/asset_packer. The bundle is given with --app-bundle=<file>
+//! on the command line or with the OFFSCREENCEF_APP_BUNDLE environment
+//! variable.
+//!
+//! The scheme is standard, secure and allows fetch() and CORS, so pages loaded
+//! from it behave as if served over https.
+// *****************************************************************************
+class AppScheme: public CefSchemeHandlerFactory
+{
+public:
+
+    //! \brief Declare the scheme. To be called from
+    //! CefApp::OnRegisterCustomSchemes() in all processes.
+    static void registerScheme(CefRawPtr<CefSchemeRegistrar> registrar);
+
+    //! \brief Open the bundle set on the command line and serve it. To be
+    //! called in the browser process once CEF is initialized.
+    //! \return false if no bundle is set or if it cannot be opened.
+    static bool install(CefRefPtr<CefCommandLine> command_line);
+
+    //! \brief Serve the given opened bundle.
+    explicit AppScheme(std::shared_ptr<AssetBundle> bundle);
+
+private: // CefSchemeHandlerFactory interfaces
+
+    //! \brief Called on the IO thread for each request.
+    virtual CefRefPtr<CefResourceHandler> Create(CefRefPtr<CefBrowser> browser,
+                                                 CefRefPtr<CefFrame> frame,
+                                                 const CefString& scheme_name,
+                                                 CefRefPtr<CefRequest> request) override;
+
+private:
+
+    std::shared_ptr<AssetBundle> m_bundle;
+
+    IMPLEMENT_REFCOUNTING(AppScheme);
+};
+
+#endif // APPSCHEME_HPP
@@ -0,0 +1,115 @@
+// Read-only archive of application assets mapped in memory.
+
+#include "AssetBundle.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+AssetBundle::~AssetBundle()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------
+bool AssetBundle::open(std::string const& filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        std::cerr << "Cannot open asset bundle '" << filename << "': "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if ((fstat(fd, &st) == 0) && (size_t(st.st_size) >= sizeof(Header)))
+    {
+        data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        std::cerr << "Cannot map asset bundle '" << filename << "'" << std::endl;
+        return false;
+    }
+
+    m_filename = filename;
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = size_t(st.st_size);
+
+    // Check the index once so find() trusts it
+    const Header* header = reinterpret_cast<const Header*>(m_data);
+    const Entry* entries = reinterpret_cast<const Entry*>(m_data + sizeof(Header));
+    bool valid = (std::memcmp(header->magic, "OCEFPACK", 8u) == 0) &&
+                 (header->version == VERSION) &&
+                 (header->count <= (m_size - sizeof(Header)) / sizeof(Entry));
+    for (uint32_t i = 0u; valid && (i < header->count); ++i)
+    {
+        Entry const& e = entries[i];
+        valid = (e.path <= m_size) && (e.path_size <= m_size - e.path) &&
+                (e.data <= m_size) && (e.data_size <= m_size - e.data) &&
+                (e.gzip <= m_size) && (e.gzip_size <= m_size - e.gzip) &&
+                ((i == 0u) || (entries[i - 1u].hash <= e.hash));
+    }
+    if (!valid)
+    {
+        std::cerr << "Invalid asset bundle '" << filename << "'" << std::endl;
+        close();
+        return false;
+    }
+
+    m_entries = entries;
+    m_count = header->count;
+    std::cout << "Asset bundle " << filename << ": " << m_count << " assets, "
+              << m_size / 1024u << " KB" << std::endl;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void AssetBundle::close()
+{
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0u;
+    m_entries = nullptr;
+    m_count = 0u;
+}
+
+//------------------------------------------------------------------------------
+bool AssetBundle::find(const char* path, size_t size, bool gzip, Asset& asset) const
+{
+    const uint64_t h = hash(path, size);
+    const Entry* end = m_entries + m_count;
+    const Entry* it = std::lower_bound(m_entries, end, h,
+                                       [](Entry const& e, uint64_t value)
+                                       {
+                                           return e.hash < value;
+                                       });
+
+    // Colliding hashes are adjacent
+    for (; (it != end) && (it->hash == h); ++it)
+    {
+        if ((it->path_size != size) || (std::memcmp(m_data + it->path, path, size) != 0))
+            continue;
+
+        asset.gzip = gzip && (it->gzip_size > 0u);
+        asset.data = m_data + (asset.gzip ? it->gzip : it->data);
+        asset.size = asset.gzip ? it->gzip_size : it->data_size;
+        return true;
+    }
+    return false;
+}
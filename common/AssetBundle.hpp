@@ -0,0 +1,126 @@
+// Read-only archive of application assets mapped in memory.
+
+#ifndef ASSETBUNDLE_HPP
+#  define ASSETBUNDLE_HPP
+
+#  include <cstddef>
+#  include <cstdint>
+#  include <string>
+
+// *****************************************************************************
+//! \brief Single file holding the assets of the application (HTML, JS, CSS,
+//! images ...) created by tools/asset_packer. The file is mapped in memory and
+//! assets are looked up by the hash of their path: reading an asset costs no
+//! system call and no copy.
+//!
+//! Layout (native endianness, offsets from the start of the file):
+//!   Header, Entry[count] sorted by hash, then paths and contents.
+//! Assets compressing well are also stored gzip compressed.
+// *****************************************************************************
+class AssetBundle
+{
+public:
+
+    //! \brief Version of the layout.
+    static const uint32_t VERSION = 1u;
+
+    // *************************************************************************
+    //! \brief Start of the file.
+    // *************************************************************************
+    struct Header
+    {
+        //! \brief "OCEFPACK"
+        char magic[8];
+        uint32_t version;
+        //! \brief Number of entries following the header.
+        uint32_t count;
+    };
+
+    // *************************************************************************
+    //! \brief Index entry of an asset.
+    // *************************************************************************
+    struct Entry
+    {
+        //! \brief hash() of the path.
+        uint64_t hash;
+        //! \brief Offsets of the path (relative to the bundled directory,
+        //! without leading '/'), of the content and of its gzip version (0 if
+        //! not compressed).
+        uint64_t path;
+        uint64_t data;
+        uint64_t gzip;
+        uint32_t path_size;
+        uint32_t data_size;
+        uint32_t gzip_size;
+        uint32_t reserved;
+    };
+
+    // *************************************************************************
+    //! \brief Content of an asset, valid while the bundle is open.
+    // *************************************************************************
+    struct Asset
+    {
+        const uint8_t* data = nullptr;
+        size_t size = 0u;
+        //! \brief The content is gzip compressed.
+        bool gzip = false;
+    };
+
+    //! \brief 64-bit FNV-1a hash of a path.
+    static inline uint64_t hash(const char* path, size_t size)
+    {
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0u; i < size; ++i)
+        {
+            h = (h ^ uint8_t(path[i])) * 1099511628211ull;
+        }
+        return h;
+    }
+
+    AssetBundle() = default;
+    AssetBundle(AssetBundle const&) = delete;
+    AssetBundle& operator=(AssetBundle const&) = delete;
+
+    //! \brief Unmap the file.
+    ~AssetBundle();
+
+    //! \brief Map the given bundle file and check its index.
+    //! \return false if the file cannot be mapped or is not a valid bundle.
+    bool open(std::string const& filename);
+
+    //! \brief Unmap the file. Assets found before are no longer valid.
+    void close();
+
+    //! \brief Look for the asset of the given path. When \c gzip is set, the
+    //! compressed content is returned if stored.
+    //! \return false if not found.
+    bool find(const char* path, size_t size, bool gzip, Asset& asset) const;
+
+    //! \brief Number of assets.
+    inline size_t size() const
+    {
+        return m_count;
+    }
+
+    //! \brief Size of the mapped file in bytes.
+    inline size_t bytes() const
+    {
+        return m_size;
+    }
+
+    //! \brief Name of the file given to open().
+    inline std::string const& filename() const
+    {
+        return m_filename;
+    }
+
+private:
+
+    std::string m_filename;
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0u;
+    const Entry* m_entries = nullptr;
+    size_t m_count = 0u;
+};
+
+#endif // ASSETBUNDLE_HPP
@@ -0,0 +1,390 @@
+// Compiled matcher of blocked request URLs.
+
+#include "Blocklist.hpp"
+
+#include <cef_command_line.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <queue>
+
+//! \brief Command line switch and environment variable naming the rules file.
+static const char* BLOCKLIST_SWITCH = "blocklist";
+static const char* BLOCKLIST_ENV = "OFFSCREENCEF_BLOCKLIST";
+
+//! \brief Counters are logged every this number of checks.
+static const uint64_t LOG_PERIOD = 500u;
+
+//------------------------------------------------------------------------------
+static inline char lower(char c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? char(c - 'A' + 'a') : c;
+}
+
+//! \brief Transitions to accepting states have this bit set.
+static const uint32_t ACCEPT = 0x80000000u;
+
+//------------------------------------------------------------------------------
+//! \brief Return true if the rule only holds host name characters.
+//------------------------------------------------------------------------------
+static bool isDomain(std::string const& rule)
+{
+    if (rule.empty())
+        return false;
+
+    for (char c: rule)
+    {
+        if (!(((c >= 'a') && (c <= 'z')) || ((c >= '0') && (c <= '9')) ||
+              (c == '.') || (c == '-')))
+            return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+Blocklist& Blocklist::global()
+{
+    static Blocklist blocklist;
+    static bool loaded = [&]()
+    {
+        std::string filename;
+        CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+        if ((command_line != nullptr) && command_line->HasSwitch(BLOCKLIST_SWITCH))
+        {
+            filename = command_line->GetSwitchValue(BLOCKLIST_SWITCH).ToString();
+        }
+        else if (const char* env = std::getenv(BLOCKLIST_ENV))
+        {
+            filename = env;
+        }
+        return !filename.empty() && blocklist.load(filename);
+    }();
+    (void) loaded;
+    return blocklist;
+}
+
+//------------------------------------------------------------------------------
+Blocklist::Blocklist()
+{
+    compile({});
+}
+
+//------------------------------------------------------------------------------
+bool Blocklist::load(std::string const& filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        std::cerr << "Cannot read blocklist '" << filename << "'" << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> rules;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        rules.push_back(line);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    compile(rules);
+    std::cout << "Blocklist " << filename << ": " << m_domains << " domains, "
+              << m_patterns << " patterns compiled in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - start).count()
+              << " ms (" << m_nodes.size() << " trie nodes, "
+              << m_accept.size() << " states x " << m_class_count << " classes)"
+              << std::endl;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void Blocklist::compile(std::vector<std::string> const& rules)
+{
+    // Sort rules by kind
+    std::vector<std::string> domains;
+    std::vector<std::string> patterns;
+    size_t skipped = 0u;
+    for (auto rule: rules)
+    {
+        const size_t first = rule.find_first_not_of(" \t\r");
+        const size_t last = rule.find_last_not_of(" \t\r");
+        if ((first == std::string::npos) || (rule[first] == '#') || (rule[first] == '!'))
+            continue;
+        rule = rule.substr(first, last - first + 1u);
+        std::transform(rule.begin(), rule.end(), rule.begin(), lower);
+
+        if ((rule.compare(0u, 2u, "@@") == 0) || (rule.find_first_of("$*") != std::string::npos))
+        {
+            ++skipped;
+            continue;
+        }
+        // "||domain^" and hosts file lines "0.0.0.0 domain" block domains,
+        // other rules are substrings.
+        std::string domain;
+        if (rule.compare(0u, 2u, "||") == 0)
+        {
+            domain = rule.substr(2u);
+            if (!domain.empty() && (domain.back() == '^'))
+            {
+                domain.pop_back();
+            }
+        }
+        else if ((rule.compare(0u, 8u, "0.0.0.0 ") == 0) || (rule.compare(0u, 10u, "127.0.0.1 ") == 0))
+        {
+            domain = rule.substr(rule.find_last_of(" \t") + 1u);
+        }
+
+        if (isDomain(domain))
+        {
+            domains.push_back(std::string(domain.rbegin(), domain.rend()));
+        }
+        else if (!domain.empty())
+        {
+            patterns.push_back(domain);
+        }
+        else
+        {
+            patterns.push_back(rule);
+        }
+    }
+    if (skipped > 0u)
+    {
+        std::cerr << "Blocklist: " << skipped << " unsupported rules skipped" << std::endl;
+    }
+
+    // Domain trie: insert in a map based trie then flatten it
+    std::vector<std::map<char, uint32_t>> children(1u);
+    std::vector<bool> terminal(1u, false);
+    for (auto const& domain: domains)
+    {
+        uint32_t node = 0u;
+        for (char c: domain)
+        {
+            auto it = children[node].find(c);
+            if (it == children[node].end())
+            {
+                children[node][c] = uint32_t(children.size());
+                node = uint32_t(children.size());
+                children.emplace_back();
+                terminal.push_back(false);
+            }
+            else
+            {
+                node = it->second;
+            }
+        }
+        terminal[node] = true;
+    }
+    m_nodes.assign(children.size(), DomainNode());
+    m_edges.clear();
+    for (size_t i = 0u; i < children.size(); ++i)
+    {
+        m_nodes[i].first = uint32_t(m_edges.size());
+        m_nodes[i].count = uint32_t(children[i].size());
+        m_nodes[i].terminal = terminal[i];
+        for (auto const& it: children[i])
+        {
+            m_edges.push_back(DomainEdge{ it.first, it.second });
+        }
+    }
+    m_domains = domains.size();
+
+    // Character classes: one per character of the patterns, case folded
+    std::memset(m_classes, 0, sizeof(m_classes));
+    m_class_count = 1u;
+    for (auto const& pattern: patterns)
+    {
+        for (char c: pattern)
+        {
+            uint8_t& cls = m_classes[uint8_t(c)];
+            if (cls == 0u)
+            {
+                cls = uint8_t(m_class_count++);
+            }
+        }
+    }
+    for (int c = 'A'; c <= 'Z'; ++c)
+    {
+        m_classes[c] = m_classes[c - 'A' + 'a'];
+    }
+
+    // Aho-Corasick: trie of the patterns ...
+    const size_t K = m_class_count;
+    std::vector<uint32_t> go(K, 0u);
+    m_accept.assign(1u, 0u);
+    for (auto const& pattern: patterns)
+    {
+        uint32_t state = 0u;
+        for (char c: pattern)
+        {
+            const uint8_t cls = m_classes[uint8_t(c)];
+            if (go[state * K + cls] == 0u)
+            {
+                go[state * K + cls] = uint32_t(m_accept.size());
+                m_accept.push_back(0u);
+                go.resize(go.size() + K, 0u);
+            }
+            state = go[state * K + cls];
+        }
+        m_accept[state] = 1u;
+    }
+
+    // ... completed into a deterministic automaton in breadth first order:
+    // missing transitions follow the failure link.
+    std::vector<uint32_t> fail(m_accept.size(), 0u);
+    std::queue<uint32_t> queue;
+    for (size_t cls = 0u; cls < K; ++cls)
+    {
+        if (go[cls] != 0u)
+        {
+            queue.push(go[cls]);
+        }
+    }
+    while (!queue.empty())
+    {
+        const uint32_t state = queue.front();
+        queue.pop();
+        m_accept[state] |= m_accept[fail[state]];
+        for (size_t cls = 0u; cls < K; ++cls)
+        {
+            uint32_t& next = go[state * K + cls];
+            if (next != 0u)
+            {
+                fail[next] = go[fail[state] * K + cls];
+                queue.push(next);
+            }
+            else
+            {
+                next = go[fail[state] * K + cls];
+            }
+        }
+    }
+
+    // Transitions hold the offset of the next state in the table and whether
+    // it ends a pattern: one load per character when matching.
+    for (auto& next: go)
+    {
+        next = uint32_t(next * K) | (m_accept[next] ? ACCEPT : 0u);
+    }
+    m_transitions.swap(go);
+    m_patterns = patterns.size();
+}
+
+//------------------------------------------------------------------------------
+bool Blocklist::matchDomain(const char* host, size_t size) const
+{
+    uint32_t node = 0u;
+    for (size_t i = size; i-- > 0u; )
+    {
+        const char c = lower(host[i]);
+        DomainNode const& n = m_nodes[node];
+        const DomainEdge* begin = m_edges.data() + n.first;
+        const DomainEdge* end = begin + n.count;
+        const DomainEdge* edge = std::lower_bound(begin, end, c,
+                                                  [](DomainEdge const& e, char value)
+                                                  {
+                                                      return e.c < value;
+                                                  });
+        if ((edge == end) || (edge->c != c))
+            return false;
+
+        node = edge->next;
+        if (m_nodes[node].terminal && ((i == 0u) || (host[i - 1u] == '.')))
+            return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+bool Blocklist::matchPattern(const char* url, size_t size) const
+{
+    const uint32_t* transitions = m_transitions.data();
+    uint32_t state = 0u;
+    for (size_t i = 0u; i < size; ++i)
+    {
+        state = transitions[state + m_classes[uint8_t(url[i])]];
+        if (state & ACCEPT)
+            return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+bool Blocklist::match(std::string const& url) const
+{
+    if (rules() == 0u)
+        return false;
+
+    // Host of scheme://user@host:port/path
+    size_t start = url.find("://");
+    start = (start == std::string::npos) ? 0u : start + 3u;
+    size_t end = url.find_first_of("/?#", start);
+    if (end == std::string::npos)
+    {
+        end = url.size();
+    }
+    const size_t at = url.rfind('@', end);
+    if ((at != std::string::npos) && (at >= start))
+    {
+        start = at + 1u;
+    }
+    const size_t colon = url.find(':', start);
+    if ((colon != std::string::npos) && (colon < end))
+    {
+        end = colon;
+    }
+
+    return ((m_domains > 0u) && matchDomain(url.data() + start, end - start)) ||
+           ((m_patterns > 0u) && matchPattern(url.data(), url.size()));
+}
+
+//------------------------------------------------------------------------------
+bool Blocklist::blocked(std::string const& url)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const bool result = match(url);
+    const uint64_t ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+
+    const uint64_t checks = ++m_checks;
+    m_total_ns += ns;
+    uint64_t max = m_max_ns.load();
+    while ((ns > max) && !m_max_ns.compare_exchange_weak(max, ns))
+    {}
+    if (result)
+    {
+        ++m_blocked;
+    }
+
+    if ((rules() > 0u) && ((checks % LOG_PERIOD) == 0u))
+    {
+        log();
+    }
+    return result;
+}
+
+//------------------------------------------------------------------------------
+Blocklist::Stats Blocklist::stats() const
+{
+    Stats stats;
+    stats.checks = m_checks.load();
+    stats.blocked = m_blocked.load();
+    stats.total_ns = m_total_ns.load();
+    stats.max_ns = m_max_ns.load();
+    return stats;
+}
+
+//------------------------------------------------------------------------------
+void Blocklist::log() const
+{
+    const Stats s = stats();
+    std::cout << "Blocklist: " << s.blocked << "/" << s.checks << " requests blocked, match "
+              << ((s.checks == 0u) ? 0u : s.total_ns / s.checks) << " ns mean, "
+              << s.max_ns << " ns max" << std::endl;
+}
@@ -0,0 +1,128 @@
+// Compiled matcher of blocked request URLs.
+
+#ifndef BLOCKLIST_HPP
+#  define BLOCKLIST_HPP
+
+#  include <atomic>
+#  include <cstddef>
+#  include <cstdint>
+#  include <string>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Tell if a request URL shall be blocked (trackers, ads, widgets).
+//! Rules are read once from a file then compiled into read-only tables so
+//! matching can be done from any thread without locking or allocating:
+//!   - domains in a trie of reversed host names: a rule blocks the domain and
+//!     its subdomains,
+//!   - URL substrings in an Aho-Corasick automaton with one table lookup per
+//!     character of the URL.
+//!
+//! Rules file, one rule per line, case insensitive:
+//!   # comment (or ! comment)
+//!   ||tracker.example^       domain and its subdomains (adblock syntax)
+//!   0.0.0.0 tracker.example  same (hosts file syntax)
+//!   /ads/banner              URL substring
+//! Exceptions (@@), options ($) and wildcards (*) are not supported: these
+//! rules are skipped.
+//!
+//! The file is given with --blocklist=<file> on the command line or the
+//! OFFSCREENCEF_BLOCKLIST environment variable.
+// *****************************************************************************
+class Blocklist
+{
+public:
+
+    // *************************************************************************
+    //! \brief Counters since startup.
+    // *************************************************************************
+    struct Stats
+    {
+        uint64_t checks = 0u;
+        uint64_t blocked = 0u;
+        //! \brief Time spent matching, in nanoseconds.
+        uint64_t total_ns = 0u;
+        uint64_t max_ns = 0u;
+    };
+
+    //! \brief Blocklist of the process loaded from the command line (empty if
+    //! none is given).
+    static Blocklist& global();
+
+    //! \brief Empty blocklist: nothing is blocked.
+    Blocklist();
+
+    //! \brief Compile the rules of the given file.
+    //! \return false if the file cannot be read.
+    bool load(std::string const& filename);
+
+    //! \brief Compile the given rules (lines of a rules file).
+    void compile(std::vector<std::string> const& rules);
+
+    //! \brief Return true if the URL shall be blocked. Thread safe, updates
+    //! counters.
+    bool blocked(std::string const& url);
+
+    //! \brief Return true if the host or the URL matches a rule. Thread safe,
+    //! no counter.
+    bool match(std::string const& url) const;
+
+    //! \brief Number of compiled domain and substring rules.
+    inline size_t rules() const
+    {
+        return m_domains + m_patterns;
+    }
+
+    //! \brief Counters since startup.
+    Stats stats() const;
+
+    //! \brief Print the counters.
+    void log() const;
+
+private:
+
+    //! \brief Match the host name against domain rules.
+    bool matchDomain(const char* host, size_t size) const;
+
+    //! \brief Match the URL against substring rules.
+    bool matchPattern(const char* url, size_t size) const;
+
+private:
+
+    // *************************************************************************
+    //! \brief Node of the domain trie. Its children are the edges
+    //! [first, first + count[ of m_edges, sorted by character.
+    // *************************************************************************
+    struct DomainNode
+    {
+        uint32_t first = 0u;
+        uint32_t count = 0u;
+        bool terminal = false;
+    };
+
+    struct DomainEdge
+    {
+        char c;
+        uint32_t next;
+    };
+
+    std::vector<DomainNode> m_nodes;
+    std::vector<DomainEdge> m_edges;
+    size_t m_domains = 0u;
+
+    //! \brief Aho-Corasick automaton: character classes (characters of the
+    //! patterns, class 0 for all others), transitions by state and class and
+    //! states ending a pattern (only used while compiling).
+    uint8_t m_classes[256];
+    size_t m_class_count = 1u;
+    std::vector<uint32_t> m_transitions;
+    std::vector<uint8_t> m_accept;
+    size_t m_patterns = 0u;
+
+    std::atomic<uint64_t> m_checks{0u};
+    std::atomic<uint64_t> m_blocked{0u};
+    std::atomic<uint64_t> m_total_ns{0u};
+    std::atomic<uint64_t> m_max_ns{0u};
+};
+
+#endif // BLOCKLIST_HPP
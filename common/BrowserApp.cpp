@@ -0,0 +1,77 @@
+// Application-level CEF callbacks shared by the OffScreenCEF examples.
+
+#include "BrowserApp.hpp"
+#include "BrowserCache.hpp"
+#include "AppScheme.hpp"
+#include "ScriptRouter.hpp"
+
+//------------------------------------------------------------------------------
+void BrowserApp::OnBeforeCommandLineProcessing(const CefString& process_type,
+                                               CefRefPtr<CefCommandLine> command_line)
+{
+    // Subprocesses already received their switches from the browser process
+    // through OnBeforeChildProcessLaunch().
+    if (!process_type.empty())
+        return ;
+
+    m_profile = PerformanceProfile::select(command_line);
+    m_profile.log();
+    m_profile.apply("", command_line);
+    BrowserCache::global().apply(command_line);
+}
+
+//------------------------------------------------------------------------------
+void BrowserApp::OnRegisterCustomSchemes(CefRawPtr<CefSchemeRegistrar> registrar)
+{
+    AppScheme::registerScheme(registrar);
+}
+
+//------------------------------------------------------------------------------
+void BrowserApp::OnContextInitialized()
+{
+    AppScheme::install(CefCommandLine::GetGlobalCommandLine());
+}
+
+//------------------------------------------------------------------------------
+void BrowserApp::OnBeforeChildProcessLaunch(CefRefPtr<CefCommandLine> command_line)
+{
+    m_profile.apply(command_line->GetSwitchValue("type"), command_line);
+}
+
+//------------------------------------------------------------------------------
+void BrowserApp::OnWebKitInitialized()
+{
+    m_scripts = CefMessageRouterRendererSide::Create(ScriptRouter::config());
+}
+
+//------------------------------------------------------------------------------
+void BrowserApp::OnContextCreated(CefRefPtr<CefBrowser> browser,
+                                  CefRefPtr<CefFrame> frame,
+                                  CefRefPtr<CefV8Context> context)
+{
+    if (m_scripts != nullptr)
+    {
+        m_scripts->OnContextCreated(browser, frame, context);
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserApp::OnContextReleased(CefRefPtr<CefBrowser> browser,
+                                   CefRefPtr<CefFrame> frame,
+                                   CefRefPtr<CefV8Context> context)
+{
+    if (m_scripts != nullptr)
+    {
+        m_scripts->OnContextReleased(browser, frame, context);
+    }
+}
+
+//------------------------------------------------------------------------------
+bool BrowserApp::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                          CefRefPtr<CefFrame> frame,
+                                          CefProcessId source_process,
+                                          CefRefPtr<CefProcessMessage> message)
+{
+    return (m_scripts != nullptr) &&
+           m_scripts->OnProcessMessageReceived(browser, frame, source_process, message);
+}
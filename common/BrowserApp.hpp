@@ -0,0 +1,83 @@
+// Application-level CEF callbacks shared by the OffScreenCEF examples.
+
+#ifndef BROWSERAPP_HPP
+#  define BROWSERAPP_HPP
+
+#  include "PerformanceProfile.hpp"
+#  include <cef_app.h>
+#  include <wrapper/cef_message_router.h>
+
+// *****************************************************************************
+//! \brief CefApp given to CefExecuteProcess() and CefInitialize(). Applies the
+//! selected PerformanceProfile to the browser process and to every child
+//! process it launches, and serves app:// URLs (see AppScheme). In render
+//! processes, runs the page side of ScriptRouter.
+// *****************************************************************************
+class BrowserApp: public CefApp,
+                  public CefBrowserProcessHandler,
+                  public CefRenderProcessHandler
+{
+public:
+
+    //! \brief Active profile (only meaningful in the browser process).
+    inline PerformanceProfile const& profile() const
+    {
+        return m_profile;
+    }
+
+private: // CefApp interfaces
+
+    virtual CefRefPtr<CefBrowserProcessHandler> GetBrowserProcessHandler() override
+    {
+        return this;
+    }
+
+    virtual CefRefPtr<CefRenderProcessHandler> GetRenderProcessHandler() override
+    {
+        return this;
+    }
+
+    //! \brief Select, log and apply the profile to the browser process.
+    virtual void OnBeforeCommandLineProcessing(
+        const CefString& process_type,
+        CefRefPtr<CefCommandLine> command_line) override;
+
+    //! \brief Declare the app:// scheme (in all processes).
+    virtual void OnRegisterCustomSchemes(
+        CefRawPtr<CefSchemeRegistrar> registrar) override;
+
+private: // CefBrowserProcessHandler interfaces
+
+    //! \brief Serve app:// URLs from the bundle given on the command line.
+    virtual void OnContextInitialized() override;
+
+    //! \brief Apply the profile to the child process about to be launched.
+    virtual void OnBeforeChildProcessLaunch(
+        CefRefPtr<CefCommandLine> command_line) override;
+
+private: // CefRenderProcessHandler interfaces
+
+    //! \brief Create the page side of the ScriptRouter.
+    virtual void OnWebKitInitialized() override;
+
+    //! \brief Forwarded to the ScriptRouter.
+    virtual void OnContextCreated(CefRefPtr<CefBrowser> browser,
+                                  CefRefPtr<CefFrame> frame,
+                                  CefRefPtr<CefV8Context> context) override;
+    virtual void OnContextReleased(CefRefPtr<CefBrowser> browser,
+                                   CefRefPtr<CefFrame> frame,
+                                   CefRefPtr<CefV8Context> context) override;
+    virtual bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                          CefRefPtr<CefFrame> frame,
+                                          CefProcessId source_process,
+                                          CefRefPtr<CefProcessMessage> message) override;
+
+private:
+
+    PerformanceProfile m_profile;
+    CefRefPtr<CefMessageRouterRendererSide> m_scripts;
+
+    IMPLEMENT_REFCOUNTING(BrowserApp);
+};
+
+#endif // BROWSERAPP_HPP
@@ -0,0 +1,237 @@
+// Disk cache directories and request contexts of browsers.
+
+#include "BrowserCache.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__linux__)
+#  include <ftw.h>
+#  include <sys/stat.h>
+#endif
+
+//! \brief Subdirectories holding caches (HTTP, V8 code, GPU shaders) in
+//! Chromium profiles.
+static const char* CACHE_DIRECTORIES[] = {
+    "Cache", "Code Cache", "GPUCache", "DawnCache", "GrShaderCache", "ShaderCache"
+};
+
+//! \brief Default disk cap.
+static const size_t DEFAULT_SIZE_MB = 512u;
+
+//------------------------------------------------------------------------------
+//! \brief Value of the command line switch, else of the environment variable.
+//------------------------------------------------------------------------------
+static std::string option(CefRefPtr<CefCommandLine> command_line,
+                          const char* name, const char* env)
+{
+    if ((command_line != nullptr) && command_line->HasSwitch(name))
+        return command_line->GetSwitchValue(name).ToString();
+    if (const char* value = std::getenv(env))
+        return value;
+    return {};
+}
+
+//------------------------------------------------------------------------------
+static std::string defaultRoot()
+{
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"))
+        return std::string(xdg) + "/offscreencef";
+    if (const char* home = std::getenv("HOME"))
+        return std::string(home) + "/.cache/offscreencef";
+    return {};
+}
+
+#if defined(__linux__)
+
+//! \brief Accumulated by nftw() callbacks (which have no user data).
+static size_t s_bytes = 0u;
+static std::vector<std::string>* s_found = nullptr;
+
+//------------------------------------------------------------------------------
+static int addSize(const char*, const struct stat* st, int type, struct FTW*)
+{
+    if (type == FTW_F)
+    {
+        s_bytes += size_t(st->st_blocks) * 512u;
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+static int findCache(const char* path, const struct stat*, int type, struct FTW* ftw)
+{
+    if (type != FTW_D)
+        return 0;
+
+    for (auto name: CACHE_DIRECTORIES)
+    {
+        if (std::strcmp(path + ftw->base, name) == 0)
+        {
+            s_found->push_back(path);
+            break;
+        }
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*)
+{
+    std::remove(path);
+    return 0;
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+BrowserCache& BrowserCache::global()
+{
+    static BrowserCache cache;
+    return cache;
+}
+
+//------------------------------------------------------------------------------
+size_t BrowserCache::size(std::string const& path)
+{
+#if defined(__linux__)
+    s_bytes = 0u;
+    nftw(path.c_str(), addSize, 16, FTW_PHYS);
+    return s_bytes;
+#else
+    (void) path;
+    return 0u;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void BrowserCache::configure(CefRefPtr<CefCommandLine> command_line, CefSettings& settings)
+{
+    const std::string mode = option(command_line, "cache-mode", "OFFSCREENCEF_CACHE_MODE");
+    if (mode == "per-view")
+    {
+        m_mode = Mode::PerView;
+    }
+    else if (mode == "memory")
+    {
+        m_mode = Mode::Memory;
+    }
+    else if (!mode.empty() && (mode != "shared"))
+    {
+        std::cerr << "Unknown cache mode '" << mode << "': using shared" << std::endl;
+    }
+
+    m_root = option(command_line, "cache-dir", "OFFSCREENCEF_CACHE_DIR");
+    if (m_root.empty())
+    {
+        m_root = defaultRoot();
+    }
+    if (m_root.empty())
+    {
+        m_mode = Mode::Memory;
+    }
+
+    const std::string size_mb = option(command_line, "cache-size-mb", "OFFSCREENCEF_CACHE_SIZE_MB");
+    m_max_bytes = (size_mb.empty() ? DEFAULT_SIZE_MB : size_t(std::strtoull(size_mb.c_str(), nullptr, 10)))
+                  * 1024u * 1024u;
+
+    // URLs to preload
+    const std::string warm_up = option(command_line, "warm-up", "OFFSCREENCEF_WARM_UP");
+    if (!warm_up.empty() && (m_mode == Mode::PerView))
+    {
+        // Warm-up views use the global context: the caches of the views
+        // would stay cold.
+        std::cerr << "Warm-up ignored: each view has its own cache" << std::endl;
+    }
+    else if (!warm_up.empty())
+    {
+        std::ifstream file(warm_up);
+        std::string url;
+        while (std::getline(file, url))
+        {
+            if (!url.empty() && (url[0] != '#'))
+            {
+                m_warm_up.push_back(url);
+            }
+        }
+        if (m_warm_up.empty())
+        {
+            std::cerr << "No URL to warm up in '" << warm_up << "'" << std::endl;
+        }
+    }
+
+    // Without cache_path the global context keeps everything in memory. The
+    // cache_path of all contexts shall be inside root_cache_path.
+    if (m_mode != Mode::Memory)
+    {
+        trim();
+        CefString(&settings.root_cache_path) = m_root;
+        CefString(&settings.cache_path) = m_root + "/default";
+    }
+
+    std::cout << "Cache: " << (m_mode == Mode::Memory ? "memory" :
+                               m_mode == Mode::PerView ? "per-view" : "shared")
+              << (m_mode != Mode::Memory ? " in " + m_root : std::string())
+              << ", " << m_max_bytes / 1024u / 1024u << " MB, "
+              << m_warm_up.size() << " URLs to warm up" << std::endl;
+}
+
+//------------------------------------------------------------------------------
+void BrowserCache::apply(CefRefPtr<CefCommandLine> command_line) const
+{
+    if ((m_mode != Mode::Memory) && (m_max_bytes > 0u) &&
+        !command_line->HasSwitch("disk-cache-size"))
+    {
+        command_line->AppendSwitchWithValue("disk-cache-size", std::to_string(m_max_bytes));
+    }
+}
+
+//------------------------------------------------------------------------------
+void BrowserCache::trim()
+{
+    const size_t bytes = size(m_root);
+    if ((m_max_bytes == 0u) || (bytes <= m_max_bytes))
+        return ;
+
+#if defined(__linux__)
+    std::vector<std::string> found;
+    s_found = &found;
+    nftw(m_root.c_str(), findCache, 16, FTW_PHYS);
+    s_found = nullptr;
+
+    for (auto const& path: found)
+    {
+        nftw(path.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+#endif
+
+    std::cout << "Cache: " << bytes / 1024u / 1024u << " MB over the cap, now "
+              << size(m_root) / 1024u / 1024u << " MB" << std::endl;
+}
+
+//------------------------------------------------------------------------------
+void BrowserCache::clear()
+{
+    m_contexts.clear();
+}
+
+//------------------------------------------------------------------------------
+CefRefPtr<CefRequestContext> BrowserCache::context(std::string const& name)
+{
+    if (m_mode != Mode::PerView)
+        return nullptr;
+
+    auto it = m_contexts.find(name);
+    if (it != m_contexts.end())
+        return it->second;
+
+    CefRequestContextSettings settings;
+    CefString(&settings.cache_path) = m_root + "/views/" + name;
+    CefRefPtr<CefRequestContext> context =
+        CefRequestContext::CreateContext(settings, nullptr);
+    m_contexts[name] = context;
+    return context;
+}
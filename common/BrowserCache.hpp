@@ -0,0 +1,88 @@
+// Disk cache directories and request contexts of browsers.
+
+#ifndef BROWSERCACHE_HPP
+#  define BROWSERCACHE_HPP
+
+#  include <cef_app.h>
+#  include <cef_command_line.h>
+#  include <cef_request_context.h>
+
+#  include <map>
+#  include <string>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Where Chromium keeps its HTTP cache, V8 code cache and GPU shader
+//! cache between runs, so the application starts warm. Configured from the
+//! command line (or environment variables):
+//!   --cache-dir=<path>     (OFFSCREENCEF_CACHE_DIR) root of all caches,
+//!                          default $XDG_CACHE_HOME/offscreencef.
+//!   --cache-size-mb=<n>    (OFFSCREENCEF_CACHE_SIZE_MB) disk cap, default 512.
+//!   --cache-mode=<mode>    (OFFSCREENCEF_CACHE_MODE) "shared": one cache for
+//!                          all views, "per-view": one cache and cookie jar
+//!                          per view, "memory": nothing written to disk.
+//!   --warm-up=<file>       (OFFSCREENCEF_WARM_UP) URLs (one per line) to
+//!                          load once at startup. Ignored in per-view mode:
+//!                          no view would use what they cached.
+//!
+//! The HTTP cache is capped by Chromium (--disk-cache-size). Code and shader
+//! caches are not: when the directory exceeds the cap at startup, the cache
+//! directories are deleted (cookies and local storage are kept).
+// *****************************************************************************
+class BrowserCache
+{
+public:
+
+    enum class Mode { Shared, PerView, Memory };
+
+    //! \brief Cache of the application.
+    static BrowserCache& global();
+
+    //! \brief Read the configuration, enforce the disk cap and set the cache
+    //! paths of CEF. To be called before CefInitialize() in the browser
+    //! process.
+    void configure(CefRefPtr<CefCommandLine> command_line, CefSettings& settings);
+
+    //! \brief Append Chromium switches capping the HTTP cache to the browser
+    //! process command line.
+    void apply(CefRefPtr<CefCommandLine> command_line) const;
+
+    //! \brief Request context of the view with the given name: nullptr (the
+    //! global context) unless each view has its own cache. Views keeping the
+    //! same name between runs find their cache again.
+    CefRefPtr<CefRequestContext> context(std::string const& name);
+
+    //! \brief Release request contexts. To be called before CefShutdown().
+    void clear();
+
+    //! \brief Cache mode.
+    inline Mode mode() const
+    {
+        return m_mode;
+    }
+
+    //! \brief URLs to load at startup to fill the cache.
+    inline std::vector<std::string> const& warmUp() const
+    {
+        return m_warm_up;
+    }
+
+    //! \brief Bytes used on disk by the given directory.
+    static size_t size(std::string const& path);
+
+private:
+
+    //! \brief Delete cache directories when over the cap.
+    void trim();
+
+private:
+
+    Mode m_mode = Mode::Shared;
+    std::string m_root;
+    size_t m_max_bytes = 0u;
+    std::vector<std::string> m_warm_up;
+    //! \brief Contexts created for views, by name.
+    std::map<std::string, CefRefPtr<CefRequestContext>> m_contexts;
+};
+
+#endif // BROWSERCACHE_HPP
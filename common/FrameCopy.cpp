@@ -0,0 +1,255 @@
+// Copy frames painted by CEF into textures, as fast as memory bandwidth allows.
+
+#include "FrameCopy.hpp"
+#include "TaskScheduler.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define FRAMECOPY_X86
+#endif
+
+//! \brief Copies smaller than this stay single threaded: waking up workers
+//! costs more than what they would copy.
+static const size_t PARALLEL_MIN_BYTES = 4u * 1024u * 1024u;
+
+//! \brief Minimal share of a copy given to each thread.
+static const size_t BYTES_PER_THREAD = 2u * 1024u * 1024u;
+
+//! \brief A few threads saturate the memory bandwidth: more only add wake up
+//! latency.
+static const unsigned MAX_THREADS = 4u;
+
+//! \brief Last level cache size used when the system does not report it.
+static const size_t DEFAULT_CACHE_SIZE = 8u * 1024u * 1024u;
+
+//! \brief Bounds of the copy size above which streaming stores are used.
+static const size_t MIN_STREAMING_BYTES = 1u * 1024u * 1024u;
+static const size_t MAX_STREAMING_BYTES = 16u * 1024u * 1024u;
+
+//------------------------------------------------------------------------------
+//! \brief Copies larger than the share of the last level cache of a core
+//! would evict useful data: they bypass the cache.
+//------------------------------------------------------------------------------
+static size_t streamingThreshold()
+{
+    static const size_t threshold = []() -> size_t
+    {
+        long l3 = -1;
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+        l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+        const size_t cache = (l3 > 0) ? size_t(l3) : DEFAULT_CACHE_SIZE;
+        const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        return std::min(MAX_STREAMING_BYTES, std::max(MIN_STREAMING_BYTES, cache / cores));
+    }();
+    return threshold;
+}
+
+#if defined(FRAMECOPY_X86)
+
+//------------------------------------------------------------------------------
+//! \brief Streaming copy of a row with 32-byte AVX2 stores.
+//------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static void streamRowAVX2(uint8_t* dst, const uint8_t* src, size_t bytes)
+{
+    // Stores shall be aligned: copy the head normally
+    size_t head = (32u - (reinterpret_cast<uintptr_t>(dst) & 31u)) & 31u;
+    head = std::min(head, bytes);
+    std::memcpy(dst, src, head);
+
+    size_t i = head;
+    for (; i + 128u <= bytes; i += 128u)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32u));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 64u));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 96u));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 32u), b);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 64u), c);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 96u), d);
+    }
+    for (; i + 32u <= bytes; i += 32u)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), a);
+    }
+    std::memcpy(dst + i, src + i, bytes - i);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Streaming copy of a row with 16-byte SSE2 stores.
+//------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static void streamRowSSE2(uint8_t* dst, const uint8_t* src, size_t bytes)
+{
+    size_t head = (16u - (reinterpret_cast<uintptr_t>(dst) & 15u)) & 15u;
+    head = std::min(head, bytes);
+    std::memcpy(dst, src, head);
+
+    size_t i = head;
+    for (; i + 64u <= bytes; i += 64u)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16u));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 32u));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 48u));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 16u), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 32u), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 48u), d);
+    }
+    for (; i + 16u <= bytes; i += 16u)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), a);
+    }
+    std::memcpy(dst + i, src + i, bytes - i);
+}
+
+#endif
+
+//! \brief Copy of a single row.
+typedef void (*RowCopy)(uint8_t* dst, const uint8_t* src, size_t bytes);
+
+//------------------------------------------------------------------------------
+static void memcpyRow(uint8_t* dst, const uint8_t* src, size_t bytes)
+{
+    std::memcpy(dst, src, bytes);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Best streaming row copy of this CPU, or nullptr if none.
+//------------------------------------------------------------------------------
+static RowCopy streamingRow()
+{
+#if defined(FRAMECOPY_X86)
+    static const RowCopy row = []() -> RowCopy
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return streamRowAVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return streamRowSSE2;
+        return nullptr;
+    }();
+    return row;
+#else
+    return nullptr;
+#endif
+}
+
+//------------------------------------------------------------------------------
+//! \brief Copy rows [begin .. end[ with the given row copy.
+//------------------------------------------------------------------------------
+static void copyRows(RowCopy row, uint8_t* dst, size_t dst_pitch,
+                     const uint8_t* src, size_t src_pitch, size_t row_bytes,
+                     size_t begin, size_t end)
+{
+    for (size_t y = begin; y < end; ++y)
+    {
+        row(dst + y * dst_pitch, src + y * src_pitch, row_bytes);
+    }
+
+#if defined(FRAMECOPY_X86)
+    // Make streaming stores visible before the copy is reported done
+    if (row != memcpyRow)
+    {
+        _mm_sfence();
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+//! \brief Number of threads sharing a copy of the given size.
+//------------------------------------------------------------------------------
+static size_t threadsFor(size_t bytes)
+{
+    if (bytes < PARALLEL_MIN_BYTES)
+        return 1u;
+
+    const size_t threads = std::min(TaskScheduler::global().concurrency(), MAX_THREADS);
+    return std::max<size_t>(1u, std::min<size_t>(threads, bytes / BYTES_PER_THREAD));
+}
+
+//------------------------------------------------------------------------------
+const char* FrameCopy::strategy(size_t bytes)
+{
+    const bool streaming = (bytes > streamingThreshold()) && (streamingRow() != nullptr);
+    const bool parallel = (threadsFor(bytes) > 1u);
+
+    if (streaming)
+        return parallel ? "parallel streaming" : "streaming";
+    return parallel ? "parallel memcpy" : "memcpy";
+}
+
+//------------------------------------------------------------------------------
+void FrameCopy::copy(void* dst, size_t dst_pitch, const void* src,
+                     size_t src_pitch, size_t row_bytes, size_t rows)
+{
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    const size_t bytes = row_bytes * rows;
+
+    if ((rows == 0u) || (row_bytes == 0u))
+        return ;
+
+    // Contiguous buffers are a single large row
+    if ((dst_pitch == row_bytes) && (src_pitch == row_bytes))
+    {
+        row_bytes = bytes;
+        dst_pitch = src_pitch = bytes;
+        rows = 1u;
+    }
+
+    RowCopy row = streamingRow();
+    if ((row == nullptr) || (bytes <= streamingThreshold()))
+    {
+        row = memcpyRow;
+    }
+
+    const size_t threads = threadsFor(bytes);
+    if (threads <= 1u)
+    {
+        copyRows(row, d, dst_pitch, s, src_pitch, row_bytes, 0u, rows);
+        return ;
+    }
+
+    TaskScheduler& scheduler = TaskScheduler::global();
+    TaskGroup group;
+
+    // A single large row is split into parts of equal length
+    if (rows == 1u)
+    {
+        const size_t part = (bytes / threads + 63u) & ~size_t(63u);
+        for (size_t begin = 0u; begin < bytes; begin += part)
+        {
+            const size_t length = std::min(part, bytes - begin);
+            scheduler.submit(group, [=]()
+            {
+                copyRows(row, d + begin, 0u, s + begin, 0u, length, 0u, 1u);
+            });
+        }
+        scheduler.wait(group);
+        return ;
+    }
+
+    // Else rows are split between threads
+    const size_t part = (rows + threads - 1u) / threads;
+    for (size_t begin = 0u; begin < rows; begin += part)
+    {
+        const size_t end = std::min(rows, begin + part);
+        scheduler.submit(group, [=]()
+        {
+            copyRows(row, d, dst_pitch, s, src_pitch, row_bytes, begin, end);
+        });
+    }
+    scheduler.wait(group);
+}
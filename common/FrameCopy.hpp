@@ -0,0 +1,32 @@
+// Copy frames painted by CEF into textures, as fast as memory bandwidth allows.
+
+#ifndef FRAMECOPY_HPP
+#  define FRAMECOPY_HPP
+
+#  include <cstddef>
+
+// *****************************************************************************
+//! \brief Copy 2D pixel buffers (i.e. CEF frames into locked textures). The
+//! strategy is picked at runtime from the copy size, the CPU and its cores:
+//!   - small copies use memcpy: data stays in cache for the texture upload;
+//!   - copies larger than the share of last level cache of a core use
+//!     non-temporal (streaming) AVX2 or SSE2 stores which do not evict the
+//!     cache nor read destination lines before writing them;
+//!   - copies of several megabytes are split by rows across the threads of
+//!     TaskScheduler::global(), the calling thread copying its share too.
+// *****************************************************************************
+class FrameCopy
+{
+public:
+
+    //! \brief Copy \c rows rows of \c row_bytes bytes. Source and destination
+    //! rows start every \c src_pitch and \c dst_pitch bytes.
+    static void copy(void* dst, size_t dst_pitch, const void* src,
+                     size_t src_pitch, size_t row_bytes, size_t rows);
+
+    //! \brief Describe the strategy used for a copy of the given size (for
+    //! logs).
+    static const char* strategy(size_t bytes);
+};
+
+#endif // FRAMECOPY_HPP
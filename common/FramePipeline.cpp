@@ -0,0 +1,126 @@
+// Run per-tile processing stages on frames painted by CEF, across cores.
+
+#include "FramePipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+//! \brief Statistics are logged every this number of frames.
+static const uint64_t LOG_PERIOD = 600u;
+
+size_t FramePipeline::MaxFrames = 2u;
+std::atomic<size_t> FramePipeline::s_in_flight{0u};
+
+//------------------------------------------------------------------------------
+static uint64_t now()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//------------------------------------------------------------------------------
+FramePipeline::FramePipeline(const char* name, TaskScheduler& scheduler, int tile_size)
+    : m_name(name), m_scheduler(scheduler), m_tile_size(std::max(16, tile_size))
+{}
+
+//------------------------------------------------------------------------------
+FramePipeline::~FramePipeline()
+{
+    if (m_frames > 0u)
+    {
+        log();
+    }
+}
+
+//------------------------------------------------------------------------------
+void FramePipeline::stage(const char* name, Stage stage)
+{
+    m_stages.emplace_back();
+    m_stages.back().name = name;
+    m_stages.back().stage = std::move(stage);
+}
+
+//------------------------------------------------------------------------------
+void FramePipeline::run(FrameTile const& tile)
+{
+    uint64_t start = now();
+    for (auto& it: m_stages)
+    {
+        it.stage(tile);
+        const uint64_t end = now();
+        it.ns += end - start;
+        start = end;
+    }
+}
+
+//------------------------------------------------------------------------------
+void FramePipeline::process(std::vector<FrameTile> const& rects)
+{
+    const uint64_t start = now();
+
+    // Split rectangles into tiles
+    m_tiles.clear();
+    for (auto const& rect: rects)
+    {
+        for (int y = rect.y; y < rect.y + rect.height; y += m_tile_size)
+        {
+            for (int x = rect.x; x < rect.x + rect.width; x += m_tile_size)
+            {
+                m_tiles.push_back(FrameTile{ x, y,
+                    std::min(m_tile_size, rect.x + rect.width - x),
+                    std::min(m_tile_size, rect.y + rect.height - y) });
+            }
+        }
+    }
+
+    // Backpressure: too many frames are being processed, do not queue more
+    if ((m_tiles.size() <= 1u) || (++s_in_flight > MaxFrames))
+    {
+        if (m_tiles.size() > 1u)
+        {
+            --s_in_flight;
+            ++m_throttled;
+        }
+        for (auto const& tile: m_tiles)
+        {
+            run(tile);
+        }
+    }
+    else
+    {
+        for (auto const& tile: m_tiles)
+        {
+            m_scheduler.submit(m_group, [this, tile]() { run(tile); });
+        }
+        m_scheduler.wait(m_group);
+        --s_in_flight;
+    }
+
+    m_tiles_count += m_tiles.size();
+    m_wall_ns += now() - start;
+    if ((++m_frames % LOG_PERIOD) == 0u)
+    {
+        log();
+    }
+}
+
+//------------------------------------------------------------------------------
+void FramePipeline::log() const
+{
+    const double frames = double(std::max<uint64_t>(1u, m_frames));
+
+    std::ostringstream out;
+    out << "Pipeline " << m_name << ": " << m_frames << " frames, "
+        << std::fixed << std::setprecision(1)
+        << double(m_tiles_count) / frames << " tiles/frame, "
+        << double(m_wall_ns) / frames / 1000.0 << " us/frame, "
+        << m_throttled << " throttled";
+    for (auto const& it: m_stages)
+    {
+        out << ", " << it.name << " " << double(it.ns) / frames / 1000.0 << " us";
+    }
+    std::cout << out.str() << std::endl;
+}
@@ -0,0 +1,100 @@
+// Run per-tile processing stages on frames painted by CEF, across cores.
+
+#ifndef FRAMEPIPELINE_HPP
+#  define FRAMEPIPELINE_HPP
+
+#  include "TaskScheduler.hpp"
+
+#  include <atomic>
+#  include <cstdint>
+#  include <deque>
+#  include <functional>
+#  include <string>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Rectangle of a frame in pixels (origin at the top-left corner).
+// *****************************************************************************
+struct FrameTile
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// *****************************************************************************
+//! \brief Split the dirty region of a frame into tiles and run processing
+//! stages (copy, swizzle, hash, scan ...) on them with a TaskScheduler. Stages
+//! run in their registration order on a given tile, tiles run in parallel.
+//! Time spent in each stage is accumulated and logged periodically.
+//!
+//! The number of frames processed at once by all pipelines is bounded: when
+//! reached, frames are processed on the calling thread only instead of
+//! queuing more tasks, so a slow consumer cannot grow the queues.
+// *****************************************************************************
+class FramePipeline
+{
+public:
+
+    //! \brief Processing of a tile. Called concurrently on different tiles.
+    typedef std::function<void(FrameTile const&)> Stage;
+
+    //! \brief Pipeline named \c name in logs, splitting frames in tiles of
+    //! \c tile_size pixels.
+    FramePipeline(const char* name, TaskScheduler& scheduler = TaskScheduler::global(),
+                  int tile_size = 256);
+
+    //! \brief Log statistics.
+    ~FramePipeline();
+
+    //! \brief Append a processing stage.
+    void stage(const char* name, Stage stage);
+
+    //! \brief Run all stages on the tiles covering the given rectangles and
+    //! return once done.
+    void process(std::vector<FrameTile> const& rects);
+
+    //! \brief Print the average time spent per frame in each stage.
+    void log() const;
+
+    //! \brief Maximal number of frames processed in parallel by all
+    //! pipelines.
+    static size_t MaxFrames;
+
+private:
+
+    //! \brief Run the stages on a tile and measure them.
+    void run(FrameTile const& tile);
+
+private:
+
+    // *************************************************************************
+    //! \brief Stage and the time spent in it.
+    // *************************************************************************
+    struct Timed
+    {
+        std::string name;
+        Stage stage;
+        std::atomic<uint64_t> ns{0u};
+    };
+
+    std::string m_name;
+    TaskScheduler& m_scheduler;
+    int m_tile_size;
+    //! \brief deque: Timed is not movable.
+    std::deque<Timed> m_stages;
+    TaskGroup m_group;
+    std::vector<FrameTile> m_tiles;
+
+    //! \brief Statistics
+    uint64_t m_frames = 0u;
+    uint64_t m_throttled = 0u;
+    uint64_t m_tiles_count = 0u;
+    uint64_t m_wall_ns = 0u;
+
+    //! \brief Frames processed by all pipelines.
+    static std::atomic<size_t> s_in_flight;
+};
+
+#endif // FRAMEPIPELINE_HPP
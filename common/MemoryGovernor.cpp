@@ -0,0 +1,263 @@
+// Keep the memory used by browser views and renderer processes in a budget.
+
+#include "MemoryGovernor.hpp"
+#include "ProcessMemory.hpp"
+
+#include <cef_values.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#if defined(__linux__)
+#  include <unistd.h>
+#endif
+
+//! \brief Environment variables holding budgets in megabytes.
+static const char* TEXTURE_BUDGET_ENV = "OFFSCREENCEF_TEXTURE_BUDGET_MB";
+static const char* RENDERER_BUDGET_ENV = "OFFSCREENCEF_RENDERER_BUDGET_MB";
+
+//! \brief Steps are undone below this part of the budgets.
+static const double RELAX_RATIO = 0.8;
+
+//! \brief Metrics are logged every this number of updates, and on each level
+//! change.
+static const uint64_t LOG_PERIOD = 60u;
+
+int MemoryGovernor::ThrottledFrameRate = 15;
+
+//------------------------------------------------------------------------------
+static const char* levelName(MemoryGovernor::Level level)
+{
+    switch (level)
+    {
+    case MemoryGovernor::Level::Normal: return "normal";
+    case MemoryGovernor::Level::LowFrameRate: return "low-frame-rate";
+    case MemoryGovernor::Level::ShrinkTextures: return "shrink-textures";
+    case MemoryGovernor::Level::MemoryPressure: return "memory-pressure";
+    case MemoryGovernor::Level::Hibernate: return "hibernate";
+    }
+    return "?";
+}
+
+//------------------------------------------------------------------------------
+static size_t megabytes(const char* env, size_t fallback)
+{
+    const char* value = std::getenv(env);
+    if (value == nullptr)
+        return fallback;
+    return size_t(std::strtoull(value, nullptr, 10)) * 1024u * 1024u;
+}
+
+//------------------------------------------------------------------------------
+MemoryGovernor::Budget MemoryGovernor::Budget::fromEnvironment()
+{
+    size_t physical = 0u;
+#if defined(__linux__)
+    physical = size_t(sysconf(_SC_PHYS_PAGES)) * size_t(sysconf(_SC_PAGESIZE));
+#endif
+
+    Budget budget;
+    budget.texture_bytes = megabytes(TEXTURE_BUDGET_ENV, 1024u * 1024u * 1024u);
+    budget.renderer_bytes = megabytes(RENDERER_BUDGET_ENV, physical / 2u);
+    return budget;
+}
+
+//------------------------------------------------------------------------------
+MemoryGovernor::MemoryGovernor(Budget const& budget, std::chrono::milliseconds period)
+    : m_budget(budget), m_period(period)
+{}
+
+//------------------------------------------------------------------------------
+void MemoryGovernor::update(std::vector<View*> const& views)
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_last_update < m_period)
+        return ;
+    m_last_update = now;
+
+    // Measure
+    m_metrics.views = views.size();
+    m_metrics.texture_bytes = 0u;
+    for (auto view: views)
+    {
+        m_metrics.texture_bytes += view->textureBytes();
+    }
+    const std::vector<int> renderers = ProcessMemory::subprocesses("renderer");
+    m_metrics.renderers = renderers.size();
+    m_metrics.renderer_bytes = 0u;
+    for (int pid: renderers)
+    {
+        m_metrics.renderer_bytes += ProcessMemory::rss(pid);
+    }
+
+    // Part of the budgets used (the most used one)
+    double usage = 0.0;
+    if (m_budget.texture_bytes > 0u)
+    {
+        usage = double(m_metrics.texture_bytes) / double(m_budget.texture_bytes);
+    }
+    if (m_budget.renderer_bytes > 0u)
+    {
+        usage = std::max(usage, double(m_metrics.renderer_bytes) / double(m_budget.renderer_bytes));
+    }
+
+    // One step per period so the previous one has time to take effect
+    const Level level = m_metrics.level;
+    if (usage > 1.0)
+    {
+        if (m_metrics.level != Level::Hibernate)
+        {
+            m_metrics.level = Level(int(m_metrics.level) + 1);
+            enter(views);
+        }
+        else
+        {
+            hibernate(views);
+        }
+    }
+    else if ((usage < RELAX_RATIO) && (m_metrics.level != Level::Normal))
+    {
+        m_metrics.level = Level(int(m_metrics.level) - 1);
+        if (m_metrics.level == Level::Normal)
+        {
+            restore(views);
+        }
+    }
+
+    // Browsers created since throttling (i.e. woken up views)
+    if (m_metrics.level != Level::Normal)
+    {
+        throttle(views);
+    }
+
+    if ((level != m_metrics.level) || ((++m_updates % LOG_PERIOD) == 0u))
+    {
+        log();
+    }
+}
+
+//------------------------------------------------------------------------------
+void MemoryGovernor::enter(std::vector<View*> const& views)
+{
+    switch (m_metrics.level)
+    {
+    case Level::LowFrameRate:
+        // Done by update() for all levels
+        break;
+
+    case Level::ShrinkTextures:
+        for (auto view: views)
+        {
+            view->trim();
+            ++m_metrics.trimmed;
+        }
+        break;
+
+    case Level::MemoryPressure:
+        for (auto view: views)
+        {
+            CefRefPtr<CefBrowser> browser = view->browser();
+            if (browser == nullptr)
+                continue;
+
+            CefRefPtr<CefDictionaryValue> params = CefDictionaryValue::Create();
+            params->SetString("level", "critical");
+            browser->GetHost()->ExecuteDevToolsMethod(
+                0, "Memory.simulatePressureNotification", params);
+            ++m_metrics.pressures;
+        }
+        break;
+
+    case Level::Hibernate:
+        hibernate(views);
+        break;
+
+    default:
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------
+void MemoryGovernor::throttle(std::vector<View*> const& views)
+{
+    for (auto view: views)
+    {
+        CefRefPtr<CefBrowser> browser = view->browser();
+        if ((browser == nullptr) || m_frame_rates.count(browser->GetIdentifier()))
+            continue;
+
+        CefRefPtr<CefBrowserHost> host = browser->GetHost();
+        const int rate = host->GetWindowlessFrameRate();
+        m_frame_rates[browser->GetIdentifier()] = rate;
+        if (rate > ThrottledFrameRate)
+        {
+            host->SetWindowlessFrameRate(ThrottledFrameRate);
+            ++m_metrics.throttled;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void MemoryGovernor::restore(std::vector<View*> const& views)
+{
+    // Browsers closed meanwhile are forgotten
+    for (auto view: views)
+    {
+        CefRefPtr<CefBrowser> browser = view->browser();
+        if (browser == nullptr)
+            continue;
+
+        auto it = m_frame_rates.find(browser->GetIdentifier());
+        if (it != m_frame_rates.end())
+        {
+            browser->GetHost()->SetWindowlessFrameRate(it->second);
+        }
+    }
+    m_frame_rates.clear();
+}
+
+//------------------------------------------------------------------------------
+void MemoryGovernor::hibernate(std::vector<View*> const& views)
+{
+    View* oldest = nullptr;
+    for (auto view: views)
+    {
+        if (view->visible() || (view->browser() == nullptr))
+            continue;
+
+        if ((oldest == nullptr) || (view->lastUsed() < oldest->lastUsed()))
+        {
+            oldest = view;
+        }
+    }
+
+    if ((oldest != nullptr) && oldest->hibernate())
+    {
+        ++m_metrics.hibernated;
+    }
+}
+
+//------------------------------------------------------------------------------
+void MemoryGovernor::log() const
+{
+    const double MB = 1024.0 * 1024.0;
+
+    // Formatted apart so std::cout keeps its precision
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << "Memory: " << m_metrics.views << " views, textures "
+        << double(m_metrics.texture_bytes) / MB << "/"
+        << double(m_budget.texture_bytes) / MB << " MB, "
+        << m_metrics.renderers << " renderers "
+        << double(m_metrics.renderer_bytes) / MB << "/"
+        << double(m_budget.renderer_bytes) / MB << " MB, level "
+        << levelName(m_metrics.level) << ", "
+        << m_metrics.throttled << " throttled, "
+        << m_metrics.trimmed << " trimmed, "
+        << m_metrics.pressures << " pressure notifications, "
+        << m_metrics.hibernated << " hibernated";
+    std::cout << out.str() << std::endl;
+}
@@ -0,0 +1,143 @@
+// Keep the memory used by browser views and renderer processes in a budget.
+
+#ifndef MEMORYGOVERNOR_HPP
+#  define MEMORYGOVERNOR_HPP
+
+#  include <cef_browser.h>
+
+#  include <chrono>
+#  include <cstddef>
+#  include <cstdint>
+#  include <map>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Measure periodically the memory used to display browser views (their
+//! textures and page copies) and the resident memory of renderer processes.
+//! While a budget is exceeded, steps are taken one per period, cheapest
+//! first, until memory is back under budget:
+//!   1. lower the frame rate of browsers,
+//!   2. shrink textures and free cached ones,
+//!   3. ask renderers to free memory (DevTools memory pressure notification),
+//!   4. hibernate the least recently used hidden view, one per period.
+//! Once under 80% of the budgets, steps are undone one per period (frame
+//! rates are restored, hibernated views wake up when used).
+//!
+//! Budgets are read from the OFFSCREENCEF_TEXTURE_BUDGET_MB and
+//! OFFSCREENCEF_RENDERER_BUDGET_MB environment variables (0 for no limit).
+// *****************************************************************************
+class MemoryGovernor
+{
+public:
+
+    // *************************************************************************
+    //! \brief Browser view as seen by the governor. Implemented by backends.
+    // *************************************************************************
+    class View
+    {
+    public:
+
+        virtual ~View() = default;
+
+        //! \brief Browser of the view, nullptr while not created.
+        virtual CefRefPtr<CefBrowser> browser() const = 0;
+
+        //! \brief Memory used to display the view: textures and copies of the
+        //! page, in bytes.
+        virtual size_t textureBytes() const = 0;
+
+        //! \brief Free textures and buffers not needed to draw the current
+        //! page.
+        virtual void trim() = 0;
+
+        //! \brief Close the browser keeping a snapshot of the page.
+        //! \return false if not done (not supported, already hibernated ...).
+        virtual bool hibernate() = 0;
+
+        //! \brief Return false if the view is hidden.
+        virtual bool visible() const = 0;
+
+        //! \brief Last time the view has been shown or got input.
+        virtual std::chrono::steady_clock::time_point lastUsed() const = 0;
+    };
+
+    //! \brief Steps taken while over budget, in order.
+    enum class Level { Normal, LowFrameRate, ShrinkTextures, MemoryPressure, Hibernate };
+
+    // *************************************************************************
+    //! \brief Memory limits in bytes (0 for no limit).
+    // *************************************************************************
+    struct Budget
+    {
+        size_t texture_bytes = 0u;
+        size_t renderer_bytes = 0u;
+
+        //! \brief Budgets set in the environment, else 1 GB of textures and
+        //! half of the physical memory for renderers.
+        static Budget fromEnvironment();
+    };
+
+    // *************************************************************************
+    //! \brief Last measures and number of steps taken.
+    // *************************************************************************
+    struct Metrics
+    {
+        size_t views = 0u;
+        size_t texture_bytes = 0u;
+        size_t renderers = 0u;
+        size_t renderer_bytes = 0u;
+        Level level = Level::Normal;
+        uint64_t throttled = 0u;
+        uint64_t trimmed = 0u;
+        uint64_t pressures = 0u;
+        uint64_t hibernated = 0u;
+    };
+
+    //! \brief Governor checking the budget every \c period.
+    MemoryGovernor(Budget const& budget = Budget::fromEnvironment(),
+                   std::chrono::milliseconds period = std::chrono::seconds(1));
+
+    //! \brief Measure the memory and take a step when the period elapsed, else
+    //! do nothing. To be called on each frame from the CEF UI thread.
+    void update(std::vector<View*> const& views);
+
+    //! \brief Last measures.
+    inline Metrics const& metrics() const
+    {
+        return m_metrics;
+    }
+
+    //! \brief Print the metrics.
+    void log() const;
+
+    //! \brief Frame rate of browsers while throttled.
+    static int ThrottledFrameRate;
+
+private:
+
+    //! \brief Take the step of the current level.
+    void enter(std::vector<View*> const& views);
+
+    //! \brief Lower the frame rate of browsers not yet throttled.
+    void throttle(std::vector<View*> const& views);
+
+    //! \brief Restore the frame rate of throttled browsers.
+    void restore(std::vector<View*> const& views);
+
+    //! \brief Hibernate the least recently used hidden view.
+    void hibernate(std::vector<View*> const& views);
+
+private:
+
+    Budget m_budget;
+    std::chrono::milliseconds m_period;
+    std::chrono::steady_clock::time_point m_last_update;
+    Metrics m_metrics;
+    //! \brief Frame rate of throttled browsers before throttling, by browser
+    //! identifier.
+    std::map<int, int> m_frame_rates;
+    //! \brief Number of updates, to log periodically.
+    uint64_t m_updates = 0u;
+};
+
+#endif // MEMORYGOVERNOR_HPP
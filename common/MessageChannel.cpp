@@ -0,0 +1,224 @@
+// Batched messages between the browser and render processes.
+
+#include "MessageChannel.hpp"
+
+#include <cef_shared_process_message_builder.h>
+#include <cef_values.h>
+
+#include <cstring>
+#include <cstdio>
+
+const char* MessageChannel::NAME = "offscreencef.channel";
+
+size_t MessageChannel::SharedThreshold = 64u * 1024u;
+
+//------------------------------------------------------------------------------
+//! \brief Counters are printed at most this often.
+static const std::chrono::seconds LOG_PERIOD(1);
+
+//------------------------------------------------------------------------------
+static inline size_t align8(size_t size)
+{
+    return (size + 7u) & ~size_t(7u);
+}
+
+//------------------------------------------------------------------------------
+MessageChannel::MessageChannel(CefProcessId target)
+    : m_target(target), m_last_log(std::chrono::steady_clock::now())
+{}
+
+//------------------------------------------------------------------------------
+size_t MessageChannel::recordSize(size_t channel, size_t size)
+{
+    return sizeof(Record) + align8(channel) + align8(size);
+}
+
+//------------------------------------------------------------------------------
+void MessageChannel::write(char* dst, std::string const& channel,
+                           const void* data, size_t size, bool text)
+{
+    Record record;
+    record.channel = uint32_t(channel.size());
+    record.size = uint32_t(size);
+    record.text = text ? 1u : 0u;
+    record.reserved = 0u;
+    std::memcpy(dst, &record, sizeof(record));
+    dst += sizeof(record);
+    std::memcpy(dst, channel.data(), channel.size());
+    dst += align8(channel.size());
+    if (size > 0u)
+    {
+        std::memcpy(dst, data, size);
+    }
+}
+
+//------------------------------------------------------------------------------
+void MessageChannel::post(CefRefPtr<CefFrame> frame, std::string const& channel,
+                          const void* data, size_t size, bool text)
+{
+    // A record with an empty channel name reads as the end of the batch
+    if (channel.empty())
+    {
+        std::fprintf(stderr, "Channel: message without channel name dropped\n");
+        return ;
+    }
+
+    const size_t bytes = recordSize(channel.size(), size);
+    if (bytes < SharedThreshold)
+    {
+        const size_t offset = m_batch.size();
+        m_batch.resize(offset + bytes, 0);
+        write(m_batch.data() + offset, channel, data, size, text);
+        m_sent.bytes += size;
+        ++m_batched;
+        if (m_batch.size() >= SharedThreshold)
+        {
+            flush(frame);
+        }
+        return ;
+    }
+
+    // Large message: keep the order then copy it once, into shared memory
+    flush(frame);
+    CefRefPtr<CefSharedProcessMessageBuilder> builder =
+        CefSharedProcessMessageBuilder::Create(NAME, bytes);
+    if ((builder == nullptr) || !builder->IsValid())
+    {
+        std::fprintf(stderr, "Channel: cannot allocate %zu bytes of shared memory\n", bytes);
+        return ;
+    }
+    write(static_cast<char*>(builder->Memory()), channel, data, size, text);
+    frame->SendProcessMessage(m_target, builder->Build());
+    m_sent.messages += 1u;
+    m_sent.bytes += size;
+    m_sent.batches += 1u;
+    m_sent.shared += 1u;
+}
+
+//------------------------------------------------------------------------------
+void MessageChannel::flush(CefRefPtr<CefFrame> frame)
+{
+    if (m_batch.empty())
+        return ;
+
+    if ((frame != nullptr) && frame->IsValid())
+    {
+        send(frame, m_batch.data(), m_batch.size(), m_batched);
+    }
+    m_batch.clear();
+    m_batched = 0u;
+}
+
+//------------------------------------------------------------------------------
+void MessageChannel::send(CefRefPtr<CefFrame> frame, const char* batch,
+                          size_t size, size_t messages)
+{
+    CefRefPtr<CefProcessMessage> message;
+    if (size >= SharedThreshold)
+    {
+        CefRefPtr<CefSharedProcessMessageBuilder> builder =
+            CefSharedProcessMessageBuilder::Create(NAME, size);
+        if ((builder != nullptr) && builder->IsValid())
+        {
+            std::memcpy(builder->Memory(), batch, size);
+            message = builder->Build();
+            m_sent.shared += 1u;
+        }
+    }
+    if (message == nullptr)
+    {
+        message = CefProcessMessage::Create(NAME);
+        message->GetArgumentList()->SetBinary(0, CefBinaryValue::Create(batch, size));
+    }
+    frame->SendProcessMessage(m_target, message);
+
+    m_sent.messages += messages;
+    m_sent.batches += 1u;
+}
+
+//------------------------------------------------------------------------------
+bool MessageChannel::receive(CefRefPtr<CefProcessMessage> message, Receiver const& receiver)
+{
+    if (message->GetName().ToString() != NAME)
+        return false;
+
+    // Shared memory is read in place, binary values are copied out once
+    const char* batch = nullptr;
+    size_t size = 0u;
+    std::vector<char> copy;
+    CefRefPtr<CefSharedMemoryRegion> region = message->GetSharedMemoryRegion();
+    if ((region != nullptr) && region->IsValid())
+    {
+        batch = static_cast<const char*>(region->Memory());
+        size = region->Size();
+        m_received.shared += 1u;
+    }
+    else
+    {
+        CefRefPtr<CefBinaryValue> binary = message->GetArgumentList()->GetBinary(0);
+        if (binary == nullptr)
+            return true;
+        copy.resize(binary->GetSize());
+        binary->GetData(copy.data(), copy.size(), 0u);
+        batch = copy.data();
+        size = copy.size();
+    }
+    m_received.batches += 1u;
+
+    size_t offset = 0u;
+    std::string channel;
+    while (offset + sizeof(Record) <= size)
+    {
+        Record record;
+        std::memcpy(&record, batch + offset, sizeof(record));
+        const size_t bytes = recordSize(record.channel, record.size);
+        if ((record.channel == 0u) || (bytes > size - offset))
+        {
+            // Shared memory regions are rounded up to pages: zeros end them
+            if (record.channel != 0u)
+            {
+                std::fprintf(stderr, "Channel: truncated message dropped\n");
+            }
+            break;
+        }
+
+        const char* name = batch + offset + sizeof(Record);
+        channel.assign(name, record.channel);
+        receiver(channel, name + align8(record.channel), record.size, record.text != 0u);
+        m_received.messages += 1u;
+        m_received.bytes += record.size;
+        offset += bytes;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void MessageChannel::log(const char* who)
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_last_log < LOG_PERIOD)
+        return ;
+
+    const double seconds = std::chrono::duration<double>(now - m_last_log).count();
+    if ((m_sent.messages == 0u) && (m_received.messages == 0u))
+    {
+        m_last_log = now;
+        return ;
+    }
+
+    for (auto const& it: { std::make_pair("sent", &m_sent), std::make_pair("received", &m_received) })
+    {
+        Stats const& stats = *it.second;
+        if (stats.messages == 0u)
+            continue;
+        std::printf("Channel %s: %s %g messages/s, %g MB/s in %llu batches (%llu in shared memory)\n",
+                    who, it.first, double(stats.messages) / seconds,
+                    double(stats.bytes) / seconds / 1048576.0,
+                    static_cast<unsigned long long>(stats.batches),
+                    static_cast<unsigned long long>(stats.shared));
+        std::fflush(stdout);
+    }
+    m_sent = Stats();
+    m_received = Stats();
+    m_last_log = now;
+}
@@ -0,0 +1,118 @@
+// Batched messages between the browser and render processes.
+
+#ifndef MESSAGECHANNEL_HPP
+#  define MESSAGECHANNEL_HPP
+
+#  include <cef_frame.h>
+#  include <cef_process_message.h>
+
+#  include <chrono>
+#  include <cstdint>
+#  include <functional>
+#  include <string>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief One end of a message channel between the browser process and the
+//! render process of a frame. Messages are named byte strings (text or
+//! binary) sent on a named channel.
+//!
+//! Small messages are appended to a batch sent as a single process message
+//! by flush(), once per frame: a single copy and IPC for many messages.
+//! Batches and messages over SharedThreshold bytes are written into shared
+//! memory (CefSharedProcessMessageBuilder) so their bytes are never copied
+//! into a CefListValue.
+//!
+//! Batch layout, records aligned on 8 bytes:
+//!   [Record][channel name][padding][payload][padding] ...
+//!
+//! Not thread safe: used from the thread sending and receiving messages (UI
+//! thread in the browser process, main thread in the render process).
+// *****************************************************************************
+class MessageChannel
+{
+public:
+
+    // *************************************************************************
+    //! \brief Counters since the last log().
+    // *************************************************************************
+    struct Stats
+    {
+        uint64_t messages = 0u;
+        uint64_t bytes = 0u;
+        uint64_t batches = 0u;
+        //! \brief Batches sent through shared memory.
+        uint64_t shared = 0u;
+    };
+
+    //! \brief Called for each message of a received batch. \c data is only
+    //! valid during the call.
+    typedef std::function<void(std::string const& channel, const char* data,
+                               size_t size, bool text)> Receiver;
+
+    //! \brief Name of the process messages carrying batches.
+    static const char* NAME;
+
+    //! \brief Batches and messages of at least this size use shared memory.
+    static size_t SharedThreshold;
+
+    //! \brief Channel sending to the given process.
+    explicit MessageChannel(CefProcessId target);
+
+    //! \brief Queue a message for the next flush(). Messages over
+    //! SharedThreshold are sent at once to the frame, after the queued ones.
+    //! Messages with an empty channel name are dropped: a zero name length
+    //! ends a batch.
+    void post(CefRefPtr<CefFrame> frame, std::string const& channel,
+              const void* data, size_t size, bool text = false);
+
+    //! \brief Return true if messages wait for flush().
+    inline bool pending() const
+    {
+        return !m_batch.empty();
+    }
+
+    //! \brief Send queued messages to the frame as one process message.
+    void flush(CefRefPtr<CefFrame> frame);
+
+    //! \brief Give the messages of a batch sent by the other end to the
+    //! receiver. \return false if the process message is not a batch.
+    bool receive(CefRefPtr<CefProcessMessage> message, Receiver const& receiver);
+
+    //! \brief Print sent and received messages per second, at most once per
+    //! second, then reset counters. To be called regularly.
+    void log(const char* who);
+
+private:
+
+    //! \brief Header of a message in a batch.
+    struct Record
+    {
+        uint32_t channel;
+        uint32_t size;
+        uint32_t text;
+        uint32_t reserved;
+    };
+
+    //! \brief Bytes taken by a message in a batch.
+    static size_t recordSize(size_t channel, size_t size);
+
+    //! \brief Write a message at \c dst (recordSize() bytes).
+    static void write(char* dst, std::string const& channel,
+                      const void* data, size_t size, bool text);
+
+    //! \brief Send the batch through shared memory or a binary value.
+    void send(CefRefPtr<CefFrame> frame, const char* batch, size_t size,
+              size_t messages);
+
+private:
+
+    CefProcessId m_target;
+    std::vector<char> m_batch;
+    size_t m_batched = 0u;
+    Stats m_sent;
+    Stats m_received;
+    std::chrono::steady_clock::time_point m_last_log;
+};
+
+#endif // MESSAGECHANNEL_HPP
@@ -0,0 +1,166 @@
+// Chromium command line switches grouped by performance profile.
+// See https://peter.sh/experiments/chromium-command-line-switches/
+
+#include "PerformanceProfile.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <thread>
+
+//! \brief Command line switch and environment variable selecting the profile.
+static const char* PROFILE_SWITCH = "perf-profile";
+static const char* PROFILE_ENV = "OFFSCREENCEF_PROFILE";
+
+//! \brief Names of profiles indexed by PerformanceProfile::Type.
+static const char* PROFILE_NAMES[] = {
+    "default", "low-memory", "low-latency", "max-throughput", "software-only"
+};
+
+//------------------------------------------------------------------------------
+static int processMask(std::string const& process_type)
+{
+    if (process_type.empty())
+        return PerformanceProfile::BROWSER;
+    if (process_type == "renderer")
+        return PerformanceProfile::RENDERER;
+    if (process_type == "gpu-process")
+        return PerformanceProfile::GPU;
+    return PerformanceProfile::UTILITY;
+}
+
+//------------------------------------------------------------------------------
+PerformanceProfile::PerformanceProfile(Type type)
+    : m_type(type)
+{
+    const int cores = std::max(1, int(std::thread::hardware_concurrency()));
+    const int B = BROWSER;
+    const int R = RENDERER;
+    const int BR = BROWSER | RENDERER;
+
+    switch (m_type)
+    {
+    case Type::LowMemory:
+        m_switches = {
+            { "renderer-process-limit", "1", B },
+            { "process-per-site", "", B },
+            { "enable-low-end-device-mode", "", ALL },
+            { "num-raster-threads", "1", BR },
+            { "js-flags", "--max-old-space-size=128 --optimize-for-size", R },
+        };
+        break;
+
+    case Type::LowLatency:
+        m_switches = {
+            { "enable-gpu-rasterization", "", ALL },
+            { "num-raster-threads", "2", BR },
+            { "disable-background-timer-throttling", "", BR },
+            { "disable-renderer-backgrounding", "", BR },
+            { "disable-backgrounding-occluded-windows", "", BR },
+        };
+        break;
+
+    case Type::MaxThroughput:
+        m_switches = {
+            { "enable-gpu-rasterization", "", ALL },
+            { "num-raster-threads", std::to_string(std::min(4, cores)), BR },
+            { "js-flags", "--max-old-space-size=4096", R },
+            { "disable-background-timer-throttling", "", BR },
+            { "disable-renderer-backgrounding", "", BR },
+        };
+        break;
+
+    case Type::SoftwareOnly:
+        m_switches = {
+            { "disable-gpu", "", ALL },
+            { "disable-gpu-compositing", "", ALL },
+            { "enable-begin-frame-scheduling", "", BR },
+            { "num-raster-threads", std::to_string(std::min(4, cores)), BR },
+        };
+        break;
+
+    case Type::Default:
+    default:
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool PerformanceProfile::parse(std::string const& name, Type& type)
+{
+    for (size_t i = 0; i < sizeof(PROFILE_NAMES) / sizeof(PROFILE_NAMES[0]); ++i)
+    {
+        if (name == PROFILE_NAMES[i])
+        {
+            type = Type(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+PerformanceProfile PerformanceProfile::select(CefRefPtr<CefCommandLine> command_line)
+{
+    std::string name;
+    if ((command_line != nullptr) && command_line->HasSwitch(PROFILE_SWITCH))
+    {
+        name = command_line->GetSwitchValue(PROFILE_SWITCH).ToString();
+    }
+    else if (const char* env = std::getenv(PROFILE_ENV))
+    {
+        name = env;
+    }
+
+    Type type = Type::Default;
+    if (!name.empty() && !parse(name, type))
+    {
+        std::fprintf(stderr, "Unknown performance profile '%s': using default\n",
+                     name.c_str());
+    }
+    return PerformanceProfile(type);
+}
+
+//------------------------------------------------------------------------------
+const char* PerformanceProfile::name() const
+{
+    return PROFILE_NAMES[int(m_type)];
+}
+
+//------------------------------------------------------------------------------
+void PerformanceProfile::apply(std::string const& process_type,
+                               CefRefPtr<CefCommandLine> command_line) const
+{
+    const int mask = processMask(process_type);
+    for (auto const& it: m_switches)
+    {
+        if (((it.processes & mask) == 0) || command_line->HasSwitch(it.name))
+            continue;
+
+        if (it.value.empty())
+        {
+            command_line->AppendSwitch(it.name);
+        }
+        else
+        {
+            command_line->AppendSwitchWithValue(it.name, it.value);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void PerformanceProfile::log() const
+{
+    std::printf("Performance profile: %s\n", name());
+    for (auto const& it: m_switches)
+    {
+        if (it.value.empty())
+        {
+            std::printf("  --%s\n", it.name.c_str());
+        }
+        else
+        {
+            std::printf("  --%s=%s\n", it.name.c_str(), it.value.c_str());
+        }
+    }
+    std::fflush(stdout);
+}
@@ -0,0 +1,99 @@
+// Chromium command line switches grouped by performance profile.
+
+#ifndef PERFORMANCEPROFILE_HPP
+#  define PERFORMANCEPROFILE_HPP
+
+#  include <cef_command_line.h>
+#  include <string>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Typed set of Chromium switches tuning CEF for a kind of host. The
+//! profile is chosen with --perf-profile=<name> on the application command
+//! line or with the OFFSCREENCEF_PROFILE environment variable.
+//!
+//! Switches are not all meaningful in all processes: the browser process ones
+//! are appended from CefApp::OnBeforeCommandLineProcessing() and the
+//! subprocess ones from CefBrowserProcessHandler::OnBeforeChildProcessLaunch()
+//! which is the only place where CEF lets the host edit a child command line.
+// *****************************************************************************
+class PerformanceProfile
+{
+public:
+
+    enum class Type
+    {
+        //! \brief Chromium defaults: no switch is added.
+        Default,
+        //! \brief Single renderer process, small JS heap, one raster thread.
+        LowMemory,
+        //! \brief GPU raster, no background throttling.
+        LowLatency,
+        //! \brief Many raster threads, large JS heap, no throttling.
+        MaxThroughput,
+        //! \brief No GPU process work at all (llvmpipe / headless hosts).
+        SoftwareOnly
+    };
+
+    //! \brief Process kinds a switch applies to (bit mask).
+    enum Process
+    {
+        BROWSER = 1 << 0,
+        RENDERER = 1 << 1,
+        GPU = 1 << 2,
+        UTILITY = 1 << 3,
+        ALL = BROWSER | RENDERER | GPU | UTILITY
+    };
+
+    //! \brief Chromium switch and the processes needing it.
+    struct Switch
+    {
+        std::string name;
+        std::string value;
+        int processes;
+    };
+
+    //! \brief Create the profile of the given type.
+    explicit PerformanceProfile(Type type = Type::Default);
+
+    //! \brief Create the profile named on the command line or in the
+    //! environment. Unknown names fall back to the default profile.
+    static PerformanceProfile select(CefRefPtr<CefCommandLine> command_line);
+
+    //! \brief Convert a name (i.e. "low-memory") to a type.
+    //! \return false if the name is unknown.
+    static bool parse(std::string const& name, Type& type);
+
+    //! \brief Name of the profile (i.e. "low-memory").
+    const char* name() const;
+
+    //! \brief Profile type.
+    inline Type type() const
+    {
+        return m_type;
+    }
+
+    //! \brief Return true if the profile disables GPU rendering (WebGL and
+    //! accelerated CSS3 are then unavailable).
+    bool softwareOnly() const
+    {
+        return m_type == Type::SoftwareOnly;
+    }
+
+    //! \brief Append the switches of the profile to the command line of a
+    //! process. \c process_type is the value of --type= (empty for the
+    //! browser process). Switches already present are not overridden so the
+    //! user can still tune a single switch by hand.
+    void apply(std::string const& process_type,
+               CefRefPtr<CefCommandLine> command_line) const;
+
+    //! \brief Print the profile and its switches on the console.
+    void log() const;
+
+private:
+
+    Type m_type;
+    std::vector<Switch> m_switches;
+};
+
+#endif // PERFORMANCEPROFILE_HPP
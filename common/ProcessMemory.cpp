@@ -0,0 +1,129 @@
+// Memory used by this process and the Chromium subprocesses it spawned.
+
+#include "ProcessMemory.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+
+#if defined(__linux__)
+#  include <dirent.h>
+#  include <unistd.h>
+#endif
+
+#if defined(__linux__)
+
+//------------------------------------------------------------------------------
+//! \brief Parent pid read from /proc/<pid>/stat, -1 if unknown.
+//------------------------------------------------------------------------------
+static int parentPid(int pid)
+{
+    std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+
+    // "pid (comm) state ppid ...": comm may hold spaces and parentheses
+    const size_t end = stat.rfind(')');
+    if (end == std::string::npos)
+        return -1;
+
+    std::istringstream fields(stat.substr(end + 1u));
+    std::string state;
+    int ppid = -1;
+    fields >> state >> ppid;
+    return ppid;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Return true if the NUL separated command line of the process holds
+//! the given argument.
+//------------------------------------------------------------------------------
+static bool hasArgument(int pid, std::string const& argument)
+{
+    std::ifstream file("/proc/" + std::to_string(pid) + "/cmdline");
+    std::string arg;
+    while (std::getline(file, arg, '\0'))
+    {
+        if (arg == argument)
+            return true;
+    }
+    return false;
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+size_t ProcessMemory::rss(int pid)
+{
+#if defined(__linux__)
+    // statm: size resident shared text lib data dt (in pages)
+    std::ifstream file(pid == 0 ? std::string("/proc/self/statm")
+                       : "/proc/" + std::to_string(pid) + "/statm");
+    size_t size = 0u, resident = 0u;
+    if (!(file >> size >> resident))
+        return 0u;
+    return resident * size_t(sysconf(_SC_PAGESIZE));
+#else
+    (void) pid;
+    return 0u;
+#endif
+}
+
+//------------------------------------------------------------------------------
+std::vector<int> ProcessMemory::subprocesses(std::string const& type)
+{
+    std::vector<int> pids;
+
+#if defined(__linux__)
+    DIR* proc = opendir("/proc");
+    if (proc == nullptr)
+        return pids;
+
+    // Parent of every process, to walk up to this one
+    std::map<int, int> parents;
+    while (struct dirent* entry = readdir(proc))
+    {
+        char* end = nullptr;
+        const long pid = std::strtol(entry->d_name, &end, 10);
+        if ((pid > 0) && (*end == '\0'))
+        {
+            parents[int(pid)] = parentPid(int(pid));
+        }
+    }
+    closedir(proc);
+
+    const int self = int(getpid());
+    const std::string argument = "--type=" + type;
+    for (auto const& it: parents)
+    {
+        int ancestor = it.second;
+        while ((ancestor > 1) && (ancestor != self))
+        {
+            auto parent = parents.find(ancestor);
+            ancestor = (parent != parents.end()) ? parent->second : -1;
+        }
+
+        if ((ancestor == self) && hasArgument(it.first, argument))
+        {
+            pids.push_back(it.first);
+        }
+    }
+#else
+    (void) type;
+#endif
+
+    return pids;
+}
+
+//------------------------------------------------------------------------------
+size_t ProcessMemory::rss(std::string const& type)
+{
+    size_t bytes = 0u;
+    for (int pid: subprocesses(type))
+    {
+        bytes += rss(pid);
+    }
+    return bytes;
+}
@@ -0,0 +1,35 @@
+// Memory used by this process and the Chromium subprocesses it spawned.
+
+#ifndef PROCESSMEMORY_HPP
+#  define PROCESSMEMORY_HPP
+
+#  include <cstddef>
+#  include <string>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Read the resident memory of processes from /proc (Linux only, 0 is
+//! returned elsewhere). Chromium subprocesses are found by their --type=
+//! switch among the descendants of this process (the zygote forks renderers
+//! so they are not direct children).
+//!
+//! Pages shared between processes are counted in each of them: sums are an
+//! upper bound, differences over time are what matters.
+// *****************************************************************************
+class ProcessMemory
+{
+public:
+
+    //! \brief Resident set size in bytes of the given process (this one when
+    //! \c pid is 0). Return 0 if unknown.
+    static size_t rss(int pid = 0);
+
+    //! \brief Pids of the descendants of this process whose command line holds
+    //! --type=<type> (i.e. "renderer", "gpu-process").
+    static std::vector<int> subprocesses(std::string const& type);
+
+    //! \brief Sum of the resident set size of subprocesses of the given type.
+    static size_t rss(std::string const& type);
+};
+
+#endif // PROCESSMEMORY_HPP
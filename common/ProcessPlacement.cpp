@@ -0,0 +1,283 @@
+// CPU affinity, nice level and cgroup of subprocesses by process type.
+
+#include "ProcessPlacement.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#  include <fcntl.h>
+#  include <sched.h>
+#  include <sys/resource.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+const char* ProcessPlacement::SWITCH = "placement";
+const char* ProcessPlacement::ENV = "OFFSCREENCEF_PLACEMENT";
+
+//! \brief Mount point of the cgroup v2 hierarchy.
+static const char* CGROUP_ROOT = "/sys/fs/cgroup";
+
+//------------------------------------------------------------------------------
+static std::string trim(std::string const& text)
+{
+    const size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+        return {};
+    const size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1u);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Value of --name=value in argv, else of the environment variable
+//! (if any).
+//------------------------------------------------------------------------------
+static const char* option(int argc, char* argv[], const char* name, const char* env)
+{
+    const size_t size = std::strlen(name);
+    for (int i = 1; i < argc; ++i)
+    {
+        if ((std::strncmp(argv[i], "--", 2u) == 0) &&
+            (std::strncmp(argv[i] + 2, name, size) == 0) &&
+            (argv[i][2u + size] == '='))
+            return argv[i] + 3u + size;
+    }
+    return (env == nullptr) ? nullptr : std::getenv(env);
+}
+
+#if defined(__linux__)
+
+//------------------------------------------------------------------------------
+//! \brief Parse a CPU list "0-3,6" into \c set.
+//------------------------------------------------------------------------------
+static bool parseCpus(const char* list, cpu_set_t& set)
+{
+    CPU_ZERO(&set);
+    while (*list != '\0')
+    {
+        char* end;
+        const long first = std::strtol(list, &end, 10);
+        long last = first;
+        if (end == list)
+            return false;
+        if (*end == '-')
+        {
+            list = end + 1;
+            last = std::strtol(list, &end, 10);
+            if (end == list)
+                return false;
+        }
+        if ((first < 0) || (last < first) || (last >= CPU_SETSIZE))
+            return false;
+        for (long cpu = first; cpu <= last; ++cpu)
+        {
+            CPU_SET(int(cpu), &set);
+        }
+        list = end;
+        if (*list == ',')
+        {
+            ++list;
+        }
+        else if (*list != '\0')
+            return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static bool applyCpus(std::string const& cpus)
+{
+    // "^list": CPUs currently allowed but the listed ones
+    const bool exclude = (cpus[0] == '^');
+    cpu_set_t set;
+    if (!parseCpus(cpus.c_str() + (exclude ? 1 : 0), set))
+    {
+        std::fprintf(stderr, "Placement: bad CPU list '%s'\n", cpus.c_str());
+        return false;
+    }
+    if (exclude)
+    {
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+            return false;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+            {
+                CPU_CLR(cpu, &allowed);
+            }
+        }
+        set = allowed;
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    {
+        std::fprintf(stderr, "Placement: cannot set CPU affinity '%s': %s\n",
+                     cpus.c_str(), std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static bool applyCgroup(std::string const& cgroup)
+{
+    const std::string path = (cgroup[0] == '/') ? cgroup : std::string(CGROUP_ROOT) + "/" + cgroup;
+    if ((::mkdir(path.c_str(), 0755) != 0) && (errno != EEXIST))
+    {
+        std::fprintf(stderr, "Placement: cannot create cgroup %s: %s\n",
+                     path.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    // Write the pid in one write(): errors are reported by it
+    char pid[32];
+    const int size = std::snprintf(pid, sizeof(pid), "%d\n", int(::getpid()));
+    const int fd = ::open((path + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+    const bool joined = (fd >= 0) && (::write(fd, pid, size_t(size)) == ssize_t(size));
+    const int error = errno;
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+    if (!joined)
+    {
+        std::fprintf(stderr, "Placement: cannot join cgroup %s: %s\n",
+                     path.c_str(), std::strerror(error));
+        return false;
+    }
+    return true;
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+bool ProcessPlacement::load(std::string const& filename)
+{
+    FILE* file = std::fopen(filename.c_str(), "r");
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "Cannot read placement '%s'\n", filename.c_str());
+        return false;
+    }
+
+    bool ok = true;
+    Policy* policy = nullptr;
+    char buffer[512];
+    int number = 0;
+    while (std::fgets(buffer, sizeof(buffer), file) != nullptr)
+    {
+        ++number;
+        const std::string line = trim(buffer);
+        if (line.empty() || (line[0] == '#'))
+            continue;
+
+        if ((line[0] == '[') && (line.back() == ']'))
+        {
+            policy = &m_policies[trim(line.substr(1u, line.size() - 2u))];
+            continue;
+        }
+
+        const size_t equal = line.find('=');
+        const std::string key = trim(line.substr(0u, equal));
+        const std::string value = (equal == std::string::npos) ? "" : trim(line.substr(equal + 1u));
+        char* end = nullptr;
+        if ((policy == nullptr) || value.empty())
+        {
+            ok = false;
+        }
+        else if (key == "cpus")
+        {
+            policy->cpus = value;
+        }
+        else if (key == "nice")
+        {
+            policy->nice = int(std::strtol(value.c_str(), &end, 10));
+            policy->has_nice = (*end == '\0');
+            ok &= policy->has_nice;
+        }
+        else if (key == "cgroup")
+        {
+            policy->cgroup = value;
+        }
+        else
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            std::fprintf(stderr, "Placement %s:%d: bad line '%s'\n",
+                         filename.c_str(), number, line.c_str());
+            break;
+        }
+    }
+    std::fclose(file);
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+ProcessPlacement::Policy const* ProcessPlacement::policy(std::string const& type) const
+{
+    auto it = m_policies.find(type);
+    if ((it == m_policies.end()) && (type == "zygote"))
+    {
+        it = m_policies.find("renderer");
+    }
+    return (it == m_policies.end()) ? nullptr : &it->second;
+}
+
+//------------------------------------------------------------------------------
+bool ProcessPlacement::apply(Policy const& policy)
+{
+#if defined(__linux__)
+    // Join the cgroup first: its cpuset limits the affinity that can be set
+    bool ok = true;
+    if (!policy.cgroup.empty())
+    {
+        ok &= applyCgroup(policy.cgroup);
+    }
+    if (!policy.cpus.empty())
+    {
+        ok &= applyCpus(policy.cpus);
+    }
+    if (policy.has_nice && (::setpriority(PRIO_PROCESS, 0, policy.nice) != 0))
+    {
+        std::fprintf(stderr, "Placement: cannot set nice %d: %s\n",
+                     policy.nice, std::strerror(errno));
+        ok = false;
+    }
+    return ok;
+#else
+    (void) policy;
+    return true;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void ProcessPlacement::setup(int argc, char* argv[])
+{
+    const char* filename = option(argc, argv, SWITCH, ENV);
+    const char* type = option(argc, argv, "type", nullptr);
+    if ((filename == nullptr) || (*filename == '\0') || (type == nullptr))
+        return ;
+
+    ProcessPlacement placement;
+    if (!placement.load(filename))
+        return ;
+
+    if (Policy const* policy = placement.policy(type))
+    {
+        apply(*policy);
+    }
+}
+
+//------------------------------------------------------------------------------
+void ProcessPlacement::forward(int argc, char* argv[])
+{
+    if (const char* filename = option(argc, argv, SWITCH, nullptr))
+    {
+        ::setenv(ENV, filename, 1);
+    }
+}
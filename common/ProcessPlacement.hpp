@@ -0,0 +1,84 @@
+// CPU affinity, nice level and cgroup of subprocesses by process type.
+
+#ifndef PROCESSPLACEMENT_HPP
+#  define PROCESSPLACEMENT_HPP
+
+#  include <map>
+#  include <string>
+
+// *****************************************************************************
+//! \brief Place CEF subprocesses on CPUs, at a nice level and in a cgroup v2
+//! according to their process type, so renderers stay off the cores reserved
+//! for the compositor and other services. Applied by the secondary
+//! executable to itself before CefExecuteProcess(): threads started by
+//! Chromium and processes forked later inherit the placement.
+//!
+//! Placement file, one section per process type (--type=), each key being
+//! optional:
+//!   # comment
+//!   [renderer]
+//!   cpus = 2-7,10     CPU affinity (CPU list as in /proc/<pid>/status)
+//!   cpus = ^0-1       all CPUs the process may use but these ones
+//!   nice = 10         nice level (lowering it needs CAP_SYS_NICE)
+//!   cgroup = offscreencef/renderers
+//!                     cgroup v2 to join, relative to /sys/fs/cgroup unless
+//!                     absolute. Created if missing. Its parent shall be
+//!                     writable (delegated subtree).
+//! On Linux, renderers are forked from the zygote and do not start the
+//! executable again: a zygote without its own section gets the renderer
+//! placement.
+//!
+//! The file is given with --placement=<file> on the command line of the
+//! browser process (see forward()) or the OFFSCREENCEF_PLACEMENT environment
+//! variable. Errors are printed on
+//! stderr without iostream: this runs first in every subprocess.
+// *****************************************************************************
+class ProcessPlacement
+{
+public:
+
+    // *************************************************************************
+    //! \brief Placement of a process type.
+    // *************************************************************************
+    struct Policy
+    {
+        //! \brief CPU list, empty to keep the inherited affinity.
+        std::string cpus;
+        bool has_nice = false;
+        int nice = 0;
+        //! \brief cgroup v2 path, empty to stay in the inherited one.
+        std::string cgroup;
+    };
+
+    //! \brief Command line switch and environment variable naming the file.
+    static const char* SWITCH;
+    static const char* ENV;
+
+    //! \brief Place the calling process according to its --type and to the
+    //! file given by --placement or OFFSCREENCEF_PLACEMENT. Does nothing
+    //! without file. To be called first in main().
+    static void setup(int argc, char* argv[]);
+
+    //! \brief Called by the browser process before CefInitialize(): export
+    //! the file given by --placement in OFFSCREENCEF_PLACEMENT so all
+    //! subprocesses inherit it, including the zygote which does not get the
+    //! switches of OnBeforeChildProcessLaunch().
+    static void forward(int argc, char* argv[]);
+
+    //! \brief Read the placement file.
+    //! \return false if the file cannot be read or has errors.
+    bool load(std::string const& filename);
+
+    //! \brief Policy of the process type, nullptr if the file has none.
+    Policy const* policy(std::string const& type) const;
+
+    //! \brief Place the calling process.
+    //! \return false if a step failed (printed on stderr).
+    static bool apply(Policy const& policy);
+
+private:
+
+    std::map<std::string, Policy> m_policies;
+};
+
+#endif // PROCESSPLACEMENT_HPP
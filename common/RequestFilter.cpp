@@ -0,0 +1,63 @@
+// Requests of a browser: blocking and shared responses.
+
+#include "RequestFilter.hpp"
+#include "Blocklist.hpp"
+#include "ResponseCache.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+//------------------------------------------------------------------------------
+cef_return_value_t RequestFilter::OnBeforeResourceLoad(CefRefPtr<CefBrowser> /*browser*/,
+                                                       CefRefPtr<CefFrame> /*frame*/,
+                                                       CefRefPtr<CefRequest> request,
+                                                       CefRefPtr<CefCallback> /*callback*/)
+{
+    ++m_requests;
+    if ((request->GetResourceType() != RT_MAIN_FRAME) &&
+        Blocklist::global().blocked(request->GetURL().ToString()))
+    {
+        ++m_blocked;
+        return RV_CANCEL;
+    }
+    return RV_CONTINUE;
+}
+
+//------------------------------------------------------------------------------
+CefRefPtr<CefResourceHandler> RequestFilter::GetResourceHandler(CefRefPtr<CefBrowser> browser,
+                                                                CefRefPtr<CefFrame> frame,
+                                                                CefRefPtr<CefRequest> request)
+{
+    CefRefPtr<ResponseCache> cache = ResponseCache::global();
+    if (cache == nullptr)
+        return nullptr;
+
+    CefRefPtr<CefResourceRequestHandler> handler = cache->handler(request);
+    return (handler != nullptr) ? handler->GetResourceHandler(browser, frame, request) : nullptr;
+}
+
+//------------------------------------------------------------------------------
+void RequestFilter::OnResourceLoadComplete(CefRefPtr<CefBrowser> /*browser*/,
+                                           CefRefPtr<CefFrame> /*frame*/,
+                                           CefRefPtr<CefRequest> /*request*/,
+                                           CefRefPtr<CefResponse> /*response*/,
+                                           cef_urlrequest_status_t /*status*/,
+                                           int64_t received_content_length)
+{
+    if (received_content_length > 0)
+    {
+        m_loaded_bytes += uint64_t(received_content_length);
+    }
+}
+
+//------------------------------------------------------------------------------
+void RequestFilter::log(int browser_id) const
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << "Browser " << browser_id << ": " << blocked() << "/" << requests()
+        << " requests blocked, " << double(loadedBytes()) / 1048576.0
+        << " MB loaded";
+    std::cout << out.str() << std::endl;
+}
@@ -0,0 +1,68 @@
+// Requests of a browser: blocking and shared responses.
+
+#ifndef REQUESTFILTER_HPP
+#  define REQUESTFILTER_HPP
+
+#  include <cef_resource_request_handler.h>
+
+#  include <atomic>
+#  include <cstdint>
+
+// *****************************************************************************
+//! \brief Resource request handler of one browser, given from
+//! CefRequestHandler::GetResourceRequestHandler(). Cancels requests matching
+//! the Blocklist (except the page itself), serves the others from the
+//! ResponseCache when possible and counts them.
+// *****************************************************************************
+class RequestFilter: public CefResourceRequestHandler
+{
+public:
+
+    //! \brief Requests of the browser since its creation. Requests never sent
+    //! have no known size: only the bytes of loaded ones are counted.
+    inline uint64_t requests() const
+    {
+        return m_requests.load();
+    }
+
+    inline uint64_t blocked() const
+    {
+        return m_blocked.load();
+    }
+
+    inline uint64_t loadedBytes() const
+    {
+        return m_loaded_bytes.load();
+    }
+
+    //! \brief Print the counters of the browser.
+    void log(int browser_id) const;
+
+private: // CefResourceRequestHandler interfaces (IO thread)
+
+    //! \brief Cancel blocked requests.
+    virtual cef_return_value_t OnBeforeResourceLoad(
+        CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
+        CefRefPtr<CefRequest> request, CefRefPtr<CefCallback> callback) override;
+
+    //! \brief Serve the request from the response cache if possible.
+    virtual CefRefPtr<CefResourceHandler> GetResourceHandler(
+        CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
+        CefRefPtr<CefRequest> request) override;
+
+    //! \brief Count loaded bytes.
+    virtual void OnResourceLoadComplete(
+        CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
+        CefRefPtr<CefRequest> request, CefRefPtr<CefResponse> response,
+        cef_urlrequest_status_t status, int64_t received_content_length) override;
+
+private:
+
+    std::atomic<uint64_t> m_requests{0u};
+    std::atomic<uint64_t> m_blocked{0u};
+    std::atomic<uint64_t> m_loaded_bytes{0u};
+
+    IMPLEMENT_REFCOUNTING(RequestFilter);
+};
+
+#endif // REQUESTFILTER_HPP
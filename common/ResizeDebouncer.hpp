@@ -0,0 +1,74 @@
+// Coalesce window resize events before forwarding them to Chromium.
+
+#ifndef RESIZEDEBOUNCER_HPP
+#  define RESIZEDEBOUNCER_HPP
+
+#  include <chrono>
+
+// *****************************************************************************
+//! \brief Dragging a window edge produces a resize event per frame and every
+//! CefBrowserHost::WasResized() makes Chromium re-layout and repaint the whole
+//! page. This class coalesces these events: the new size is forwarded at most
+//! once per interval while the drag goes on, and once more when the drag ends
+//! (no event during the quiet period). Meanwhile the application keeps drawing
+//! the last frame stretched to the new window size.
+// *****************************************************************************
+class ResizeDebouncer
+{
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    //! \brief \c interval: minimum time between two forwarded sizes during a
+    //! drag. \c quiet: time without event after which the drag is considered
+    //! as ended.
+    ResizeDebouncer(std::chrono::milliseconds interval = std::chrono::milliseconds(250),
+                    std::chrono::milliseconds quiet = std::chrono::milliseconds(60))
+        : m_interval(interval), m_quiet(quiet)
+    {}
+
+    //! \brief Record a resize event from the windowing system.
+    void request(int width, int height)
+    {
+        m_width = width;
+        m_height = height;
+        m_last_request = Clock::now();
+        m_pending = true;
+    }
+
+    //! \brief To be called once per frame. Return true (and the size to
+    //! forward to Chromium) when the pending size shall be applied now.
+    bool poll(int& width, int& height)
+    {
+        if (!m_pending)
+            return false;
+
+        const Clock::time_point now = Clock::now();
+        if ((now - m_last_request < m_quiet) && (now - m_last_apply < m_interval))
+            return false;
+
+        m_pending = false;
+        m_last_apply = now;
+        width = m_width;
+        height = m_height;
+        return true;
+    }
+
+    //! \brief Return true if a size is waiting to be forwarded.
+    inline bool pending() const
+    {
+        return m_pending;
+    }
+
+private:
+
+    std::chrono::milliseconds m_interval;
+    std::chrono::milliseconds m_quiet;
+    Clock::time_point m_last_request;
+    Clock::time_point m_last_apply;
+    int m_width = 0;
+    int m_height = 0;
+    bool m_pending = false;
+};
+
+#endif // RESIZEDEBOUNCER_HPP
@@ -0,0 +1,593 @@
+// Responses shared by all browsers of the process.
+
+#include "ResponseCache.hpp"
+
+#include <cef_command_line.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+//! \brief Command line switch and environment variable setting the cap.
+static const char* CACHE_SWITCH = "response-cache-mb";
+static const char* CACHE_ENV = "OFFSCREENCEF_RESPONSE_CACHE_MB";
+
+//! \brief Default cap in megabytes.
+static const size_t DEFAULT_SIZE_MB = 64u;
+
+//! \brief Lifetime of responses without max-age.
+static const std::chrono::seconds DEFAULT_LIFETIME(60);
+
+//! \brief A response larger than this part of the cap is not cached.
+static const size_t MAX_ENTRY_RATIO = 8u;
+
+//! \brief Counters are logged every this number of requests.
+static const uint64_t LOG_PERIOD = 200u;
+
+//------------------------------------------------------------------------------
+static std::string lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return char(std::tolower(c)); });
+    return s;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Value of a header (case insensitive name), empty if missing.
+//------------------------------------------------------------------------------
+static std::string header(CefResponse::HeaderMap const& headers, const char* name)
+{
+    for (auto const& it: headers)
+    {
+        if (lower(it.first.ToString()) == name)
+            return it.second.ToString();
+    }
+    return {};
+}
+
+//------------------------------------------------------------------------------
+//! \brief Comma separated tokens, trimmed and lower case.
+//------------------------------------------------------------------------------
+static std::vector<std::string> tokens(std::string const& value)
+{
+    std::vector<std::string> result;
+    size_t start = 0u;
+    while (start <= value.size())
+    {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = value.size();
+        }
+        const size_t first = value.find_first_not_of(" \t", start);
+        const size_t last = value.find_last_not_of(" \t", end - 1u);
+        if ((first < end) && (last != std::string::npos) && (last >= first))
+        {
+            result.push_back(lower(value.substr(first, last - first + 1u)));
+        }
+        start = end + 1u;
+    }
+    return result;
+}
+
+//------------------------------------------------------------------------------
+//! \brief How long the response can be reused, zero if it shall not be cached.
+//------------------------------------------------------------------------------
+static std::chrono::seconds lifetime(CefResponse::HeaderMap const& headers)
+{
+    if (!header(headers, "set-cookie").empty())
+        return std::chrono::seconds(0);
+
+    std::chrono::seconds result = DEFAULT_LIFETIME;
+    for (auto const& directive: tokens(header(headers, "cache-control")))
+    {
+        if ((directive == "no-store") || (directive == "no-cache") ||
+            (directive == "private"))
+            return std::chrono::seconds(0);
+
+        if (directive.compare(0u, 8u, "max-age=") == 0)
+        {
+            result = std::chrono::seconds(std::strtol(directive.c_str() + 8u, nullptr, 10));
+        }
+    }
+    return result;
+}
+
+// *****************************************************************************
+//! \brief Serve a request from a cached response or, once done, from the
+//! fetch it waits for. All methods are called on the CEF IO thread.
+// *****************************************************************************
+class ResponseCache::Handler: public CefResourceHandler
+{
+public:
+
+    Handler(CefRefPtr<ResponseCache> cache, CefRefPtr<CefBrowser> browser)
+        : m_cache(cache), m_browser(browser)
+    {}
+
+    //! \brief The fetch this handler waits for is done. Called on the thread
+    //! of the fetch, which may not be the one of Open().
+    void ready(std::shared_ptr<const Response> response)
+    {
+        CefRefPtr<CefCallback> callback;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_response = response;
+            callback = m_callback;
+            m_callback = nullptr;
+        }
+        if (callback != nullptr)
+        {
+            callback->Continue();
+        }
+    }
+
+private: // CefResourceHandler interfaces
+
+    virtual bool Open(CefRefPtr<CefRequest> request, bool& handle_request,
+                      CefRefPtr<CefCallback> callback) override
+    {
+        std::shared_ptr<const Response> hit = m_cache->open(m_browser, request, this);
+
+        // The fetch may already be done: only wait for it if ready() has not
+        // been called yet.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (hit != nullptr)
+        {
+            m_response = hit;
+        }
+        handle_request = (m_response != nullptr);
+        if (!handle_request)
+        {
+            m_callback = callback;
+        }
+        return true;
+    }
+
+    virtual void GetResponseHeaders(CefRefPtr<CefResponse> response,
+                                    int64_t& response_length,
+                                    CefString& /*redirectUrl*/) override
+    {
+        if (m_response->error != ERR_NONE)
+        {
+            response->SetError(m_response->error);
+            response_length = 0;
+            return ;
+        }
+
+        response->SetStatus(m_response->status);
+        response->SetStatusText(m_response->status_text);
+        response->SetMimeType(m_response->mime_type);
+        response->SetCharset(m_response->charset);
+        response->SetHeaderMap(m_response->headers);
+        response_length = int64_t(m_response->body.size());
+    }
+
+    virtual bool Skip(int64_t bytes_to_skip, int64_t& bytes_skipped,
+                      CefRefPtr<CefResourceSkipCallback> /*callback*/) override
+    {
+        // Nothing left: fail with an error code as AssetHandler does
+        if (m_offset >= m_response->body.size())
+        {
+            bytes_skipped = ERR_REQUEST_RANGE_NOT_SATISFIABLE;
+            return false;
+        }
+        const size_t skip = std::min(size_t(bytes_to_skip), m_response->body.size() - m_offset);
+        m_offset += skip;
+        bytes_skipped = int64_t(skip);
+        return true;
+    }
+
+    virtual bool Read(void* data_out, int bytes_to_read, int& bytes_read,
+                      CefRefPtr<CefResourceReadCallback> /*callback*/) override
+    {
+        const size_t n = std::min(size_t(bytes_to_read), m_response->body.size() - m_offset);
+        std::memcpy(data_out, m_response->body.data() + m_offset, n);
+        m_offset += n;
+        bytes_read = int(n);
+        return n > 0u;
+    }
+
+    virtual void Cancel() override
+    {
+        // The fetch goes on for the other requests waiting for it
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_callback = nullptr;
+    }
+
+private:
+
+    CefRefPtr<ResponseCache> m_cache;
+    CefRefPtr<CefBrowser> m_browser;
+    //! \brief Guards m_callback and m_response until the response is known.
+    std::mutex m_mutex;
+    CefRefPtr<CefCallback> m_callback;
+    std::shared_ptr<const Response> m_response;
+    size_t m_offset = 0u;
+
+    IMPLEMENT_REFCOUNTING(Handler);
+};
+
+// *****************************************************************************
+//! \brief Fetch a response for all the requests waiting for it. Callbacks are
+//! called on the thread which started the fetch (CEF IO thread).
+// *****************************************************************************
+class ResponseCache::Fetch: public CefURLRequestClient
+{
+public:
+
+    Fetch(CefRefPtr<ResponseCache> cache, std::string const& scope, std::string const& key)
+        : m_cache(cache), m_scope(scope), m_key(key), m_response(std::make_shared<Response>())
+    {}
+
+    //! \brief Send a copy of the request with the cookies of the browser.
+    void start(CefRefPtr<CefBrowser> browser, CefRefPtr<CefRequest> request)
+    {
+        m_request = request;
+
+        CefRequest::HeaderMap headers;
+        request->GetHeaderMap(headers);
+        CefRefPtr<CefRequest> copy = CefRequest::Create();
+        copy->SetURL(request->GetURL());
+        copy->SetMethod("GET");
+        copy->SetHeaderMap(headers);
+        copy->SetReferrer(request->GetReferrerURL(), request->GetReferrerPolicy());
+        copy->SetFlags(UR_FLAG_ALLOW_STORED_CREDENTIALS);
+
+        CefRefPtr<CefRequestContext> context =
+            (browser != nullptr) ? browser->GetHost()->GetRequestContext() : nullptr;
+        m_url_request = CefURLRequest::Create(copy, this, context);
+    }
+
+    //! \brief Requests served by this fetch. Guarded by the mutex of the
+    //! cache.
+    std::vector<CefRefPtr<Handler>> m_waiters;
+
+private: // CefURLRequestClient interfaces
+
+    virtual void OnRequestComplete(CefRefPtr<CefURLRequest> request) override
+    {
+        CefRefPtr<CefResponse> response = request->GetResponse();
+        if ((request->GetRequestStatus() != UR_SUCCESS) || (response == nullptr))
+        {
+            m_response->error = request->GetRequestError();
+            if (m_response->error == ERR_NONE)
+            {
+                m_response->error = ERR_FAILED;
+            }
+        }
+        else
+        {
+            m_response->status = response->GetStatus();
+            m_response->status_text = response->GetStatusText();
+            m_response->mime_type = response->GetMimeType();
+            m_response->charset = response->GetCharset();
+
+            // The body has been decoded and is served in one piece
+            CefResponse::HeaderMap headers;
+            response->GetHeaderMap(headers);
+            for (auto const& it: headers)
+            {
+                const std::string name = lower(it.first.ToString());
+                if ((name != "content-encoding") && (name != "content-length") &&
+                    (name != "transfer-encoding"))
+                {
+                    m_response->headers.insert(it);
+                }
+            }
+        }
+
+        m_cache->complete(m_scope, m_key, m_request, m_response);
+        m_url_request = nullptr;
+    }
+
+    virtual void OnUploadProgress(CefRefPtr<CefURLRequest>, int64_t, int64_t) override
+    {}
+
+    virtual void OnDownloadProgress(CefRefPtr<CefURLRequest>, int64_t, int64_t) override
+    {}
+
+    virtual void OnDownloadData(CefRefPtr<CefURLRequest> /*request*/,
+                                const void* data, size_t data_length) override
+    {
+        m_response->body.append(static_cast<const char*>(data), data_length);
+    }
+
+    virtual bool GetAuthCredentials(bool, const CefString&, int, const CefString&,
+                                    const CefString&, CefRefPtr<CefAuthCallback>) override
+    {
+        return false;
+    }
+
+private:
+
+    CefRefPtr<ResponseCache> m_cache;
+    const std::string m_scope;
+    const std::string m_key;
+    CefRefPtr<CefRequest> m_request;
+    CefRefPtr<CefURLRequest> m_url_request;
+    std::shared_ptr<Response> m_response;
+
+    IMPLEMENT_REFCOUNTING(Fetch);
+};
+
+//------------------------------------------------------------------------------
+CefRefPtr<ResponseCache> ResponseCache::global()
+{
+    static CefRefPtr<ResponseCache> cache = []() -> CefRefPtr<ResponseCache>
+    {
+        size_t mb = DEFAULT_SIZE_MB;
+        CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+        if ((command_line != nullptr) && command_line->HasSwitch(CACHE_SWITCH))
+        {
+            mb = size_t(std::strtoull(command_line->GetSwitchValue(CACHE_SWITCH).ToString().c_str(),
+                                      nullptr, 10));
+        }
+        else if (const char* env = std::getenv(CACHE_ENV))
+        {
+            mb = size_t(std::strtoull(env, nullptr, 10));
+        }
+
+        std::cout << "Response cache: " << mb << " MB" << std::endl;
+        if (mb == 0u)
+            return nullptr;
+        return new ResponseCache(mb * 1024u * 1024u);
+    }();
+    return cache;
+}
+
+//------------------------------------------------------------------------------
+ResponseCache::ResponseCache(size_t max_bytes)
+    : m_max_bytes(max_bytes)
+{}
+
+//------------------------------------------------------------------------------
+CefRefPtr<CefResourceRequestHandler> ResponseCache::handler(CefRefPtr<CefRequest> request)
+{
+    switch (request->GetResourceType())
+    {
+    case RT_STYLESHEET:
+    case RT_SCRIPT:
+    case RT_IMAGE:
+    case RT_FONT_RESOURCE:
+    case RT_XHR:
+        break;
+    default:
+        return nullptr;
+    }
+
+    const std::string url = request->GetURL().ToString();
+    if ((request->GetMethod().ToString() != "GET") ||
+        ((url.compare(0u, 7u, "http://") != 0) && (url.compare(0u, 8u, "https://") != 0)) ||
+        !request->GetHeaderByName("Range").empty() ||
+        !request->GetHeaderByName("Authorization").empty())
+        return nullptr;
+
+    // Reloads bypass the cache
+    for (auto const& directive: tokens(request->GetHeaderByName("Cache-Control").ToString()))
+    {
+        if ((directive == "no-cache") || (directive == "no-store"))
+            return nullptr;
+    }
+
+    return this;
+}
+
+//------------------------------------------------------------------------------
+CefRefPtr<CefResourceHandler> ResponseCache::GetResourceHandler(CefRefPtr<CefBrowser> browser,
+                                                                CefRefPtr<CefFrame> /*frame*/,
+                                                                CefRefPtr<CefRequest> /*request*/)
+{
+    // In-memory contexts other than the global one cannot be told apart:
+    // leave their requests to Chromium.
+    std::string s;
+    if (!scope(browser, s))
+        return nullptr;
+    return new Handler(this, browser);
+}
+
+//------------------------------------------------------------------------------
+bool ResponseCache::scope(CefRefPtr<CefBrowser> browser, std::string& scope)
+{
+    scope.clear();
+    CefRefPtr<CefRequestContext> context =
+        (browser != nullptr) ? browser->GetHost()->GetRequestContext() : nullptr;
+    if ((context == nullptr) || context->IsGlobal())
+        return true;
+
+    scope = context->GetCachePath().ToString();
+    return !scope.empty();
+}
+
+//------------------------------------------------------------------------------
+std::string ResponseCache::base(std::string const& scope, CefRefPtr<CefRequest> request)
+{
+    return scope + '\t' + request->GetURL().ToString();
+}
+
+//------------------------------------------------------------------------------
+std::string ResponseCache::key(std::string const& scope, CefRefPtr<CefRequest> request) const
+{
+    std::string k = base(scope, request);
+    auto vary = m_vary.find(k);
+    if (vary != m_vary.end())
+    {
+        for (auto const& name: vary->second.names)
+        {
+            k += '\n' + name + ':' + request->GetHeaderByName(name).ToString();
+        }
+    }
+    return k;
+}
+
+//------------------------------------------------------------------------------
+void ResponseCache::remove(Lru::iterator entry)
+{
+    const std::string& k = entry->first;
+    auto vary = m_vary.find(k.substr(0u, k.find('\n')));
+    if ((vary != m_vary.end()) && (--vary->second.entries == 0u))
+    {
+        m_vary.erase(vary);
+    }
+    m_stats.bytes -= entry->second->body.size();
+    m_index.erase(k);
+    m_lru.erase(entry);
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<const ResponseCache::Response>
+ResponseCache::open(CefRefPtr<CefBrowser> browser, CefRefPtr<CefRequest> request,
+                    CefRefPtr<Handler> handler)
+{
+    std::shared_ptr<const Response> hit;
+    CefRefPtr<Fetch> fetch;
+    bool log_now;
+    {
+        std::string s;
+        scope(browser, s);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const std::string k = key(s, request);
+        log_now = ((m_stats.hits + m_stats.coalesced + m_stats.misses + 1u) % LOG_PERIOD) == 0u;
+
+        auto it = m_index.find(k);
+        if (it != m_index.end())
+        {
+            if (std::chrono::steady_clock::now() < it->second->second->expires)
+            {
+                hit = it->second->second;
+                m_lru.splice(m_lru.begin(), m_lru, it->second);
+                ++m_stats.hits;
+                m_stats.bytes_saved += hit->body.size();
+            }
+            else
+            {
+                remove(it->second);
+            }
+        }
+
+        if (hit == nullptr)
+        {
+            auto pending = m_fetches.find(k);
+            if (pending != m_fetches.end())
+            {
+                pending->second->m_waiters.push_back(handler);
+                ++m_stats.coalesced;
+            }
+            else
+            {
+                fetch = new Fetch(this, s, k);
+                fetch->m_waiters.push_back(handler);
+                m_fetches[k] = fetch;
+                ++m_stats.misses;
+            }
+        }
+    }
+
+    if (log_now)
+    {
+        log();
+    }
+    if (fetch != nullptr)
+    {
+        fetch->start(browser, request);
+    }
+    return hit;
+}
+
+//------------------------------------------------------------------------------
+void ResponseCache::complete(std::string const& scope, std::string const& k,
+                             CefRefPtr<CefRequest> request,
+                             std::shared_ptr<Response> response)
+{
+    std::vector<CefRefPtr<Handler>> waiters;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_fetches.find(k);
+        if (it != m_fetches.end())
+        {
+            waiters.swap(it->second->m_waiters);
+            m_fetches.erase(it);
+        }
+        if (waiters.size() > 1u)
+        {
+            m_stats.bytes_saved += response->body.size() * (waiters.size() - 1u);
+        }
+
+        // Store
+        const std::chrono::seconds ttl = lifetime(response->headers);
+        const std::vector<std::string> vary = tokens(header(response->headers, "vary"));
+        if ((response->error == ERR_NONE) && (response->status == 200) &&
+            (ttl.count() > 0) && (response->body.size() <= m_max_bytes / MAX_ENTRY_RATIO) &&
+            (std::find(vary.begin(), vary.end(), "*") == vary.end()))
+        {
+            // Bodies are decoded: the encoding they were sent with does not
+            // matter.
+            Vary& names = m_vary[base(scope, request)];
+            names.names.clear();
+            for (auto const& name: vary)
+            {
+                if (name != "accept-encoding")
+                {
+                    names.names.push_back(name);
+                }
+            }
+            ++names.entries;
+
+            response->expires = std::chrono::steady_clock::now() + ttl;
+            const std::string stored = key(scope, request);
+            auto old = m_index.find(stored);
+            if (old != m_index.end())
+            {
+                remove(old->second);
+            }
+            m_lru.emplace_front(stored, response);
+            m_index[stored] = m_lru.begin();
+            m_stats.bytes += response->body.size();
+            evict();
+        }
+    }
+
+    for (auto& waiter: waiters)
+    {
+        waiter->ready(response);
+    }
+}
+
+//------------------------------------------------------------------------------
+void ResponseCache::evict()
+{
+    while ((m_stats.bytes > m_max_bytes) && !m_lru.empty())
+    {
+        remove(std::prev(m_lru.end()));
+        ++m_stats.evictions;
+    }
+}
+
+//------------------------------------------------------------------------------
+ResponseCache::Stats ResponseCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.entries = m_lru.size();
+    return stats;
+}
+
+//------------------------------------------------------------------------------
+void ResponseCache::log() const
+{
+    const Stats s = stats();
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << "Response cache: " << s.hits << " hits, " << s.coalesced
+        << " merged, " << s.misses << " fetched (hit rate "
+        << 100.0 * s.hitRate() << "%), " << s.entries << " entries "
+        << double(s.bytes) / 1048576.0 << "/" << double(m_max_bytes) / 1048576.0
+        << " MB, " << s.evictions << " evicted, "
+        << double(s.bytes_saved) / 1048576.0 << " MB saved";
+    std::cout << out.str() << std::endl;
+}
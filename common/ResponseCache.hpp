@@ -0,0 +1,176 @@
+// Responses shared by all browsers of the process.
+
+#ifndef RESPONSECACHE_HPP
+#  define RESPONSECACHE_HPP
+
+#  include <cef_request_handler.h>
+#  include <cef_resource_request_handler.h>
+#  include <cef_urlrequest.h>
+
+#  include <chrono>
+#  include <cstdint>
+#  include <list>
+#  include <map>
+#  include <memory>
+#  include <mutex>
+#  include <string>
+#  include <unordered_map>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief In-memory cache of HTTP responses shared by all browsers, so views
+//! loading the same scripts, style sheets or feeds fetch them once. Concurrent
+//! requests for the same resource are merged into a single fetch.
+//!
+//! Only GET sub-resources (scripts, style sheets, images, fonts, XHR and
+//! fetch) without credentials or ranges are cached. Responses are kept for
+//! their Cache-Control max-age (one minute without it) unless marked
+//! no-store, no-cache or private, or setting cookies. Entries are keyed by
+//! request context, URL and by the request headers named in the Vary
+//! response header, and evicted least recently used first once over the size
+//! cap. Views with their own cache (--cache-mode=per-view) never share
+//! responses; in-memory contexts other than the global one are not cached.
+//!
+//! The size cap is set with --response-cache-mb=<n> on the command line or
+//! the OFFSCREENCEF_RESPONSE_CACHE_MB environment variable (default 64, 0 to
+//! disable the cache).
+// *****************************************************************************
+class ResponseCache: public CefResourceRequestHandler
+{
+public:
+
+    // *************************************************************************
+    //! \brief Counters since startup.
+    // *************************************************************************
+    struct Stats
+    {
+        //! \brief Requests served from the cache.
+        uint64_t hits = 0u;
+        //! \brief Requests served by the fetch of an identical request.
+        uint64_t coalesced = 0u;
+        //! \brief Requests fetched from the network.
+        uint64_t misses = 0u;
+        //! \brief Responses evicted to stay under the cap.
+        uint64_t evictions = 0u;
+        //! \brief Bytes served from the cache or from merged fetches.
+        uint64_t bytes_saved = 0u;
+        size_t entries = 0u;
+        size_t bytes = 0u;
+
+        //! \brief Part of requests not fetched from the network.
+        inline double hitRate() const
+        {
+            const uint64_t total = hits + coalesced + misses;
+            return (total == 0u) ? 0.0 : double(hits + coalesced) / double(total);
+        }
+    };
+
+    // *************************************************************************
+    //! \brief Response kept in the cache. Immutable once stored.
+    // *************************************************************************
+    struct Response
+    {
+        int status = 0;
+        std::string status_text;
+        std::string mime_type;
+        std::string charset;
+        CefResponse::HeaderMap headers;
+        std::string body;
+        cef_errorcode_t error = ERR_NONE;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    //! \brief Cache of the process configured from the command line, nullptr
+    //! if disabled.
+    static CefRefPtr<ResponseCache> global();
+
+    //! \brief Cache holding at most \c max_bytes of responses.
+    explicit ResponseCache(size_t max_bytes);
+
+    //! \brief Handler to give from CefRequestHandler::GetResourceRequestHandler()
+    //! for the given request: this cache if the request can be cached, else
+    //! nullptr.
+    CefRefPtr<CefResourceRequestHandler> handler(CefRefPtr<CefRequest> request);
+
+    //! \brief Counters since startup.
+    Stats stats() const;
+
+    //! \brief Print the counters.
+    void log() const;
+
+private: // CefResourceRequestHandler interfaces
+
+    //! \brief Serve the request from the cache or from a shared fetch.
+    virtual CefRefPtr<CefResourceHandler> GetResourceHandler(
+        CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
+        CefRefPtr<CefRequest> request) override;
+
+private:
+
+    class Fetch;
+    class Handler;
+    friend class Fetch;
+    friend class Handler;
+
+    //! \brief Find the cached response of the request, else join or start its
+    //! fetch. Called by Handler::Open().
+    //! \return the response if cached, else nullptr and \c handler is
+    //! notified by Fetch once done.
+    std::shared_ptr<const Response> open(CefRefPtr<CefBrowser> browser,
+                                         CefRefPtr<CefRequest> request,
+                                         CefRefPtr<Handler> handler);
+
+    //! \brief Store the fetched response if cacheable and forget the fetch.
+    //! Called by Fetch once done.
+    void complete(std::string const& scope, std::string const& key,
+                  CefRefPtr<CefRequest> request, std::shared_ptr<Response> response);
+
+    //! \brief Cache path of the request context of the browser, empty for
+    //! the global context.
+    //! \return false if the context cannot be told apart from others
+    //! (in-memory context other than the global one).
+    static bool scope(CefRefPtr<CefBrowser> browser, std::string& scope);
+
+    //! \brief Request context and URL of the request, key of m_vary.
+    static std::string base(std::string const& scope, CefRefPtr<CefRequest> request);
+
+    //! \brief Key of the request: its request context, its URL and the values
+    //! of the headers the responses to this URL vary on. Called with m_mutex
+    //! locked.
+    std::string key(std::string const& scope, CefRefPtr<CefRequest> request) const;
+
+private:
+
+    typedef std::list<std::pair<std::string, std::shared_ptr<const Response>>> Lru;
+
+    //! \brief Vary headers of the responses to a URL.
+    struct Vary
+    {
+        //! \brief Lower-case header names.
+        std::vector<std::string> names;
+        //! \brief Stored responses to the URL: forgotten once none is left.
+        size_t entries = 0u;
+    };
+
+    //! \brief Forget a stored response. Called with m_mutex locked.
+    void remove(Lru::iterator entry);
+
+    //! \brief Evict least recently used responses until under the cap.
+    //! Called with m_mutex locked.
+    void evict();
+
+    const size_t m_max_bytes;
+    mutable std::mutex m_mutex;
+    //! \brief Responses, most recently used first, and their index by key.
+    Lru m_lru;
+    std::unordered_map<std::string, Lru::iterator> m_index;
+    //! \brief Vary headers of stored responses, by request context and URL.
+    std::unordered_map<std::string, Vary> m_vary;
+    //! \brief Fetches in progress, by key.
+    std::unordered_map<std::string, CefRefPtr<Fetch>> m_fetches;
+    Stats m_stats;
+
+    IMPLEMENT_REFCOUNTING(ResponseCache);
+};
+
+#endif // RESPONSECACHE_HPP
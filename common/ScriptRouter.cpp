@@ -0,0 +1,180 @@
+// Scripts evaluated in pages by batches, with their results.
+
+#include "ScriptRouter.hpp"
+
+#include <cef_parser.h>
+
+#include <iostream>
+
+//! \brief Counters are printed at most this often.
+static const std::chrono::seconds LOG_PERIOD(1);
+
+//! \brief Batches not answered after this delay fail: the page had no
+//! JavaScript context yet, a script did not parse or the answer was lost.
+static const std::chrono::seconds BATCH_TIMEOUT(5);
+
+//------------------------------------------------------------------------------
+ScriptRouter& ScriptRouter::global()
+{
+    static ScriptRouter router;
+    return router;
+}
+
+//------------------------------------------------------------------------------
+CefMessageRouterConfig ScriptRouter::config()
+{
+    // Do not collide with the cefQuery() of pages using their own router
+    CefMessageRouterConfig config;
+    config.js_query_function = "offscreencefQuery";
+    config.js_cancel_function = "offscreencefQueryCancel";
+    return config;
+}
+
+//------------------------------------------------------------------------------
+ScriptRouter::ScriptRouter()
+    : m_last_log(std::chrono::steady_clock::now())
+{
+    m_router = CefMessageRouterBrowserSide::Create(config());
+    m_router->AddHandler(this, false);
+}
+
+//------------------------------------------------------------------------------
+void ScriptRouter::run(CefRefPtr<CefBrowser> browser, Scripts& scripts)
+{
+    if (scripts.empty())
+        return ;
+
+    const int id = m_next_batch++;
+    Batch& batch = m_batches[id];
+    batch.browser_id = browser->GetIdentifier();
+    batch.sent = std::chrono::steady_clock::now();
+
+    // Scripts are compiled with the batch, not given to eval(), which the
+    // Content-Security-Policy of the page may forbid. Results are converted
+    // to JSON one by one, so a throwing script does not fail the others, then
+    // sent back in one query.
+    std::string js = "(function(){var r=[];"
+                     "function f(g){try{var j=JSON.stringify(g());"
+                       "r.push('[true,'+(j===undefined?'null':j)+']');}"
+                     "catch(e){r.push('[false,'+JSON.stringify(String(e))+']');}}";
+    for (auto& script: scripts)
+    {
+        js += "f(function(){return (\n" + script.first + "\n);});";
+        batch.callbacks.push_back(std::move(script.second));
+    }
+    js += "window." + config().js_query_function.ToString() +
+          "({request:'{\"batch\":" + std::to_string(id) + ",\"results\":['+r.join(',')+']}',"
+          "onSuccess:function(){},onFailure:function(){}});})();";
+
+    CefRefPtr<CefFrame> frame = browser->GetMainFrame();
+    frame->ExecuteJavaScript(js, frame->GetURL(), 0);
+    m_scripts += batch.callbacks.size();
+}
+
+//------------------------------------------------------------------------------
+bool ScriptRouter::OnQuery(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> /*frame*/,
+                           int64_t /*query_id*/, const CefString& request,
+                           bool /*persistent*/,
+                           CefRefPtr<CefMessageRouterBrowserSide::Callback> callback)
+{
+    CefRefPtr<CefValue> value = CefParseJSON(request, JSON_PARSER_RFC);
+    if ((value == nullptr) || (value->GetType() != VTYPE_DICTIONARY))
+        return false;
+
+    CefRefPtr<CefDictionaryValue> answer = value->GetDictionary();
+    auto it = m_batches.find(answer->GetInt("batch"));
+    if ((it == m_batches.end()) || (it->second.browser_id != browser->GetIdentifier()))
+        return false;
+
+    // Take the batch out first: callbacks may queue new scripts
+    Batch batch = std::move(it->second);
+    m_batches.erase(it);
+    callback->Success("");
+
+    CefRefPtr<CefListValue> results = answer->GetList("results");
+    for (size_t i = 0u; i < batch.callbacks.size(); ++i)
+    {
+        CefRefPtr<CefListValue> result = (results != nullptr) && (i < results->GetSize())
+                                         ? results->GetList(i) : nullptr;
+        if ((result == nullptr) || (result->GetSize() != 2u))
+        {
+            batch.callbacks[i](nullptr, "no result");
+        }
+        else if (result->GetBool(0))
+        {
+            batch.callbacks[i](result->GetValue(1), std::string());
+        }
+        else
+        {
+            batch.callbacks[i](nullptr, result->GetString(1).ToString());
+        }
+    }
+
+    m_answered += batch.callbacks.size();
+    m_batches_answered += 1u;
+    m_round_trips += std::chrono::steady_clock::now() - batch.sent;
+    log();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void ScriptRouter::cancel(int browser_id, std::string const& reason)
+{
+    fail([browser_id](Batch const& batch) { return batch.browser_id == browser_id; },
+         reason);
+}
+
+//------------------------------------------------------------------------------
+void ScriptRouter::expire()
+{
+    const auto deadline = std::chrono::steady_clock::now() - BATCH_TIMEOUT;
+    fail([deadline](Batch const& batch) { return batch.sent < deadline; },
+         "timeout");
+}
+
+//------------------------------------------------------------------------------
+void ScriptRouter::fail(std::function<bool(Batch const&)> const& which,
+                        std::string const& reason)
+{
+    std::vector<Callback> failed;
+    for (auto it = m_batches.begin(); it != m_batches.end(); )
+    {
+        if (which(it->second))
+        {
+            for (auto& callback: it->second.callbacks)
+            {
+                failed.push_back(std::move(callback));
+            }
+            it = m_batches.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    for (auto& callback: failed)
+    {
+        callback(nullptr, reason);
+    }
+}
+
+//------------------------------------------------------------------------------
+void ScriptRouter::log()
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_last_log < LOG_PERIOD)
+        return ;
+
+    const double seconds = std::chrono::duration<double>(now - m_last_log).count();
+    std::cout << "Scripts: " << double(m_scripts) / seconds << " sent/s, "
+              << double(m_answered) / seconds << " answered/s, round trip "
+              << ((m_batches_answered == 0u) ? 0.0 : std::chrono::duration<double, std::milli>(
+                     m_round_trips).count() / double(m_batches_answered))
+              << " ms mean, " << m_batches.size() << " batches waiting" << std::endl;
+    m_scripts = 0u;
+    m_answered = 0u;
+    m_batches_answered = 0u;
+    m_round_trips = std::chrono::steady_clock::duration(0);
+    m_last_log = now;
+}
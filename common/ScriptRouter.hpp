@@ -0,0 +1,115 @@
+// Scripts evaluated in pages by batches, with their results.
+
+#ifndef SCRIPTROUTER_HPP
+#  define SCRIPTROUTER_HPP
+
+#  include <cef_browser.h>
+#  include <cef_values.h>
+#  include <wrapper/cef_message_router.h>
+
+#  include <chrono>
+#  include <cstdint>
+#  include <functional>
+#  include <string>
+#  include <unordered_map>
+#  include <utility>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Evaluate scripts in the main frame of pages and give their results
+//! back to the host as structured values, built on the CEF message router.
+//! All scripts queued for a browser during a frame are sent as a single
+//! ExecuteJavaScript() and their results come back in a single query: one
+//! IPC round trip per batch instead of one per script.
+//!
+//! Each script is a JavaScript expression, compiled with the batch rather
+//! than given to eval() so pages forbidding eval in their
+//! Content-Security-Policy still answer. Its value is converted to JSON then
+//! parsed by the host (functions and undefined give null). Exceptions and
+//! values that cannot be converted to JSON give an error instead. A script
+//! which does not parse prevents the whole batch from running: its scripts
+//! fail once the batch times out (see expire()).
+//!
+//! The browser process forwards client events to router(), render processes
+//! forward render process events to a CefMessageRouterRendererSide created
+//! with config() (see BrowserApp).
+// *****************************************************************************
+class ScriptRouter: public CefMessageRouterBrowserSide::Handler
+{
+public:
+
+    //! \brief Called with the result of a script, or with nullptr and the
+    //! error message if the script failed or the page went away.
+    typedef std::function<void(CefRefPtr<CefValue> result,
+                               std::string const& error)> Callback;
+
+    //! \brief Scripts and their callback, in evaluation order.
+    typedef std::vector<std::pair<std::string, Callback>> Scripts;
+
+    //! \brief Router of the browser process.
+    static ScriptRouter& global();
+
+    //! \brief Message router configuration, identical in all processes.
+    static CefMessageRouterConfig config();
+
+    ScriptRouter();
+
+    //! \brief Browser side router to give client events to.
+    inline CefRefPtr<CefMessageRouterBrowserSide> router() const
+    {
+        return m_router;
+    }
+
+    //! \brief Evaluate the scripts in the main frame of the browser, in
+    //! order, with a single IPC round trip.
+    void run(CefRefPtr<CefBrowser> browser, Scripts& scripts);
+
+    //! \brief Fail the scripts waiting for the results of the browser: page
+    //! unloaded, renderer crashed or browser closed.
+    void cancel(int browser_id, std::string const& reason);
+
+    //! \brief Fail the batches sent more than 5 seconds ago with the
+    //! "timeout" error, e.g. sent before the page had a JavaScript context.
+    //! Called once per frame.
+    void expire();
+
+    //! \brief Print evaluations per second and round trip times at most
+    //! once per second.
+    void log();
+
+private: // CefMessageRouterBrowserSide::Handler interfaces
+
+    //! \brief Results of a batch sent by the page.
+    virtual bool OnQuery(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
+                         int64_t query_id, const CefString& request, bool persistent,
+                         CefRefPtr<CefMessageRouterBrowserSide::Callback> callback) override;
+
+private:
+
+    // *************************************************************************
+    //! \brief Scripts sent and waiting for their results.
+    // *************************************************************************
+    struct Batch
+    {
+        int browser_id;
+        std::vector<ScriptRouter::Callback> callbacks;
+        std::chrono::steady_clock::time_point sent;
+    };
+
+    //! \brief Forget the selected batches and fail their scripts.
+    void fail(std::function<bool(Batch const&)> const& which,
+              std::string const& reason);
+
+    CefRefPtr<CefMessageRouterBrowserSide> m_router;
+    std::unordered_map<int, Batch> m_batches;
+    int m_next_batch = 1;
+
+    //! \brief Counters since the last log().
+    uint64_t m_scripts = 0u;
+    uint64_t m_answered = 0u;
+    uint64_t m_batches_answered = 0u;
+    std::chrono::steady_clock::duration m_round_trips{0};
+    std::chrono::steady_clock::time_point m_last_log;
+};
+
+#endif // SCRIPTROUTER_HPP
@@ -0,0 +1,207 @@
+// Ring of shared memory slots streaming binary frames to a render process.
+
+#include "SharedFeed.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#if defined(__linux__)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+//! \brief Tells a feed object from other shared memory.
+static const uint64_t MAGIC = 0x4445454643454f01ull;
+
+//! \brief Slots are aligned on this size so pages can view them with any
+//! typed array.
+static const size_t SLOT_ALIGNMENT = 64u;
+
+//! \brief Counters are printed at most this often.
+static const std::chrono::seconds LOG_PERIOD(1);
+
+//------------------------------------------------------------------------------
+static size_t align(size_t size)
+{
+    return (size + SLOT_ALIGNMENT - 1u) & ~(SLOT_ALIGNMENT - 1u);
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<SharedFeed> SharedFeed::create(size_t slots, size_t slot_size)
+{
+#if defined(__linux__)
+    if ((slots == 0u) || (slots > MAX_SLOTS) || (slot_size == 0u) || (slot_size > UINT32_MAX))
+        return nullptr;
+
+    static unsigned count = 0u;
+    const std::string name = "/offscreencef-" + std::to_string(::getpid()) + "-" +
+                             std::to_string(count++);
+    const size_t bytes = align(sizeof(Header)) + slots * align(slot_size);
+
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        std::fprintf(stderr, "Feed: cannot create %s\n", name.c_str());
+        return nullptr;
+    }
+    void* memory = MAP_FAILED;
+    if (::ftruncate(fd, off_t(bytes)) == 0)
+    {
+        memory = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        std::fprintf(stderr, "Feed: cannot map %zu bytes\n", bytes);
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    // Zero filled by ftruncate(): all slots are free
+    Header* header = static_cast<Header*>(memory);
+    header->slots = uint32_t(slots);
+    header->slot_size = uint32_t(slot_size);
+    header->magic = MAGIC;
+    return std::shared_ptr<SharedFeed>(new SharedFeed(name, memory, bytes, true));
+#else
+    (void) slots; (void) slot_size;
+    return nullptr;
+#endif
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<SharedFeed> SharedFeed::open(std::string const& name)
+{
+#if defined(__linux__)
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        std::fprintf(stderr, "Feed: cannot open %s\n", name.c_str());
+        return nullptr;
+    }
+
+    // The size is checked against the header: the host is trusted for its
+    // content only once mapped entirely.
+    struct stat st;
+    void* memory = MAP_FAILED;
+    if ((::fstat(fd, &st) == 0) && (size_t(st.st_size) >= sizeof(Header)))
+    {
+        memory = ::mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED)
+        return nullptr;
+
+    Header const* header = static_cast<Header const*>(memory);
+    if ((header->magic != MAGIC) || (header->slots == 0u) || (header->slots > MAX_SLOTS) ||
+        (align(sizeof(Header)) + header->slots * align(header->slot_size) > size_t(st.st_size)))
+    {
+        std::fprintf(stderr, "Feed: %s is not a valid feed\n", name.c_str());
+        ::munmap(memory, size_t(st.st_size));
+        return nullptr;
+    }
+    return std::shared_ptr<SharedFeed>(new SharedFeed(name, memory, size_t(st.st_size), false));
+#else
+    (void) name;
+    return nullptr;
+#endif
+}
+
+//------------------------------------------------------------------------------
+SharedFeed::SharedFeed(std::string const& name, void* memory, size_t bytes, bool owner)
+    : m_name(name), m_memory(memory), m_bytes(bytes), m_owner(owner),
+      m_header(static_cast<Header*>(memory)), m_slots(m_header->slots),
+      m_slot_size(m_header->slot_size), m_last_log(std::chrono::steady_clock::now())
+{}
+
+//------------------------------------------------------------------------------
+SharedFeed::~SharedFeed()
+{
+#if defined(__linux__)
+    ::munmap(m_memory, m_bytes);
+    if (m_owner)
+    {
+        ::shm_unlink(m_name.c_str());
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+char* SharedFeed::data(size_t slot) const
+{
+    return static_cast<char*>(m_memory) + align(sizeof(Header)) + slot * align(m_slot_size);
+}
+
+//------------------------------------------------------------------------------
+int SharedFeed::reserve()
+{
+    for (size_t i = 0u; i < m_slots; ++i)
+    {
+        const size_t slot = (m_next + i) % m_slots;
+        if (m_header->sizes[slot].load(std::memory_order_acquire) == 0u)
+        {
+            m_next = (slot + 1u) % m_slots;
+            return int(slot);
+        }
+    }
+    m_stats.dropped += 1u;
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+void SharedFeed::commit(size_t slot, size_t size)
+{
+    // An empty frame would look free: it takes one byte
+    size = std::max<size_t>(1u, std::min(size, m_slot_size));
+    m_header->sizes[slot].store(uint32_t(size), std::memory_order_release);
+    m_stats.frames += 1u;
+    m_stats.bytes += size;
+}
+
+//------------------------------------------------------------------------------
+size_t SharedFeed::size(size_t slot) const
+{
+    if (slot >= m_slots)
+        return 0u;
+    return std::min<size_t>(m_header->sizes[slot].load(std::memory_order_acquire), m_slot_size);
+}
+
+//------------------------------------------------------------------------------
+void SharedFeed::release(size_t slot)
+{
+    if (slot < m_slots)
+    {
+        m_header->sizes[slot].store(0u, std::memory_order_release);
+    }
+}
+
+//------------------------------------------------------------------------------
+void SharedFeed::reset()
+{
+    for (size_t slot = 0u; slot < m_slots; ++slot)
+    {
+        m_header->sizes[slot].store(0u, std::memory_order_release);
+    }
+}
+
+//------------------------------------------------------------------------------
+void SharedFeed::log(std::string const& who)
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_last_log < LOG_PERIOD)
+        return ;
+
+    const double seconds = std::chrono::duration<double>(now - m_last_log).count();
+    if ((m_stats.frames > 0u) || (m_stats.dropped > 0u))
+    {
+        std::printf("Feed %s: %g frames/s, %g MB/s, %llu dropped\n", who.c_str(),
+                    double(m_stats.frames) / seconds,
+                    double(m_stats.bytes) / seconds / 1048576.0,
+                    static_cast<unsigned long long>(m_stats.dropped));
+        std::fflush(stdout);
+    }
+    m_stats = Stats();
+    m_last_log = now;
+}
@@ -0,0 +1,125 @@
+// Ring of shared memory slots streaming binary frames to a render process.
+
+#ifndef SHAREDFEED_HPP
+#  define SHAREDFEED_HPP
+
+#  include <atomic>
+#  include <chrono>
+#  include <cstddef>
+#  include <cstdint>
+#  include <memory>
+#  include <string>
+
+// *****************************************************************************
+//! \brief Fixed size slots in a POSIX shared memory object mapped by the host
+//! and by a render process, so frames (i.e. sensor data) written by the host
+//! are given to pages as ArrayBuffers over the slots: no copy, no encoding.
+//!
+//! A slot is written by the host, handed to the page by commit() (the host
+//! then tells the page through MessageChannel), and given back by release()
+//! once the page no longer references it. When the page holds all slots,
+//! new frames are dropped.
+//!
+//! The render process opens the object by name: the renderer shall not be
+//! sandboxed.
+// *****************************************************************************
+class SharedFeed
+{
+public:
+
+    //! \brief Maximum number of slots.
+    static const size_t MAX_SLOTS = 64u;
+
+    // *************************************************************************
+    //! \brief Host counters since the last log().
+    // *************************************************************************
+    struct Stats
+    {
+        uint64_t frames = 0u;
+        uint64_t bytes = 0u;
+        //! \brief Frames not written: all slots held by the page.
+        uint64_t dropped = 0u;
+    };
+
+    //! \brief Create a feed of \c slots buffers of \c slot_size bytes (host
+    //! side). \return nullptr on failure.
+    static std::shared_ptr<SharedFeed> create(size_t slots, size_t slot_size);
+
+    //! \brief Map the feed created by the host (render process side).
+    //! \return nullptr on failure.
+    static std::shared_ptr<SharedFeed> open(std::string const& name);
+
+    //! \brief Unmap the feed. The host also removes its name.
+    ~SharedFeed();
+
+    //! \brief Name of the shared memory object, given to open().
+    inline std::string const& name() const
+    {
+        return m_name;
+    }
+
+    inline size_t slots() const
+    {
+        return m_slots;
+    }
+
+    inline size_t slotSize() const
+    {
+        return m_slot_size;
+    }
+
+    //! \brief Memory of the slot.
+    char* data(size_t slot) const;
+
+    //! \brief Host side: index of a slot free to be written in place, -1 if
+    //! all are held by the page (the frame is counted as dropped).
+    int reserve();
+
+    //! \brief Host side: hand the written slot to the page.
+    void commit(size_t slot, size_t size);
+
+    //! \brief Render process side: size of a committed slot, 0 if the slot
+    //! is not committed or invalid.
+    size_t size(size_t slot) const;
+
+    //! \brief Give the slot back to the host. Called by the render process,
+    //! or by the host for slots the page told it to release.
+    void release(size_t slot);
+
+    //! \brief Host side: give all slots back, when the page that held them
+    //! went away or subscribes again.
+    void reset();
+
+    //! \brief Print frames and MB per second at most once per second.
+    void log(std::string const& who);
+
+private:
+
+    //! \brief Beginning of the shared memory object.
+    struct Header
+    {
+        uint64_t magic;
+        uint32_t slots;
+        uint32_t slot_size;
+        //! \brief Committed size of each slot, 0 when free.
+        std::atomic<uint32_t> sizes[MAX_SLOTS];
+    };
+
+    SharedFeed(std::string const& name, void* memory, size_t bytes, bool owner);
+
+private:
+
+    std::string m_name;
+    void* m_memory;
+    size_t m_bytes;
+    bool m_owner;
+    Header* m_header;
+    size_t m_slots;
+    size_t m_slot_size;
+    //! \brief Next slot tried by reserve().
+    size_t m_next = 0u;
+    Stats m_stats;
+    std::chrono::steady_clock::time_point m_last_log;
+};
+
+#endif // SHAREDFEED_HPP
@@ -0,0 +1,111 @@
+// Lock-free single-producer single-consumer ring buffer shared by the
+// OffScreenCEF examples.
+
+#ifndef SPSCRING_HPP
+#  define SPSCRING_HPP
+
+#  include <atomic>
+#  include <vector>
+#  include <cstddef>
+#  include <cstring>
+#  include <algorithm>
+#  include <type_traits>
+
+// *****************************************************************************
+//! \brief Fixed size ring buffer where exactly one thread pushes and exactly
+//! one other thread pops. No lock is taken: the producer only writes m_head
+//! and the consumer only writes m_tail. This is what CEF audio threads and
+//! the SDL audio callback need: none of them shall ever block on the other.
+//! \tparam T trivially copyable element (i.e. float samples).
+// *****************************************************************************
+template<typename T>
+class SpscRing
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SpscRing elements are copied with memcpy");
+
+public:
+
+    //! \brief Allocate the ring. The capacity is rounded up to the next power
+    //! of two so indices can be wrapped with a mask.
+    explicit SpscRing(size_t capacity)
+    {
+        size_t size = 1u;
+        while (size < capacity)
+            size <<= 1u;
+        m_buffer.resize(size);
+        m_mask = size - 1u;
+    }
+
+    //! \brief Maximum number of elements the ring can hold.
+    inline size_t capacity() const
+    {
+        return m_buffer.size();
+    }
+
+    //! \brief Number of elements ready to be popped. Exact when called from
+    //! the consumer, a lower bound when called from the producer.
+    inline size_t size() const
+    {
+        return m_head.load(std::memory_order_acquire) -
+               m_tail.load(std::memory_order_acquire);
+    }
+
+    //! \brief Producer side: copy up to \c count elements.
+    //! \return the number of elements really written (less than \c count
+    //! when the ring is full).
+    size_t push(T const* data, size_t count)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        count = std::min(count, capacity() - (head - tail));
+        write(head, data, count);
+        m_head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    //! \brief Consumer side: copy up to \c count elements.
+    //! \return the number of elements really read (less than \c count when
+    //! the ring is starving).
+    size_t pop(T* data, size_t count)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        count = std::min(count, head - tail);
+        read(tail, data, count);
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+
+    //! \brief Copy a linear buffer into the ring (in two parts when wrapping).
+    void write(size_t index, T const* src, size_t count)
+    {
+        const size_t first = std::min(count, capacity() - (index & m_mask));
+        std::memcpy(&m_buffer[index & m_mask], src, first * sizeof(T));
+        std::memcpy(&m_buffer[0], src + first, (count - first) * sizeof(T));
+    }
+
+    //! \brief Copy the ring (in two parts when wrapping) into a linear buffer.
+    void read(size_t index, T* dst, size_t count) const
+    {
+        const size_t first = std::min(count, capacity() - (index & m_mask));
+        std::memcpy(dst, &m_buffer[index & m_mask], first * sizeof(T));
+        std::memcpy(dst + first, &m_buffer[0], (count - first) * sizeof(T));
+    }
+
+private:
+
+    //! \brief Storage (power of two elements).
+    std::vector<T> m_buffer;
+    size_t m_mask = 0u;
+
+    //! \brief Written by the producer. Own cache line to avoid false sharing
+    //! with the consumer index.
+    alignas(64) std::atomic<size_t> m_head{0u};
+    //! \brief Written by the consumer.
+    alignas(64) std::atomic<size_t> m_tail{0u};
+};
+
+#endif // SPSCRING_HPP
@@ -0,0 +1,73 @@
+// Timestamps of the startup of browsers and of their subprocesses.
+
+#include "StartupTrace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#  include <fcntl.h>
+#  include <time.h>
+#  include <unistd.h>
+#endif
+
+//! \brief Environment variable naming the trace file.
+static const char* TRACE_ENV = "OFFSCREENCEF_STARTUP_TRACE";
+
+#if defined(__linux__)
+//! \brief Trace file of the process, opened by the first mark().
+static int s_fd = -1;
+#endif
+
+//------------------------------------------------------------------------------
+bool StartupTrace::enabled()
+{
+    return std::getenv(TRACE_ENV) != nullptr;
+}
+
+//------------------------------------------------------------------------------
+const char* StartupTrace::type(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strncmp(argv[i], "--type=", 7u) == 0)
+            return argv[i] + 7;
+    }
+    return "browser";
+}
+
+//------------------------------------------------------------------------------
+void StartupTrace::mark(const char* type, const char* event)
+{
+#if defined(__linux__)
+    if (s_fd < 0)
+    {
+        const char* path = std::getenv(TRACE_ENV);
+        if (path == nullptr)
+            return ;
+        s_fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (s_fd < 0)
+            return ;
+    }
+
+    struct timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+
+    // A single write() of a short line: lines of concurrent processes do not
+    // interleave with O_APPEND.
+    char line[160];
+    const int size = std::snprintf(line, sizeof(line), "%lld %d %s %s\n",
+                                   (long long) now.tv_sec * 1000000000LL + now.tv_nsec,
+                                   int(::getpid()), type, event);
+    if (size > 0)
+    {
+        const ssize_t written = ::write(s_fd, line, std::min(size_t(size), sizeof(line) - 1u));
+        (void) written;
+    }
+#else
+    (void) type;
+    (void) event;
+#endif
+}
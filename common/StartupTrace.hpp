@@ -0,0 +1,35 @@
+// Timestamps of the startup of browsers and of their subprocesses.
+
+#ifndef STARTUPTRACE_HPP
+#  define STARTUPTRACE_HPP
+
+// *****************************************************************************
+//! \brief Append startup events of the browser process and of its
+//! subprocesses to a shared trace file, one line per event:
+//!   <CLOCK_MONOTONIC ns> <pid> <process type> <event>
+//! CLOCK_MONOTONIC is shared by all processes so lines of different
+//! processes can be compared (see tools/startup_benchmark.sh).
+//!
+//! Tracing is enabled by the OFFSCREENCEF_STARTUP_TRACE environment variable
+//! naming the trace file (subprocesses inherit it). Callable before CEF is
+//! initialized: no allocation, no iostream, no static initializer. The file
+//! is opened by the first event of the process and kept opened, so render
+//! processes forked from the zygote keep writing in it once sandboxed.
+// *****************************************************************************
+class StartupTrace
+{
+public:
+
+    //! \brief Append the event of the given process type ("browser",
+    //! "renderer", "gpu-process" ...). Does nothing when tracing is disabled.
+    static void mark(const char* type, const char* event);
+
+    //! \brief Process type given by --type= on the command line, "browser"
+    //! without it.
+    static const char* type(int argc, char* argv[]);
+
+    //! \brief Return true if OFFSCREENCEF_STARTUP_TRACE is set.
+    static bool enabled();
+};
+
+#endif // STARTUPTRACE_HPP
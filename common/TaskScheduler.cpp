@@ -0,0 +1,176 @@
+// Work-stealing thread pool running CPU parallel work on frames.
+
+#include "TaskScheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+//! \brief Scheduler and queue index of the calling thread when it is a worker.
+static thread_local TaskScheduler const* t_scheduler = nullptr;
+static thread_local size_t t_queue = 0u;
+
+//------------------------------------------------------------------------------
+unsigned TaskScheduler::defaultWorkers()
+{
+    return std::max(1u, std::thread::hardware_concurrency()) - 1u;
+}
+
+//------------------------------------------------------------------------------
+TaskScheduler& TaskScheduler::global()
+{
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+//------------------------------------------------------------------------------
+TaskScheduler::TaskScheduler(unsigned workers)
+{
+    // Without workers, tasks are run by the waiting thread
+    const size_t queues = std::max(1u, workers);
+    for (size_t i = 0u; i < queues; ++i)
+    {
+        m_queues.emplace_back(new Queue);
+    }
+
+    for (unsigned i = 0u; i < workers; ++i)
+    {
+        m_threads.emplace_back(&TaskScheduler::loop, this, size_t(i));
+    }
+}
+
+//------------------------------------------------------------------------------
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_quit = true;
+    }
+    m_sleep.notify_all();
+    for (auto& it: m_threads)
+    {
+        it.join();
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t TaskScheduler::queueIndex()
+{
+    if (t_scheduler == this)
+        return t_queue;
+    return m_next++ % m_queues.size();
+}
+
+//------------------------------------------------------------------------------
+void TaskScheduler::submit(TaskGroup& group, Task task)
+{
+    ++group.m_pending;
+
+    Queue& queue = *m_queues[queueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.items.push_back(Item{ std::move(task), &group });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        ++m_queued;
+    }
+    m_sleep.notify_one();
+}
+
+//------------------------------------------------------------------------------
+bool TaskScheduler::pop(size_t index, Item& item)
+{
+    // Newest task of its own queue (its data is likely still in cache), else
+    // the oldest task of the other queues.
+    bool found = false;
+    for (size_t i = 0u; (i < m_queues.size()) && !found; ++i)
+    {
+        Queue& queue = *m_queues[(index + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.items.empty())
+            continue;
+
+        if (i == 0u)
+        {
+            item = std::move(queue.items.back());
+            queue.items.pop_back();
+        }
+        else
+        {
+            item = std::move(queue.items.front());
+            queue.items.pop_front();
+        }
+        found = true;
+    }
+
+    if (found)
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        --m_queued;
+    }
+    return found;
+}
+
+//------------------------------------------------------------------------------
+void TaskScheduler::run(Item& item)
+{
+    item.task();
+    item.task = nullptr;
+
+    // Decremented under the lock: wait() takes it before returning so the
+    // group is not destroyed while being notified.
+    TaskGroup& group = *item.group;
+    std::lock_guard<std::mutex> lock(group.m_mutex);
+    if (--group.m_pending == 0u)
+    {
+        group.m_done.notify_all();
+    }
+}
+
+//------------------------------------------------------------------------------
+void TaskScheduler::loop(size_t index)
+{
+    t_scheduler = this;
+    t_queue = index;
+
+    Item item;
+    for (;;)
+    {
+        if (pop(index, item))
+        {
+            run(item);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_sleep.wait(lock, [this] { return m_quit || (m_queued > 0u); });
+        if (m_quit && (m_queued == 0u))
+            return ;
+    }
+}
+
+//------------------------------------------------------------------------------
+void TaskScheduler::wait(TaskGroup& group)
+{
+    const size_t index = queueIndex();
+
+    Item item;
+    while (group.m_pending > 0u)
+    {
+        if (pop(index, item))
+        {
+            run(item);
+            continue;
+        }
+
+        // Remaining tasks are running on workers. They may queue new tasks so
+        // do not sleep for long.
+        std::unique_lock<std::mutex> lock(group.m_mutex);
+        group.m_done.wait_for(lock, std::chrono::microseconds(200),
+                              [&group] { return group.m_pending == 0u; });
+    }
+
+    // The last task released the group
+    std::lock_guard<std::mutex> lock(group.m_mutex);
+}
@@ -0,0 +1,119 @@
+// Work-stealing thread pool running CPU parallel work on frames.
+
+#ifndef TASKSCHEDULER_HPP
+#  define TASKSCHEDULER_HPP
+
+#  include <atomic>
+#  include <condition_variable>
+#  include <cstddef>
+#  include <deque>
+#  include <functional>
+#  include <memory>
+#  include <mutex>
+#  include <thread>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Set of tasks the caller waits for. A group can be reused once
+//! TaskScheduler::wait() returned.
+// *****************************************************************************
+class TaskGroup
+{
+private:
+
+    friend class TaskScheduler;
+
+    //! \brief Tasks submitted and not yet finished.
+    std::atomic<size_t> m_pending{0u};
+    std::mutex m_mutex;
+    std::condition_variable m_done;
+};
+
+// *****************************************************************************
+//! \brief Fixed set of worker threads, each with its own task queue. Workers
+//! pop their newest task and steal the oldest tasks of the other queues when
+//! theirs is empty, so tasks submitted by a worker stay on the same core while
+//! others balance the load. Threads waiting for a group run queued tasks too,
+//! so waiting from inside a task never deadlocks.
+// *****************************************************************************
+class TaskScheduler
+{
+public:
+
+    typedef std::function<void()> Task;
+
+    //! \brief Start \c workers threads. By default one less than the number of
+    //! cores: the thread waiting for tasks also runs them.
+    explicit TaskScheduler(unsigned workers = defaultWorkers());
+
+    //! \brief Finish queued tasks and stop threads.
+    ~TaskScheduler();
+
+    //! \brief Scheduler shared by the whole application, started on first use.
+    static TaskScheduler& global();
+
+    //! \brief One less than the number of cores.
+    static unsigned defaultWorkers();
+
+    //! \brief Number of threads running tasks when a thread waits for them.
+    inline unsigned concurrency() const
+    {
+        return unsigned(m_threads.size()) + 1u;
+    }
+
+    //! \brief Queue a task of the group.
+    void submit(TaskGroup& group, Task task);
+
+    //! \brief Run queued tasks until all tasks of the group are done.
+    void wait(TaskGroup& group);
+
+private:
+
+    // *************************************************************************
+    //! \brief Queued task and the group to notify when done.
+    // *************************************************************************
+    struct Item
+    {
+        Task task;
+        TaskGroup* group;
+    };
+
+    // *************************************************************************
+    //! \brief Task queue of a worker.
+    // *************************************************************************
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Item> items;
+    };
+
+    //! \brief Worker main loop.
+    void loop(size_t index);
+
+    //! \brief Take the newest task of the queue \c index, else steal the
+    //! oldest task of another queue.
+    bool pop(size_t index, Item& item);
+
+    //! \brief Run a task and notify its group.
+    void run(Item& item);
+
+    //! \brief Queue of the calling thread if it is a worker, else the next
+    //! queue in round robin.
+    size_t queueIndex();
+
+private:
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    //! \brief Round robin for tasks submitted by non worker threads.
+    std::atomic<size_t> m_next{0u};
+
+    //! \brief Idle workers sleep until tasks are queued.
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_sleep;
+    size_t m_queued = 0u;
+    bool m_quit = false;
+};
+
+#endif // TASKSCHEDULER_HPP
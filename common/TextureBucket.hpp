@@ -0,0 +1,48 @@
+// Size policy shared by the SDL and OpenGL texture pools of the OffScreenCEF
+// examples.
+
+#ifndef TEXTUREBUCKET_HPP
+#  define TEXTUREBUCKET_HPP
+
+#  include <algorithm>
+
+// *****************************************************************************
+//! \brief Decide the dimension of textures holding web pages. Textures are
+//! over-allocated by steps so that a window resized by dragging its edge keeps
+//! rendering into a sub-rectangle of the same texture instead of reallocating
+//! one texture for every intermediate size.
+// *****************************************************************************
+class TextureBucket
+{
+public:
+
+    //! \brief Granularity of allocated dimensions (in pixels).
+    static const int STEP = 256;
+
+    //! \brief Dimension to allocate for a page of \c size pixels: rounded up
+    //! to the step plus one step of headroom for growing. \c max_size is the
+    //! texture limit of the renderer (0 if unlimited).
+    static inline int allocation(int size, int max_size)
+    {
+        const int bucket = ((std::max(size, 1) + STEP - 1) / STEP + 1) * STEP;
+        return (max_size > 0) ? std::min(bucket, max_size) : bucket;
+    }
+
+    //! \brief Return true if a texture dimension of \c allocated pixels can
+    //! hold \c size pixels without wasting more than two steps. The gap
+    //! between allocation() and this limit is the hysteresis that prevents
+    //! reallocating back and forth around a bucket boundary.
+    static inline bool fits(int size, int allocated)
+    {
+        return (size <= allocated) && (allocated - size < 3 * STEP);
+    }
+
+    //! \brief Two dimensional version of fits().
+    static inline bool fits(int width, int height, int allocated_width,
+                            int allocated_height)
+    {
+        return fits(width, allocated_width) && fits(height, allocated_height);
+    }
+};
+
+#endif // TEXTUREBUCKET_HPP
@@ -132,13 +132,14 @@ fi
 #if  [ ! -e "$BUILD_PATH/cefsimple_opengl" ]; then
     msg "Compile OpenGL demo"
     (cd cefsimple_opengl
-     g++ --std=c++14 -W -Wall -Wextra -Wno-unused-parameter \
+     g++ --std=c++14 -W -Wall -Wextra -Wno-unused-parameter -pthread \
          -DCHECK_OPENGL -DCEF_USE_SANDBOX -DNDEBUG \
          -D_FILE_OFFSET_BITS=64 -D__STDC_CONSTANT_MACROS \
-         -D__STDC_FORMAT_MACROS -I$CEF_PATH -I$CEF_PATH/include *.cpp \
+         -D__STDC_FORMAT_MACROS -I$CEF_PATH -I$CEF_PATH/include -I../common \
+         *.cpp ../common/*.cpp \
          -o $BUILD_PATH/cefsimple_opengl $BUILD_PATH/libcef.so \
          $CEF_PATH/build/libcef_dll_wrapper/libcef_dll_wrapper.a \
-         `pkg-config --cflags --libs glew --static glfw3`
+         `pkg-config --cflags --libs glew egl --static glfw3`
      cp --verbose -R shaders $BUILD_PATH
     )
 #fi
@@ -150,7 +151,9 @@ fi
      g++ --std=c++14 -W -Wall -Wextra -Wno-unused-parameter \
          -DCEF_USE_SANDBOX -DNDEBUG -D_FILE_OFFSET_BITS=64 \
          -D__STDC_CONSTANT_MACROS -D__STDC_FORMAT_MACROS \
-         -I$CEF_PATH -I$CEF_PATH/include sdl_cef_events.cpp main.cpp \
+         -I$CEF_PATH -I$CEF_PATH/include -I../common \
+         sdl_cef_events.cpp sdl_cef_audio.cpp sdl_texture_pool.cpp main.cpp \
+         ../common/*.cpp \
          -o $BUILD_PATH/cefsimple_sdl $BUILD_PATH/libcef.so \
          $CEF_PATH/build/libcef_dll_wrapper/libcef_dll_wrapper.a \
          `pkg-config --cflags --libs sdl2 SDL2_image`
@@ -165,7 +168,9 @@ fi
          -DCEF_USE_SANDBOX -DNDEBUG -D_FILE_OFFSET_BITS=64 \
          -D__STDC_CONSTANT_MACROS -D__STDC_FORMAT_MACROS \
          -DSECONDARY_PATH=\"$BUILD_PATH/secondary_process\" \
-         -I$CEF_PATH -I$CEF_PATH/include main.cpp \
+         -I$CEF_PATH -I$CEF_PATH/include -I../../common -I../../cefsimple_sdl \
+         main.cpp ../../cefsimple_sdl/sdl_cef_audio.cpp \
+         ../../cefsimple_sdl/sdl_texture_pool.cpp ../../common/*.cpp \
          -o $BUILD_PATH/primary_process $BUILD_PATH/libcef.so \
          $CEF_PATH/build/libcef_dll_wrapper/libcef_dll_wrapper.a \
          `pkg-config --cflags --libs sdl2 SDL2_image`
@@ -178,12 +183,31 @@ fi
     (cd cefsimple_separate/secondary
      g++ --std=c++14 -W -Wall -Wextra -Wno-unused-parameter -DCEF_USE_SANDBOX \
          -DNDEBUG -D_FILE_OFFSET_BITS=64 -D__STDC_CONSTANT_MACROS \
-         -D__STDC_FORMAT_MACROS -I$CEF_PATH -I$CEF_PATH/include \
-         *.cpp -o $BUILD_PATH/secondary_process $BUILD_PATH/libcef.so \
+         -D__STDC_FORMAT_MACROS -I$CEF_PATH -I$CEF_PATH/include -I../../common \
+         *.cpp ../../common/PerformanceProfile.cpp ../../common/MessageChannel.cpp \
+         ../../common/SharedFeed.cpp ../../common/StartupTrace.cpp \
+         ../../common/ProcessPlacement.cpp \
+         -o $BUILD_PATH/secondary_process $BUILD_PATH/libcef.so \
          $CEF_PATH/build/libcef_dll_wrapper/libcef_dll_wrapper.a
     )
 #fi
 
+### Compile the asset packer (app:// bundles)
+msg "Compile asset packer"
+(cd tools
+ g++ --std=c++14 -W -Wall -Wextra -O2 -I../common \
+     asset_packer.cpp ../common/AssetBundle.cpp \
+     -o $BUILD_PATH/asset_packer -lz
+)
+
+### Compile the frame copy benchmark
+msg "Compile frame copy benchmark"
+(cd tools
+ g++ --std=c++14 -W -Wall -Wextra -O2 -I../common \
+     frame_copy_benchmark.cpp ../common/FrameCopy.cpp ../common/TaskScheduler.cpp \
+     -o $BUILD_PATH/frame_copy_benchmark -pthread
+)
+
 ### Outro message
 msg "Compilation done with success! Be sure to be inside $BUILD_PATH and run one of the following applications:"
 msg "  ./secondary_process"
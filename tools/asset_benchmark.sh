@@ -0,0 +1,18 @@
+#!/bin/bash -e
+### Compare loading a local page with file:// and with app:// served from an
+### asset bundle: raw read time of the assets, then time to first paint.
+### Usage: tools/asset_benchmark.sh <directory with index.html> [build directory]
+
+source `dirname "$0"`/benchmark_common.sh
+
+DIR=`realpath "${1:?Usage: $0 <directory with index.html> [build directory]}"`
+BUILD=`realpath "${2:-build}"`
+BUNDLE=`mktemp --suffix=.bundle`
+trap "rm -f $BUNDLE" EXIT
+
+"$BUILD/asset_packer" "$DIR" $BUNDLE
+"$BUILD/asset_packer" --bench "$DIR" $BUNDLE
+
+### The memory cache mode avoids measuring a warm disk cache
+first_paint "file://" --cache-mode=memory --url="file://$DIR/index.html"
+first_paint "app://" --cache-mode=memory --url="app://bundle/index.html" --app-bundle=$BUNDLE
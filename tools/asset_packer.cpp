@@ -0,0 +1,267 @@
+// Pack a directory of application assets into an AssetBundle file served as
+// app:// URLs, and compare reading them from the bundle and from files.
+//
+// Compile:
+//   g++ --std=c++14 -O2 -I../common asset_packer.cpp ../common/AssetBundle.cpp -lz -o asset_packer
+// Usage:
+//   asset_packer <directory> <output.bundle>
+//   asset_packer --bench <directory> <bundle>
+
+#include "AssetBundle.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <zlib.h>
+
+//! \brief Assets smaller than this are not compressed.
+static const size_t MIN_GZIP_SIZE = 256u;
+
+//! \brief Compressed contents are kept if they save at least this ratio.
+static const double MIN_GZIP_SAVING = 0.1;
+
+//! \brief Number of times the benchmark reads all assets.
+static const int BENCH_ROUNDS = 100;
+
+//! \brief Files found by nftw() (which has no user data).
+static std::vector<std::string> s_files;
+
+// *****************************************************************************
+//! \brief Asset being packed.
+// *****************************************************************************
+struct File
+{
+    std::string path;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> gzip;
+    uint64_t hash;
+};
+
+//------------------------------------------------------------------------------
+static int addFile(const char* path, const struct stat*, int type, struct FTW*)
+{
+    if (type == FTW_F)
+    {
+        s_files.push_back(path);
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<std::string> listFiles(std::string const& directory)
+{
+    s_files.clear();
+    nftw(directory.c_str(), addFile, 16, FTW_PHYS);
+    std::sort(s_files.begin(), s_files.end());
+    return s_files;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<uint8_t> readFile(std::string const& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+}
+
+//------------------------------------------------------------------------------
+//! \brief Compress with the gzip format understood by browsers.
+//------------------------------------------------------------------------------
+static std::vector<uint8_t> gzip(std::vector<uint8_t> const& data)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        return {};
+
+    std::vector<uint8_t> out(deflateBound(&stream, uLong(data.size())));
+    stream.next_in = const_cast<Bytef*>(data.data());
+    stream.avail_in = uInt(data.size());
+    stream.next_out = out.data();
+    stream.avail_out = uInt(out.size());
+    const int res = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return (res == Z_STREAM_END) ? out : std::vector<uint8_t>();
+}
+
+//------------------------------------------------------------------------------
+static int pack(std::string directory, std::string const& output)
+{
+    while ((directory.size() > 1u) && (directory.back() == '/'))
+    {
+        directory.pop_back();
+    }
+
+    std::vector<File> files;
+    for (auto const& filename: listFiles(directory))
+    {
+        File file;
+        file.path = filename.substr(directory.size() + 1u);
+        file.data = readFile(filename);
+        file.hash = AssetBundle::hash(file.path.c_str(), file.path.size());
+        if (file.data.size() >= MIN_GZIP_SIZE)
+        {
+            file.gzip = gzip(file.data);
+            if (double(file.gzip.size()) > double(file.data.size()) * (1.0 - MIN_GZIP_SAVING))
+            {
+                file.gzip.clear();
+            }
+        }
+        files.push_back(std::move(file));
+    }
+    std::stable_sort(files.begin(), files.end(), [](File const& a, File const& b)
+                     {
+                         return a.hash < b.hash;
+                     });
+
+    // Index first, then paths and contents in the same order
+    AssetBundle::Header header;
+    std::memcpy(header.magic, "OCEFPACK", 8u);
+    header.version = AssetBundle::VERSION;
+    header.count = uint32_t(files.size());
+
+    std::vector<AssetBundle::Entry> entries(files.size());
+    uint64_t offset = sizeof(header) + entries.size() * sizeof(AssetBundle::Entry);
+    size_t bytes = 0u, compressed = 0u;
+    for (size_t i = 0u; i < files.size(); ++i)
+    {
+        AssetBundle::Entry& e = entries[i];
+        std::memset(&e, 0, sizeof(e));
+        e.hash = files[i].hash;
+        e.path = offset;
+        e.path_size = uint32_t(files[i].path.size());
+        offset += e.path_size;
+        e.data = offset;
+        e.data_size = uint32_t(files[i].data.size());
+        offset += e.data_size;
+        if (!files[i].gzip.empty())
+        {
+            e.gzip = offset;
+            e.gzip_size = uint32_t(files[i].gzip.size());
+            offset += e.gzip_size;
+            compressed += e.gzip_size;
+        }
+        else
+        {
+            compressed += e.data_size;
+        }
+        bytes += e.data_size;
+    }
+
+    std::ofstream out(output, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()),
+              std::streamsize(entries.size() * sizeof(AssetBundle::Entry)));
+    for (auto const& file: files)
+    {
+        out.write(file.path.data(), std::streamsize(file.path.size()));
+        out.write(reinterpret_cast<const char*>(file.data.data()), std::streamsize(file.data.size()));
+        out.write(reinterpret_cast<const char*>(file.gzip.data()), std::streamsize(file.gzip.size()));
+    }
+    if (!out)
+    {
+        std::cerr << "Cannot write '" << output << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Packed " << files.size() << " assets of " << directory << " in "
+              << output << ": " << bytes / 1024u << " KB, " << compressed / 1024u
+              << " KB when compressed" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Read all assets of the directory from files then from the bundle.
+//------------------------------------------------------------------------------
+static int bench(std::string directory, std::string const& bundle_name)
+{
+    while ((directory.size() > 1u) && (directory.back() == '/'))
+    {
+        directory.pop_back();
+    }
+
+    AssetBundle bundle;
+    if (!bundle.open(bundle_name))
+        return EXIT_FAILURE;
+
+    const std::vector<std::string> files = listFiles(directory);
+    std::vector<std::string> paths;
+    for (auto const& filename: files)
+    {
+        paths.push_back(filename.substr(directory.size() + 1u));
+    }
+
+    // Like a file:// loader: open, read in chunks into a buffer, close
+    std::vector<char> buffer(64u * 1024u);
+    size_t checksum = 0u;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < BENCH_ROUNDS; ++round)
+    {
+        for (auto const& filename: files)
+        {
+            int fd = open(filename.c_str(), O_RDONLY);
+            ssize_t n;
+            while ((n = read(fd, buffer.data(), buffer.size())) > 0)
+            {
+                checksum += size_t(buffer[0]);
+            }
+            close(fd);
+        }
+    }
+    const double files_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    // Like the app:// handler: look up then copy into the buffer of CEF
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < BENCH_ROUNDS; ++round)
+    {
+        for (auto const& path: paths)
+        {
+            AssetBundle::Asset asset;
+            if (!bundle.find(path.c_str(), path.size(), false, asset))
+            {
+                std::cerr << path << " not found in the bundle" << std::endl;
+                return EXIT_FAILURE;
+            }
+            for (size_t offset = 0u; offset < asset.size; offset += buffer.size())
+            {
+                const size_t n = std::min(buffer.size(), asset.size - offset);
+                std::memcpy(buffer.data(), asset.data + offset, n);
+                checksum += size_t(buffer[0]);
+            }
+        }
+    }
+    const double bundle_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    const double reads = double(BENCH_ROUNDS) * double(files.size());
+    std::cout << "Read " << files.size() << " assets " << BENCH_ROUNDS << " times:"
+              << " files " << files_ms * 1000.0 / reads << " us/asset,"
+              << " bundle " << bundle_ms * 1000.0 / reads << " us/asset"
+              << " (checksum " << checksum << ")" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    if ((argc == 4) && (std::string(argv[1]) == "--bench"))
+        return bench(argv[2], argv[3]);
+    if (argc == 3)
+        return pack(argv[1], argv[2]);
+
+    std::cerr << "Usage: " << argv[0] << " <directory> <output.bundle>" << std::endl
+              << "       " << argv[0] << " --bench <directory> <bundle>" << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,14 @@
+### Helpers shared by the benchmark scripts, to source after setting BUILD
+### (directory holding the application) and optionally APP (application
+### name, default cefsimple_opengl).
+
+### Run the application until all views have painted once and print the time
+### to first paint of each view and the response cache counters.
+### Usage: first_paint <title> [switches ...]
+function first_paint
+{
+    echo "*** $1"
+    (cd "$BUILD"
+     "./${APP:-cefsimple_opengl}" --benchmark-first-paint "${@:2}" 2>/dev/null \
+         | grep -E "first paint|Benchmark:|Response cache:")
+}
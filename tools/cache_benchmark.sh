@@ -0,0 +1,22 @@
+#!/bin/bash -e
+### Compare the time to first paint of browser views with a cold cache (empty
+### cache directory) and a warm cache (second run on the same directory).
+### Usage: tools/cache_benchmark.sh [application] [extra switches ...]
+
+source `dirname "$0"`/benchmark_common.sh
+
+APP_PATH=${1:-build/cefsimple_opengl}
+shift || true
+
+if [ ! -x "$APP_PATH" ]; then
+    echo "$APP_PATH: not found, compile it with install.sh first"
+    exit 1
+fi
+BUILD=`dirname "$APP_PATH"`
+APP=`basename "$APP_PATH"`
+
+CACHE_DIR=`mktemp -d`
+trap "rm -fr $CACHE_DIR" EXIT
+
+first_paint "Cold start" --cache-dir=$CACHE_DIR "$@"
+first_paint "Warm start" --cache-dir=$CACHE_DIR "$@"
@@ -0,0 +1,45 @@
+#!/bin/bash -e
+### Push telemetry from a page to the host of the separate process demo
+### through window.blu, with small batched messages then large shared memory
+### ones, and print the throughput measured by both ends.
+### Usage: tools/channel_benchmark.sh [build directory] [seconds per test]
+
+BUILD=`realpath "${1:-build}"`
+SECONDS_PER_TEST=${2:-10}
+PAGE=`mktemp -d`
+trap 'rm -fr $PAGE' EXIT
+
+cat > $PAGE/index.html <<HTML
+<html><body><h1>Message channel</h1><script>
+// Each frame: 'count' messages of 'size' bytes on "telemetry", and one echo
+// to measure the round trip.
+function run(size, count) {
+    const data = new ArrayBuffer(size);
+    let sent = 0, echoes = 0, rtt = 0, start = performance.now();
+    blu.on("echo", (payload) => { echoes++; rtt += performance.now() - Number(payload); });
+    function frame() {
+        for (let i = 0; i < count; i++) { blu.send("telemetry", data); }
+        blu.send("echo", String(performance.now()));
+        sent += size * count;
+        const elapsed = (performance.now() - start) / 1000;
+        if (elapsed > 1) {
+            console.log("page: " + (sent / elapsed / 1048576).toFixed(1) + " MB/s of "
+                        + size + " B messages, echo "
+                        + (echoes ? (rtt / echoes).toFixed(2) : "-") + " ms");
+            sent = 0; echoes = 0; rtt = 0; start = performance.now();
+        }
+        requestAnimationFrame(frame);
+    }
+    requestAnimationFrame(frame);
+}
+const params = new URLSearchParams(location.search);
+run(Number(params.get("size")), Number(params.get("count")));
+</script></body></html>
+HTML
+
+cd $BUILD
+for test in "size=256&count=2000" "size=1048576&count=2"; do
+    echo "### $test"
+    timeout $SECONDS_PER_TEST ./primary_process --url="file://$PAGE/index.html?$test" 2>/dev/null \
+        | grep -E "^Channel|page:" || true
+done
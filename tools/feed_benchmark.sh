@@ -0,0 +1,38 @@
+#!/bin/bash -e
+### Stream 1 MB frames from the host of the separate process demo into a page
+### through blu.feed() and print the MB per second the page receives, with
+### frames released at once by the page then left to the garbage collector.
+### Usage: tools/feed_benchmark.sh [build directory] [seconds per test]
+
+BUILD=`realpath "${1:-build}"`
+SECONDS_PER_TEST=${2:-10}
+PAGE=`mktemp -d`
+trap 'rm -fr $PAGE' EXIT
+
+cat > $PAGE/index.html <<HTML
+<html><body><h1>Shared memory feed</h1><script>
+const release = new URLSearchParams(location.search).get("release") === "1";
+let frames = 0, bytes = 0, start = performance.now();
+blu.feed("sensor", (buffer) => {
+    // Touch the frame as a consumer would
+    const view = new Uint8Array(buffer);
+    if (view[0] !== view[view.length - 1]) { console.log("page: torn frame"); }
+    frames++; bytes += buffer.byteLength;
+    if (release) { blu.release(buffer); }
+    const elapsed = (performance.now() - start) / 1000;
+    if (elapsed > 1) {
+        console.log("page: " + (frames / elapsed).toFixed(0) + " frames/s, "
+                    + (bytes / elapsed / 1048576).toFixed(1) + " MB/s");
+        frames = 0; bytes = 0; start = performance.now();
+    }
+});
+</script></body></html>
+HTML
+
+cd $BUILD
+for release in 1 0; do
+    echo "### blu.release(): $release"
+    timeout $SECONDS_PER_TEST ./primary_process --feed-benchmark \
+        --url="file://$PAGE/index.html?release=$release" 2>/dev/null \
+        | grep -E "^Feed|page:" || true
+done
@@ -0,0 +1,128 @@
+// Compare FrameCopy::copy() with row by row memcpy() on 4K and 8K frames
+// copied into pitched buffers, like CEF frames into locked textures.
+//
+// Compile:
+//   g++ --std=c++14 -O2 -I../common frame_copy_benchmark.cpp ../common/FrameCopy.cpp ../common/TaskScheduler.cpp -pthread -o frame_copy_benchmark
+// Usage:
+//   frame_copy_benchmark [frames]
+
+#include "FrameCopy.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+//! \brief Default number of frames copied by each method.
+static const int DEFAULT_FRAMES = 50;
+
+//! \brief Texture rows are aligned on this many bytes by drivers.
+static const size_t PITCH_ALIGNMENT = 256u;
+
+// *****************************************************************************
+//! \brief Frame dimension to benchmark.
+// *****************************************************************************
+struct Frame
+{
+    const char* name;
+    size_t width;
+    size_t height;
+};
+
+//------------------------------------------------------------------------------
+//! \brief Copy the source frame \c frames times with the given method.
+//! \return the mean time of a copy in milliseconds.
+//------------------------------------------------------------------------------
+template<class Copy>
+static double measure(int frames, Copy const& copy)
+{
+    // First copy out of the measure: page faults of the destination
+    copy();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i)
+    {
+        copy();
+    }
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count() / double(frames);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Benchmark both methods on a BGRA frame. CEF gives tightly packed
+//! rows, the destination has padded rows.
+//! \return false if the copies differ from the source.
+//------------------------------------------------------------------------------
+static bool bench(Frame const& frame, int frames)
+{
+    const size_t row_bytes = frame.width * 4u;
+    const size_t src_pitch = row_bytes;
+    const size_t dst_pitch = (row_bytes + PITCH_ALIGNMENT - 1u) / PITCH_ALIGNMENT
+                             * PITCH_ALIGNMENT + PITCH_ALIGNMENT;
+
+    std::vector<unsigned char> src(src_pitch * frame.height);
+    for (size_t i = 0u; i < src.size(); ++i)
+    {
+        src[i] = static_cast<unsigned char>(i * 7u);
+    }
+    std::vector<unsigned char> by_rows(dst_pitch * frame.height);
+    std::vector<unsigned char> by_frame(dst_pitch * frame.height);
+
+    const double memcpy_ms = measure(frames, [&]()
+    {
+        for (size_t y = 0u; y < frame.height; ++y)
+        {
+            std::memcpy(by_rows.data() + y * dst_pitch, src.data() + y * src_pitch, row_bytes);
+        }
+    });
+    const double copy_ms = measure(frames, [&]()
+    {
+        FrameCopy::copy(by_frame.data(), dst_pitch, src.data(), src_pitch,
+                        row_bytes, frame.height);
+    });
+
+    for (size_t y = 0u; y < frame.height; ++y)
+    {
+        if ((std::memcmp(by_rows.data() + y * dst_pitch, src.data() + y * src_pitch, row_bytes) != 0) ||
+            (std::memcmp(by_frame.data() + y * dst_pitch, src.data() + y * src_pitch, row_bytes) != 0))
+        {
+            std::cerr << frame.name << ": row " << y << " differs from the source" << std::endl;
+            return false;
+        }
+    }
+
+    const double gb = double(row_bytes * frame.height) / 1e9;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2)
+        << frame.name << " (" << frame.width << "x" << frame.height << ", pitch "
+        << dst_pitch << "): memcpy " << memcpy_ms << " ms " << gb * 1000.0 / memcpy_ms
+        << " GB/s, FrameCopy " << copy_ms << " ms " << gb * 1000.0 / copy_ms
+        << " GB/s (" << FrameCopy::strategy(row_bytes * frame.height) << "), x"
+        << memcpy_ms / copy_ms;
+    std::cout << out.str() << std::endl;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const int frames = (argc > 1) ? std::atoi(argv[1]) : DEFAULT_FRAMES;
+    if (frames <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [frames]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const Frame sizes[] = {
+        { "4K", 3840u, 2160u },
+        { "8K", 7680u, 4320u },
+    };
+    for (auto const& frame: sizes)
+    {
+        if (!bench(frame, frames))
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#!/bin/bash -e
+### Start the separate process demo with a placement file, then check through
+### /proc that each of its subprocesses has the CPU affinity, nice level and
+### cgroup given for its type (--type). Exit with an error if one does not.
+### Usage: tools/placement_check.sh [build directory] [placement file] [seconds]
+
+BUILD=`realpath "${1:-build}"`
+CONF=`realpath "${2:-cefsimple_separate/placement.conf}"`
+WAIT=${3:-5}
+
+### Value of the key in the section of the process type (the zygote falls
+### back to the renderer section)
+function setting
+{
+    local value=`awk -v section="[$1]" -v key="$2" '
+        /^[ \t]*\[/ { gsub(/[ \t]/, ""); current = $0; next }
+        current == section && $0 ~ "^[ \t]*" key "[ \t]*=" {
+            sub(/^[^=]*=[ \t]*/, ""); sub(/[ \t\r]*$/, ""); print; exit
+        }' "$CONF"`
+    if [ -z "$value" -a "$1" == "zygote" ] && ! grep -q "^\[zygote\]" "$CONF"; then
+        setting renderer "$2"
+    else
+        echo "$value"
+    fi
+}
+
+### Expand a CPU list "0-3,6" into "0 1 2 3 6"
+function expand
+{
+    local range
+    for range in ${1//,/ }; do
+        seq ${range%-*} ${range#*-}
+    done | sort -n | tr '\n' ' '
+}
+
+### Expected CPUs of a CPU list of the placement file ("^list": CPUs of the
+### primary process but these ones)
+function expected_cpus
+{
+    if [ "${1:0:1}" == "^" ]; then
+        local excluded=" `expand ${1:1}`"
+        local cpu
+        for cpu in `expand $ALLOWED`; do
+            [[ "$excluded" == *" $cpu "* ]] || echo -n "$cpu "
+        done
+    else
+        expand $1
+    fi
+}
+
+### Pids of the descendants of the given process
+function descendants
+{
+    local child
+    for child in `awk '{ sub(/^.*\) /, ""); print FILENAME, $2 }' /proc/[0-9]*/stat 2>/dev/null \
+                  | awk -v parent=$1 '$2 == parent { split($1, p, "/"); print p[3] }'`; do
+        echo $child
+        descendants $child
+    done
+}
+
+cd $BUILD
+./primary_process --placement="$CONF" --url="data:text/html,<h1>Placement</h1>" \
+    > /dev/null 2>&1 &
+PRIMARY=$!
+trap 'kill $PRIMARY 2>/dev/null || true' EXIT
+sleep $WAIT
+ALLOWED=`awk '/^Cpus_allowed_list/ { print $2 }' /proc/$PRIMARY/status`
+
+FAILED=0
+CHECKED=0
+for pid in `descendants $PRIMARY`; do
+    type=`tr '\0' '\n' < /proc/$pid/cmdline 2>/dev/null | sed -n 's/^--type=//p'`
+    [ -n "$type" ] || continue
+    grep -q "^\[$type\]" "$CONF" || [ "$type" == "zygote" ] || continue
+
+    cpus=`setting $type cpus`
+    nice=`setting $type nice`
+    cgroup=`setting $type cgroup`
+    actual_cpus=`expand $(awk '/^Cpus_allowed_list/ { print $2 }' /proc/$pid/status)`
+    actual_nice=`sed 's/^.*) //' /proc/$pid/stat | awk '{ print $17 }'`
+    actual_cgroup=`sed -n 's/^0:://p' /proc/$pid/cgroup`
+
+    errors=""
+    if [ -n "$cpus" -a "`expected_cpus $cpus`" != "$actual_cpus" ]; then
+        errors="$errors cpus '$actual_cpus' instead of '`expected_cpus $cpus`'"
+    fi
+    if [ -n "$nice" -a "$nice" != "$actual_nice" ]; then
+        errors="$errors nice $actual_nice instead of $nice"
+    fi
+    if [ -n "$cgroup" -a "/${cgroup#/sys/fs/cgroup/}" != "$actual_cgroup" \
+         -a "$cgroup" != "$actual_cgroup" ]; then
+        errors="$errors cgroup $actual_cgroup instead of $cgroup"
+    fi
+
+    CHECKED=$((CHECKED + 1))
+    if [ -z "$errors" ]; then
+        echo "OK   $pid $type"
+    else
+        echo "FAIL $pid $type:$errors"
+        FAILED=$((FAILED + 1))
+    fi
+done
+
+echo "$CHECKED subprocesses checked, $FAILED misplaced"
+[ $CHECKED -gt 0 -a $FAILED -eq 0 ]
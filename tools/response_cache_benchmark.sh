@@ -0,0 +1,43 @@
+#!/bin/bash -e
+### Load the same page with large scripts in all views of the OpenGL demo from
+### a local stand-in HTTP server, without and with the shared response cache,
+### and count the requests reaching the server.
+### Usage: tools/response_cache_benchmark.sh [build directory] [port]
+
+source `dirname "$0"`/benchmark_common.sh
+
+BUILD=`realpath "${1:-build}"`
+PORT=${2:-8765}
+SITE=`mktemp -d`
+trap 'kill $SERVER 2>/dev/null; rm -fr $SITE' EXIT
+
+### Page with a 2 MB script and a style sheet cacheable for one hour
+for i in `seq 1 20000`; do echo "var v$i = 'padding padding padding padding padding padding padding';"; done > $SITE/bundle.js
+echo "body { background: #ddd; }" > $SITE/style.css
+cat > $SITE/index.html <<HTML
+<html><head><link rel="stylesheet" href="style.css"><script src="bundle.js"></script></head>
+<body><h1>Response cache</h1></body></html>
+HTML
+cat > $SITE/server.py <<PY
+import http.server, sys
+class Handler(http.server.SimpleHTTPRequestHandler):
+    def end_headers(self):
+        self.send_header("Cache-Control", "max-age=3600")
+        super().end_headers()
+http.server.ThreadingHTTPServer(("127.0.0.1", $PORT), Handler).serve_forever()
+PY
+(cd $SITE && exec python3 server.py 2> $SITE/requests.log) &
+SERVER=$!
+sleep 1
+
+### Run the application until all views have painted once, then count the
+### requests which reached the server
+function run
+{
+    : > $SITE/requests.log
+    first_paint "$1" --cache-mode=memory --url=http://127.0.0.1:$PORT/index.html "${@:2}"
+    echo "Requests to bundle.js: `grep -c 'GET /bundle.js' $SITE/requests.log`"
+}
+
+run "Without response cache" --response-cache-mb=0
+run "With response cache" --response-cache-mb=64
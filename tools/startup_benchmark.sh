@@ -0,0 +1,74 @@
+#!/bin/bash -e
+### Start the separate process demo several times until its page is painted
+### and print how long each startup step takes, by process type: browser
+### creation, launch of the zygote, GPU, utility and renderer subprocesses,
+### renderer ready and first paint. Times are read from the trace written by
+### StartupTrace (OFFSCREENCEF_STARTUP_TRACE). Extra arguments are given to
+### the primary process (i.e. --no-zygote to exec each renderer).
+### Usage: tools/startup_benchmark.sh [build directory] [runs] [primary args]
+
+BUILD=`realpath "${1:-build}"`
+RUNS=${2:-10}
+shift 2 || shift $#
+TRACES=`mktemp -d`
+trap 'rm -fr $TRACES' EXIT
+
+cd $BUILD
+for run in `seq $RUNS`; do
+    OFFSCREENCEF_STARTUP_TRACE=$TRACES/$run.trace timeout 60 ./primary_process \
+        --startup-benchmark --url="data:text/html,<h1>Startup</h1>" "$@" \
+        > /dev/null 2>&1 || true
+done
+
+printf "%-45s %8s %8s %8s %5s\n" "step ($RUNS runs)" "mean ms" "min" "max" "n"
+
+# Trace lines: <ns> <pid> <process type> <event>. Launch lines are written
+# by the browser process for the child about to be launched: the n-th launch
+# of a type is matched with the n-th process of that type.
+for trace in $TRACES/*.trace; do
+    sort -n $trace | awk '
+        function ms(a, b) { return (b - a) / 1000000 }
+        {
+            t = $1; pid = $2; type = $3; event = $4
+            if (type == "browser") {
+                if (!(event in browser)) { browser[event] = t }
+            } else if (event == "launch") {
+                launch[type, ++launches[type]] = t
+            } else {
+                if (!((type, pid) in seen)) { seen[type, pid] = ++started[type] }
+                n = seen[type, pid]
+                if (!((type, n, event) in step)) { step[type, n, event] = t }
+            }
+        }
+        END {
+            c = browser["create-browser"]
+            if ("initialize" in browser && c)
+                print "browser CefInitialize", ms(browser["initialize"], c)
+            if ("after-created" in browser)
+                print "browser CreateBrowser -> OnAfterCreated", ms(c, browser["after-created"])
+            if ("first-paint" in browser)
+                print "browser CreateBrowser -> first paint", ms(c, browser["first-paint"])
+            for (key in launch) {
+                split(key, k, SUBSEP); type = k[1]; n = k[2]
+                if ((type, n, "main") in step)
+                    print type " launch -> main", ms(launch[key], step[type, n, "main"])
+                if ((type, n, "ready") in step) {
+                    print type " launch -> ready", ms(launch[key], step[type, n, "ready"])
+                    if (n == 1) print type " CreateBrowser -> ready", ms(c, step[type, n, "ready"])
+                }
+                if ((type, n, "webkit") in step)
+                    print type " launch -> webkit initialized", ms(launch[key], step[type, n, "webkit"])
+            }
+        }'
+done | awk '
+    {
+        value = $NF; $NF = ""; sub(/ $/, "")
+        sum[$0] += value; count[$0]++
+        if (!($0 in min) || value < min[$0]) min[$0] = value
+        if (value > max[$0]) max[$0] = value
+    }
+    END {
+        for (step in sum)
+            printf "%-45s %8.1f %8.1f %8.1f %5d\n", step, sum[step] / count[step],
+                   min[step], max[step], count[step]
+    }' | sort